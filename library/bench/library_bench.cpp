@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../include/IsbnBatch.h"
+#include "../include/LibTypes.h"
+#include "../include/Reports.h"
+#include "../include/Sharded.h"
+#include "../include/Text.h"
+#include "../include/hash_sha256_batch.h"
+
+// Library micro benchmarks.
+// Each benchmark prints one line per variant so runs can be compared.
+
+namespace
+{
+  using bench_clock = std::chrono::steady_clock;
+
+  /// Keeps results observable so the optimizer cannot drop the work.
+  volatile size_t sink = 0;
+
+  double elapsed_ms(bench_clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+  }
+
+  void report(const std::string& name, const std::string& variant, double ms, size_t ops)
+  {
+    std::cout << std::left << std::setw(24) << name
+              << std::setw(20) << variant
+              << std::right << std::setw(10) << std::fixed << std::setprecision(2) << ms << " ms"
+              << std::setw(12) << std::setprecision(1) << (ops / ms) * 1000.0 << " ops/s\n";
+  }
+
+  std::string random_words(size_t words)
+  {
+    static const char* pool[] = {
+      "The", "Great", "gatsby", "War", "and", "Peace", "Moby", "Dick", "Pride",
+      "prejudice", "Ulysses", "Odyssey", "Hamlet", "Brave", "new", "World"
+    };
+
+    std::string text;
+    for (size_t i = 0; i < words; i++) {
+      if (i != 0) {
+        text += ' ';
+      }
+      text += pool[std::rand() % 16];
+    }
+
+    return text;
+  }
+
+  std::string toLC(const std::string& str)
+  {
+    std::string lower = str;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+      [](unsigned char c) { return std::tolower(c); });
+    return lower;
+  }
+
+  /// Case-insensitive substring: toLC + find versus Text::ifind.
+  /// `lowered` keys match the index (already lowercase at index time),
+  /// otherwise the key has to be lowered as well, as in a column scan.
+  void bench_ifind(const std::string& name, size_t min_words, size_t max_words, bool lowered)
+  {
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 200000; i++) {
+      std::string key = random_words(min_words + i % (max_words - min_words + 1));
+      keys.push_back(lowered ? toLC(key) : key);
+    }
+
+    const std::vector<std::string> terms = { "GATSBY", "brave new", "Odyssey", "zzz" };
+    size_t ops = keys.size() * terms.size();
+
+    auto start = bench_clock::now();
+    size_t hits = 0;
+    for (const std::string& term : terms) {
+      std::string lower = toLC(term);
+      for (const std::string& key : keys) {
+        if (lowered) {
+          hits += key.find(lower) != std::string::npos;
+        }
+        else {
+          hits += toLC(key).find(lower) != std::string::npos;
+        }
+      }
+    }
+    report(name, "toLC + find", elapsed_ms(start), ops);
+    sink = hits;
+
+    start = bench_clock::now();
+    hits = 0;
+    for (const std::string& term : terms) {
+      for (const std::string& key : keys) {
+        hits += Text::ifind_scalar(key, term) != std::string_view::npos;
+      }
+    }
+    report(name, "scalar", elapsed_ms(start), ops);
+    sink = hits;
+
+    start = bench_clock::now();
+    hits = 0;
+    for (const std::string& term : terms) {
+      for (const std::string& key : keys) {
+        hits += Text::icontains(key, term);
+      }
+    }
+    report(name, "dispatched", elapsed_ms(start), ops);
+    sink = hits;
+  }
+
+  /// The byte-at-a-time hash_sha256 update path, kept for comparison.
+  class legacy_sha256
+  {
+  public:
+    void init()
+    {
+      datalen = 0;
+      state = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+    }
+
+    void update(const std::uint8_t* msg, size_t length)
+    {
+      for (size_t i = 0; i < length; i++) {
+        data[datalen++] = msg[i];
+        if (datalen == 64) {
+          transform();
+          datalen = 0;
+        }
+      }
+    }
+
+    std::uint32_t digest_word() const
+    {
+      return state[0];
+    }
+
+  private:
+    static std::uint32_t rotr(std::uint32_t x, std::uint32_t n)
+    {
+      return (x >> n) | (x << (32 - n));
+    }
+
+    void transform()
+    {
+      static const std::uint32_t K[64] = {
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+        0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+        0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+        0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+        0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+        0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+      };
+
+      std::array<std::uint32_t, 64> m = {};
+      for (size_t i = 0, j = 0; i < 16; i++, j += 4) {
+        m[i] = (std::uint32_t(data[j]) << 24) | (std::uint32_t(data[j + 1]) << 16)
+             | (std::uint32_t(data[j + 2]) << 8) | std::uint32_t(data[j + 3]);
+      }
+      for (size_t i = 16; i < 64; i++) {
+        std::uint32_t s0 = rotr(m[i - 15], 7) ^ rotr(m[i - 15], 18) ^ (m[i - 15] >> 3);
+        std::uint32_t s1 = rotr(m[i - 2], 17) ^ rotr(m[i - 2], 19) ^ (m[i - 2] >> 10);
+        m[i] = s1 + m[i - 7] + s0 + m[i - 16];
+      }
+
+      std::array<std::uint32_t, 8> s = state;
+      for (size_t i = 0; i < 64; i++) {
+        std::uint32_t t1 = s[7] + (rotr(s[4], 6) ^ rotr(s[4], 11) ^ rotr(s[4], 25))
+                         + ((s[4] & s[5]) ^ (~s[4] & s[6])) + K[i] + m[i];
+        std::uint32_t t2 = (rotr(s[0], 2) ^ rotr(s[0], 13) ^ rotr(s[0], 22))
+                         + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+        s = { t1 + t2, s[0], s[1], s[2], s[3] + t1, s[4], s[5], s[6] };
+      }
+
+      for (size_t i = 0; i < 8; i++) {
+        state[i] += s[i];
+      }
+    }
+
+    std::array<std::uint8_t, 64> data{};
+    std::array<std::uint32_t, 8> state{};
+    size_t datalen = 0;
+  };
+
+  void report_gbps(const std::string& name, const std::string& variant, double ms, size_t bytes)
+  {
+    std::cout << std::left << std::setw(24) << name
+              << std::setw(20) << variant
+              << std::right << std::setw(10) << std::fixed << std::setprecision(2) << ms << " ms"
+              << std::setw(12) << std::setprecision(3) << (bytes / ms) / 1.0e6 << " GB/s\n";
+  }
+
+  /// Building index keys: per-byte std::tolower versus Text::normalize,
+  /// which also folds accents and reuses its buffer.
+  void bench_normalize()
+  {
+    std::vector<std::string> titles;
+    for (size_t i = 0; i < 200000; i++) {
+      std::string title = random_words(2 + i % 5);
+      if (i % 8 == 0) {
+        title += " \xC3\x89mile \xC3\x85ngstr\xC3\xB6m";
+      }
+      titles.push_back(title);
+    }
+
+    auto start = bench_clock::now();
+    size_t bytes = 0;
+    for (const std::string& title : titles) {
+      bytes += toLC(title).size();
+    }
+    report("index keys", "toLC", elapsed_ms(start), titles.size());
+
+    start = bench_clock::now();
+    std::string key;
+    for (const std::string& title : titles) {
+      bytes += Text::normalize(title, key).size();
+    }
+    report("index keys", "normalize", elapsed_ms(start), titles.size());
+    sink = bytes;
+  }
+
+  /// sha256_update throughput on one large buffer, fed in `chunk` sized pieces.
+  void bench_sha256_update(size_t chunk)
+  {
+    std::vector<std::uint8_t> buffer(64 * 1024 * 1024);
+    for (auto& b : buffer) {
+      b = static_cast<std::uint8_t>(std::rand());
+    }
+
+    const std::string name = "sha256 update " + std::to_string(chunk);
+
+    auto start = bench_clock::now();
+    legacy_sha256 legacy;
+    legacy.init();
+    for (size_t i = 0; i < buffer.size(); i += chunk) {
+      legacy.update(buffer.data() + i, std::min(chunk, buffer.size() - i));
+    }
+    report_gbps(name, "byte staging", elapsed_ms(start), buffer.size());
+    sink = legacy.digest_word();
+
+    start = bench_clock::now();
+    hash_sha256 hash;
+    hash.sha256_init();
+    for (size_t i = 0; i < buffer.size(); i += chunk) {
+      hash.sha256_update(buffer.data() + i, std::min(chunk, buffer.size() - i));
+    }
+    report_gbps(name, "block path", elapsed_ms(start), buffer.size());
+    sink = hash.sha256_final()[0];
+  }
+
+  /// Password hashing: one hash_sha256 per password versus every batch engine.
+  void bench_sha256_batch()
+  {
+    std::vector<std::array<std::uint8_t, 32U>> passwords(200000);
+    for (auto& pass : passwords) {
+      for (auto& b : pass) {
+        b = static_cast<std::uint8_t>(std::rand());
+      }
+    }
+
+    auto start = bench_clock::now();
+    hash_sha256 hash;
+    size_t acc = 0;
+    for (const auto& pass : passwords) {
+      hash.sha256_init();
+      hash.sha256_update(pass.data(), pass.size());
+      acc += hash.sha256_final()[0];
+    }
+    report("sha256 passwords", "hash_sha256", elapsed_ms(start), passwords.size());
+    sink = acc;
+
+    const std::pair<hash_sha256_batch::engine, const char*> engines[] = {
+      { hash_sha256_batch::engine::scalar, "batch scalar" },
+      { hash_sha256_batch::engine::sse2, "batch sse2 x4" },
+      { hash_sha256_batch::engine::avx2, "batch avx2 x8" },
+      { hash_sha256_batch::engine::sha_ni, "batch sha-ni" }
+    };
+
+    for (const auto& [engine, name] : engines) {
+      if (!hash_sha256_batch::supported(engine)) {
+        continue;
+      }
+
+      start = bench_clock::now();
+      std::vector<sha256_type> hashes = hash_sha256_batch::hash(passwords, engine);
+      report("sha256 passwords", name, elapsed_ms(start), passwords.size());
+      sink = hashes.back()[0];
+    }
+  }
+
+  /// Import validation: one verifying ISBN constructor per record versus one batch.
+  void bench_isbn_batch()
+  {
+    std::vector<std::string> codes(1000000);
+    for (auto& code : codes) {
+      code = LibraryTypes::ISBN().code;
+    }
+
+    auto start = bench_clock::now();
+    size_t acc = 0;
+    for (const auto& code : codes) {
+      acc += LibraryTypes::ISBN(code).code.size();
+    }
+    report("isbn validate", "per record", elapsed_ms(start), codes.size());
+    sink = acc;
+
+    std::string text;
+    std::vector<std::uint32_t> offsets{ 0 };
+    for (const auto& code : codes) {
+      text += code;
+      offsets.push_back(static_cast<std::uint32_t>(text.size()));
+    }
+
+    start = bench_clock::now();
+    IsbnBatch::Report batch = IsbnBatch::validate(text.data(), offsets.data(), codes.size());
+    report("isbn validate", "batch", elapsed_ms(start), codes.size());
+    sink = batch.packed.back() + batch.failed.size();
+  }
+
+  /// Test catalog codes: rand() digit by digit versus the seeded unique generator.
+  void bench_isbn_generate()
+  {
+    auto start = bench_clock::now();
+    size_t acc = 0;
+    for (size_t i = 0; i < 1000000; i++) {
+      std::string code = "978-" + std::to_string(std::rand() % 10) + "-";
+      for (size_t j = 0; j < 8; j++) {
+        code += std::to_string(std::rand() % 10);
+      }
+      acc += code.size();
+    }
+    report("isbn generate", "rand digits", elapsed_ms(start), 1000000);
+    sink = acc;
+
+    LibraryTypes::IsbnGenerator generator(42);
+    std::vector<char> codes(10000000 * LibraryTypes::IsbnGenerator::LENGTH);
+
+    start = bench_clock::now();
+    for (size_t i = 0; i < 10000000; i++) {
+      generator.next(codes.data() + i * LibraryTypes::IsbnGenerator::LENGTH);
+    }
+    report("isbn generate", "unique x10M", elapsed_ms(start), 10000000);
+    sink = static_cast<size_t>(codes.back());
+  }
+
+  /// Unions every posting list into one id set, as a multi-key match does.
+  void bench_postings_union(
+    const std::string& name,
+    const std::unordered_map<std::string, std::vector<size_t>>& vectors,
+    const std::unordered_map<std::string, LibraryTypes::Postings>& lists,
+    size_t books)
+  {
+    auto start = bench_clock::now();
+    LibraryTypes::IdSet from_vectors(books);
+    for (const auto& [key, ids] : vectors) {
+      for (size_t id : ids) {
+        from_vectors.add(static_cast<std::uint32_t>(id));
+      }
+    }
+    report(name, "vector<size_t>", elapsed_ms(start), books);
+
+    start = bench_clock::now();
+    LibraryTypes::IdSet from_lists(books);
+    for (const auto& [key, ids] : lists) {
+      from_lists.add(ids);
+    }
+    report(name, "postings", elapsed_ms(start), books);
+    sink = from_vectors.count() + from_lists.count();
+  }
+
+  /// Index postings: vectors of size_t versus group delta lists.
+  void bench_postings()
+  {
+    // 2M books over 20k authors: a few long lists and many short ones
+    const size_t books = 2000000;
+    std::vector<std::string> keys(books);
+    for (size_t i = 0; i < books; i++) {
+      keys[i] = "author " + std::to_string((std::rand() % 200) * (std::rand() % 100));
+    }
+
+    auto start = bench_clock::now();
+    std::unordered_map<std::string, std::vector<size_t>> vectors;
+    for (size_t i = 0; i < books; i++) {
+      vectors[keys[i]].push_back(i);
+    }
+    report("postings build", "vector<size_t>", elapsed_ms(start), books);
+
+    start = bench_clock::now();
+    std::unordered_map<std::string, LibraryTypes::Postings> lists;
+    for (size_t i = 0; i < books; i++) {
+      lists[keys[i]].add(static_cast<std::uint32_t>(i));
+    }
+    report("postings build", "group delta", elapsed_ms(start), books);
+
+    size_t acc = 0;
+    size_t vector_bytes = 0;
+    start = bench_clock::now();
+    for (const auto& [key, ids] : vectors) {
+      vector_bytes += sizeof(ids) + ids.capacity() * sizeof(size_t);
+      for (size_t id : ids) {
+        acc += id;
+      }
+    }
+    report("postings scan", "vector<size_t>", elapsed_ms(start), books);
+
+    size_t list_bytes = 0;
+    start = bench_clock::now();
+    for (const auto& [key, ids] : lists) {
+      list_bytes += sizeof(ids) + (ids.encoded_size() > 15 ? ids.encoded_size() : 0);
+      ids.for_each([&acc](std::uint32_t id) { acc += id; });
+    }
+    report("postings scan", "group delta", elapsed_ms(start), books);
+    sink = acc;
+
+    std::cout << std::left << std::setw(24) << "postings memory"
+              << std::setw(20) << "bytes"
+              << vector_bytes << " -> " << list_bytes << "\n";
+
+    // What a query does with the ids: union every matching key into a set
+    bench_postings_union("postings union", vectors, lists, books);
+
+    // 2M books over 4 shelves: every list is dense enough to be a bitmap
+    std::unordered_map<std::string, std::vector<size_t>> shelf_vectors;
+    std::unordered_map<std::string, LibraryTypes::Postings> shelf_lists;
+    for (size_t i = 0; i < books; i++) {
+      std::string shelf = "shelf " + std::to_string(std::rand() % 4);
+      shelf_vectors[shelf].push_back(i);
+      shelf_lists[shelf].add(static_cast<std::uint32_t>(i));
+    }
+    bench_postings_union("postings union dense", shelf_vectors, shelf_lists, books);
+  }
+
+  /// Opening a report view: copying the books versus a shared segment snapshot.
+  void bench_snapshot()
+  {
+    UI::TEST_MODE = true;
+
+    LibraryTypes::Library lib;
+    lib.seed_isbns(9);
+    std::vector<LibraryTypes::Book> books;
+    for (const LibraryTypes::ISBN& isbn : lib.new_isbns(200000)) {
+      books.emplace_back(random_words(3), random_words(2), isbn);
+    }
+    lib.import(books);
+    LibraryTypes::BookSnapshot held = lib.snapshot();
+
+    auto start = bench_clock::now();
+    size_t acc = 0;
+    for (size_t i = 0; i < 20; i++) {
+      std::vector<LibraryTypes::Book> copy = lib.books;
+      acc += copy.size();
+    }
+    report("report view", "copy books", elapsed_ms(start), 20);
+
+    double ms = 0;
+    for (size_t i = 0; i < 20; i++) {
+      // One return between reports dirties only the tail segment
+      lib.add(LibraryTypes::Book("Returned", "Author", lib.new_isbn()));
+
+      start = bench_clock::now();
+      acc += lib.snapshot().size();
+      ms += elapsed_ms(start);
+    }
+    report("report view", "snapshot", ms, 20);
+    sink = acc + held.size();
+  }
+
+  /// Group-by-author report on one thread versus partitioned across all of them.
+  void bench_reports()
+  {
+    UI::TEST_MODE = true;
+
+    LibraryTypes::Library lib;
+    lib.seed_isbns(11);
+    std::vector<std::string> authors;
+    for (size_t i = 0; i < 2000; i++) {
+      authors.push_back(random_words(2));
+    }
+    std::vector<LibraryTypes::Book> books;
+    for (const LibraryTypes::ISBN& isbn : lib.new_isbns(200000)) {
+      books.emplace_back(random_words(3), authors[books.size() % authors.size()], isbn);
+    }
+    lib.import(books);
+
+    UserManager um;
+    size_t acc = 0;
+    for (size_t threads : { size_t(1), size_t(0) }) {
+      Reports reports(um, lib, threads);
+      for (size_t i = 0; i < 10; i++) {
+        acc += reports.by_author().size();
+      }
+
+      double ms = 0;
+      for (const Reports::Timing& timing : reports.timing()) {
+        ms += timing.ms;
+      }
+      report("by_author", threads == 1 ? "1 thread" : std::to_string(reports.timing()[0].threads) + " threads", ms, 10);
+    }
+    sink = acc;
+  }
+
+  /// Title search over one library versus the same books split across shards.
+  void bench_sharded_search()
+  {
+    UI::TEST_MODE = true;
+
+    LibraryTypes::Library single;
+    single.seed_isbns(7);
+    single.set_cache_capacity(0);
+
+    std::vector<LibraryTypes::Book> books;
+    for (const LibraryTypes::ISBN& isbn : single.new_isbns(200000)) {
+      books.emplace_back(random_words(2 + std::rand() % 5), random_words(2), isbn);
+    }
+    single.import(books);
+
+    LibraryTypes::ShardedLibrary sharded(4);
+    sharded.import(books);
+
+    const char* terms[] = { "gat", "peace", "dick", "ulys", "brave new", "odyssey" };
+
+    auto start = bench_clock::now();
+    size_t acc = 0;
+    for (size_t i = 0; i < 60; i++) {
+      acc += single.search(terms[i % 6], LibraryTypes::SEARCH::TITLE).size();
+    }
+    report("title search", "single", elapsed_ms(start), 60);
+
+    start = bench_clock::now();
+    for (size_t i = 0; i < 60; i++) {
+      acc += sharded.search(terms[i % 6], LibraryTypes::SEARCH::TITLE).size();
+    }
+    report("title search", "sharded x" + std::to_string(sharded.shard_count()), elapsed_ms(start), 60);
+    sink = acc;
+  }
+}
+
+int main()
+{
+  std::srand(42);
+
+  bench_ifind("ifind index keys", 2, 7, true);
+  bench_ifind("ifind titles", 2, 7, false);
+  bench_ifind("ifind long text", 30, 60, false);
+  bench_normalize();
+  bench_sha256_update(1000);
+  bench_sha256_update(64 * 1024 * 1024);
+  bench_sha256_batch();
+  bench_isbn_batch();
+  bench_isbn_generate();
+  bench_postings();
+  bench_snapshot();
+  bench_reports();
+  bench_sharded_search();
+
+  return 0;
+}
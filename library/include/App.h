@@ -49,9 +49,19 @@ public:
 		
 		if(!UI::TEST_MODE)
 		{
-			[[maybe_unused]] bool ignored;
-			ignored = this->UM.load();
-			ignored = this->LIB.load();
+			// A damaged file has been set aside; running on without it
+			// would save an empty dataset in its place
+			try
+			{
+				[[maybe_unused]] bool ignored;
+				ignored = this->UM.load();
+				ignored = this->LIB.load();
+			}
+			catch (const std::runtime_error& error)
+			{
+				UI::Console::print_message(std::string(error.what()) + ". Restore it and restart the app.");
+				return;
+			}
 		}
 
 		bool check = this->UM.current_user.isNULL();
@@ -160,8 +170,62 @@ public:
 		return this->LIB.search_res;
 	}
 
-	/// @brief Prints a vector of books to the console.
-	void print_books(std::vector<LibraryTypes::Book> books)
+	/// @brief Borrows a book from the catalog for the current user.
+	/// @param index The index of the book in the catalog.
+	/// @returns The borrowed book.
+	LibraryTypes::Book borrow_book(size_t index)
+	{
+		LibraryTypes::Book checkout = this->LIB.books.at(index);
+
+		this->LIB.record_borrow(checkout);
+
+		this->LIB.remove(checkout);
+
+		this->UM.add(checkout);
+
+		return checkout;
+	}
+
+	/// @brief Returns a book of the current user.
+	/// If patrons hold the title, the copy goes straight to the first
+	/// one in line instead of back into the catalog & its indexes.
+	/// @param index The index of the user's book.
+	/// @returns The patron it was handed to, empty if it went back to the catalog.
+	std::string return_book(size_t index)
+	{
+		LibraryTypes::Book checkin = this->UM.book(this->UM.current_user.loans.at(index));
+
+		this->UM.remove(static_cast<int>(index));
+
+		while (std::optional<std::string> holder = this->LIB.next_holder(checkin))
+		{
+			if (this->UM.lend(*holder, checkin))
+			{
+				this->LIB.record_borrow(checkin);
+				return *holder;
+			}
+		}
+
+		this->LIB.add(checkin);
+
+		return "";
+	}
+
+	/// @brief Gets the UserManager of the app.
+	UserManager& users()
+	{
+		return this->UM;
+	}
+
+	/// @brief Gets the Library of the app.
+	LibraryTypes::Library& library()
+	{
+		return this->LIB;
+	}
+
+	/// @brief Prints a vector of books (or loans) to the console.
+	template <typename T>
+	void print_books(const std::vector<T>& books)
 	{
 		UI::CLEAR();
 
@@ -173,7 +237,7 @@ public:
 		{
 			for (size_t i = 0; i < books.size(); i++)
 			{
-				LibraryTypes::Book book = books[i];
+				const T& book = books[i];
 
                 std::stringstream message;
                 message << "Index #" << i << "\n"
@@ -202,11 +266,37 @@ public:
 		}
 	}
 	
+	/// @brief Prints every overdue loan to the console.
+	void print_overdue()
+	{
+		UI::CLEAR();
+
+		std::vector<OverdueLoan> overdue = this->UM.overdue_report();
+
+		if (overdue.empty())
+		{
+			UI::Console::print_message("No overdue books!!!");
+			return;
+		}
+
+		for (const OverdueLoan& loan : overdue)
+		{
+			std::stringstream message;
+			message << "User: " << loan.user << "\n"
+					<< UI::DIVIDER << "\n"
+					<< this->UM.book(Loan(loan.book)).ToString() << "\n"
+					<< "Due: " << OverdueTracker::format(loan.due);
+
+			UI::Console::print_message(message.str());
+		}
+	}
+
 	/// @brief Handles the UserManager Main Menu UI.
 	/// This method handles the UserManager's main menu, allowing the user to
 	/// navigate to:
-	/// - App Main Menu
 	/// - Add & Remove
+	/// - Overdue Report
+	/// - App Main Menu
 	/// - Exit & Save
 	void um_main_menu()
 	{
@@ -217,21 +307,25 @@ public:
         ss << header()
            << "What would you like to do?\n"
            << "1) Add & Remove\n"
-           << "2) App Main\n"
-           << "3) Exit & Save";
+           << "2) Overdue Report\n"
+           << "3) App Main\n"
+           << "4) Exit & Save";
         question.contents = ss.str();
-		question.answers = { "1", "2", "3"};
+		question.answers = { "1", "2", "3", "4"};
 		question.type = UI::INPUT_TYPE::D;
 		question.actions = {
 
 		// Navigates to the UserManager Add & Remove Menu
 		{"1", [this](const std::string&) { this->um_add_rem_menu(); }},
 
+		// Prints the Overdue Report
+		{"2", [this](const std::string&) { this->print_overdue(); this->um_reset_menu(); }},
+
 		// Navigates to the App's Main Menu
-		{"2", [this](const std::string&) { this->main(); }},
+		{"3", [this](const std::string&) { this->main(); }},
 
 		// Exit & Save
-		{"3", [this](const std::string&) { this->exit(); }}
+		{"4", [this](const std::string&) { this->exit(); }}
 
 		};
 
@@ -469,6 +563,7 @@ public:
 	/// navigate to:
 	/// - View All Prompt
 	/// - Search Prompt
+	/// - Browse Prompt
 	/// - Library's Main Menu
 	/// - Exit & Save
 	void lib_inv_menu()
@@ -509,6 +604,21 @@ public:
 				this->lib_reset_menu();
 			}
 		};
+
+		/// @brief Handles the Library's Browse Prompt.
+		std::pair<std::string, std::function<void(const std::string&)>>
+			browse =
+		{
+			// Input
+			"3",
+
+			// Function
+			[this](const std::string&)
+			{
+				this->browse_menu();
+				this->lib_reset_menu();
+			}
+		};
 	
 		UI::CLEAR();
 
@@ -518,10 +628,11 @@ public:
            << "What would you like to do?\n"
            << "1) View All\n"
            << "2) Search\n"
-           << "3) Main Menu\n"
-           << "4) Exit & Save";
+           << "3) Browse\n"
+           << "4) Main Menu\n"
+           << "5) Exit & Save";
         question.contents = ss.str();
-		question.answers = { "1", "2", "3", "4" };
+		question.answers = { "1", "2", "3", "4", "5" };
 		question.type = UI::INPUT_TYPE::D;
 		question.actions = {
 
@@ -531,17 +642,67 @@ public:
 		// Handles the Search Prompt.
 		search,
 
+		// Handles the Browse Prompt.
+		browse,
+
 		// Navigates to the Library's Main Menu.
-		{"3", [this](const std::string&) { this->lib_main_menu(); }},
+		{"4", [this](const std::string&) { this->lib_main_menu(); }},
 
 		// Exit & Save
-		{"4", [this](const std::string&) { this->exit(); }},
+		{"5", [this](const std::string&) { this->exit(); }},
 
 		};
 
 		UI::Console::print_question(question);
 	}
 
+	/// @brief Handles the Library's Browse Prompt.
+	/// Lists one page of the catalog, ordered by title or by author.
+	void browse_menu()
+	{
+		UI::CLEAR();
+
+		UI::Question order;
+        std::stringstream ss;
+        ss << header()
+           << "How would you like to browse?\n"
+           << "1) Name\n"
+           << "2) Author";
+        order.contents = ss.str();
+		order.answers = { "1", "2" };
+		order.type = UI::INPUT_TYPE::D;
+
+		auto type = UI::Console::print_question(order);
+		if (!type.first)
+		{
+			return;
+		}
+
+		size_t pages = this->LIB.pages();
+		if (pages == 0)
+		{
+			UI::Console::print_message("The library has no books");
+			return;
+		}
+
+		UI::Question page;
+        ss.str("");
+        ss << header()
+           << "Which page? (0 - " << pages - 1 << ")";
+        page.contents = ss.str();
+		page.answers = std::gendsv(static_cast<int>(pages));
+		page.type = UI::INPUT_TYPE::D;
+
+		auto number = UI::Console::print_question(page);
+		if (!number.first)
+		{
+			return;
+		}
+
+		LibraryTypes::SEARCH by = type.second == "2" ? LibraryTypes::SEARCH::AUTHOR : LibraryTypes::SEARCH::TITLE;
+		this->print_books(this->LIB.browse(by, static_cast<size_t>(std::stoi(number.second))));
+	}
+
 	void search_menu()
 	{
 
@@ -561,8 +722,7 @@ public:
 
 				UI::Console::print_message("Enter the title of your book");
 
-				std::cout << "NAME: ";
-				std::getline(std::cin, title);
+				title = UI::Console::read_line("NAME: ");
 
 				this->LIB.search_res = this->LIB.search(title, LibraryTypes::SEARCH::TITLE);
 
@@ -588,8 +748,7 @@ public:
 				UI::Console::print_message("Enter the author of your book");
 
 				
-				std::cout << "AUTHOR: ";
-				std::getline(std::cin, author);
+				author = UI::Console::read_line("AUTHOR: ");
 
 				this->LIB.search_res = this->LIB.search(author, LibraryTypes::SEARCH::AUTHOR);
 
@@ -615,8 +774,7 @@ public:
 				UI::Console::print_message("Enter the ISBN of your book");
 
 				
-				std::cout << "ISBN: ";
-				std::getline(std::cin, isbn);
+				isbn = UI::Console::read_line("ISBN: ");
 
 				this->LIB.search_res = this->LIB.search(isbn, LibraryTypes::SEARCH::CODE);
 
@@ -678,17 +836,16 @@ public:
 
 				
 
-				std::cout << "Name: ";
-				std::getline(std::cin, name);
+				name = UI::Console::read_line("Name: ");
 
-				std::cout << "Author: ";
-				std::getline(std::cin, author);
+				author = UI::Console::read_line("Author: ");
 
-				std::cout << "ISBN: ";
-				std::getline(std::cin, isbn);
+				isbn = UI::Console::read_line("ISBN: ");
 
+				LibraryTypes::ISBN code;
 				try{
-					[[maybe_unused]] LibraryTypes::ISBN verify = LibraryTypes::ISBN(isbn);
+					// Generated codes must not clash with books out on loan either
+					code = isbn == "new" ? this->LIB.new_isbn([this](std::uint64_t book) { return this->UM.on_loan(book); }) : LibraryTypes::ISBN(isbn);
 				}
 				catch (const std::exception& e)
 				{
@@ -696,7 +853,7 @@ public:
 					return;
 				}
 
-				LibraryTypes::Book book = LibraryTypes::Book(name, author, isbn);
+				LibraryTypes::Book book = LibraryTypes::Book(name, author, code);
 
 				this->LIB.add(book);
 
@@ -831,11 +988,7 @@ public:
 
 				size_t index = static_cast<size_t>(cast);
 
-				LibraryTypes::Book checkout = this->LIB.books.at(index);
-
-				this->LIB.remove(checkout);
-
-				this->UM.add(checkout);
+				LibraryTypes::Book checkout = this->borrow_book(index);
 
 				UI::CLEAR();
 
@@ -844,6 +997,17 @@ public:
                         << "Borrowed book:\n"
                         << UI::DIVIDER << "\n"
                         << checkout.ToString();
+
+                std::vector<LibraryTypes::Book> picks = this->UM.also_borrowed(checkout);
+                if (!picks.empty())
+                {
+                    message << "\n" << UI::DIVIDER << "\n"
+                            << "Patrons who borrowed this also borrowed:";
+                    for (const LibraryTypes::Book& pick : picks)
+                    {
+                        message << "\n- " << pick.title << " by " << pick.author;
+                    }
+                }
                 UI::Console::print_message(message.str());
 
 				this->lib_reset_menu();
@@ -860,14 +1024,14 @@ public:
 			// Function
 			[this](const std::string&)
 			{
-				this->print_books(this->UM.current_user.books);
+				this->print_books(this->UM.loaned_books(this->UM.current_user));
 
 				UI::Question question;
                 std::stringstream message;
                 message << header()
                         << "Returning a book requires the index # of the book to return";
                 question.contents = message.str();
-				question.answers = std::gendsv(this->UM.current_user.books.size());
+				question.answers = std::gendsv(this->UM.current_user.loans.size());
 				question.type = UI::INPUT_TYPE::D;
 
 				auto res = UI::Console::print_question(question);
@@ -881,11 +1045,9 @@ public:
 
 				size_t index = static_cast<size_t>(cast);
 
-				LibraryTypes::Book checkin = this->UM.current_user.books.at(index);
-
-				this->UM.remove(index);
+				LibraryTypes::Book checkin = this->UM.book(this->UM.current_user.loans.at(index));
 
-				this->LIB.add(checkin);
+				std::string holder = this->return_book(index);
 
 				UI::CLEAR();
 
@@ -894,12 +1056,73 @@ public:
                         << "Returned book:\n"
                         << UI::DIVIDER << "\n"
                         << checkin.ToString();
+
+				if (!holder.empty())
+				{
+					message << "\n" << UI::DIVIDER << "\n"
+							<< "Handed to the next hold: " << holder;
+				}
+
                 UI::Console::print_message(message.str());
 
 				this->lib_reset_menu();
 			} 
 		};
 
+		/// @brief Handles the Library's Hold Prompt.
+		std::pair<std::string, std::function<void(const std::string&)>>
+			hold =
+		{
+			// Input
+			"3",
+
+			// Function
+			[this](const std::string&)
+			{
+				UI::CLEAR();
+
+				std::string isbn;
+
+                std::stringstream message;
+                message << header()
+                        << "Placing a hold requires the ISBN of a book\n"
+                        << "with no copy left in the library";
+                UI::Console::print_message(message.str());
+
+				isbn = UI::Console::read_line("ISBN: ");
+
+				message.str("");
+				message << header();
+
+				try
+				{
+					LibraryTypes::ISBN code = LibraryTypes::ISBN(isbn);
+
+					if (this->LIB.contains(code))
+					{
+						message << "A copy is available, borrow it instead";
+					}
+					else if (this->LIB.place_hold(code, this->UM.current_user.name))
+					{
+						message << "Hold placed for: " << isbn;
+					}
+					else
+					{
+						message << "You already hold: " << isbn;
+					}
+				}
+				catch (const std::exception& e)
+				{
+					message << "Invalid ISBN: " << isbn;
+				}
+
+				UI::CLEAR();
+				UI::Console::print_message(message.str());
+
+				this->lib_reset_menu();
+			}
+		};
+
 		UI::CLEAR();
 
 		UI::ActionQuestion question;
@@ -908,10 +1131,11 @@ public:
            << "What would you like to do?\n"
            << "1) Borrow Book\n"
            << "2) Return Book\n"
-           << "3) Main Menu\n"
-           << "4) Exit & Save";
+           << "3) Place Hold\n"
+           << "4) Main Menu\n"
+           << "5) Exit & Save";
         question.contents = ss.str();
-		question.answers = { "1", "2", "3", "4" };
+		question.answers = { "1", "2", "3", "4", "5" };
 		question.type = UI::INPUT_TYPE::D;
 		question.actions = {
 
@@ -921,11 +1145,14 @@ public:
 		// Handles the Return Prompt.
 		ret,
 
+		// Handles the Hold Prompt.
+		hold,
+
 		// Navigates to the Library's Main Menu
-		{"3", [this](const std::string&) { this->lib_main_menu(); }},
+		{"4", [this](const std::string&) { this->lib_main_menu(); }},
 
 		// Exit & Save
-		{"4", [this](const std::string&) { this->exit(); }},
+		{"5", [this](const std::string&) { this->exit(); }},
 		};
 
 		UI::Console::print_question(question);
@@ -0,0 +1,159 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace LibraryTypes
+{
+	/// A blocked Bloom filter over 64 bit keys.
+	/// Every key's bits fall inside one 64 byte block, so a lookup costs
+	/// a single cache line no matter how many hash functions are used.
+	/// It never reports a false "absent", so a miss can skip the real index.
+	class BloomFilter
+	{
+	private:
+
+		/// One cache line of bits.
+		struct alignas(64) Block
+		{
+			std::array<std::uint64_t, 8U> words{};
+		};
+
+		/// The bit blocks.
+		std::vector<Block> blocks;
+
+		/// Bits set per key.
+		std::uint32_t probes = 1;
+
+		/// Keys the filter was sized for.
+		size_t capacity = 0;
+
+		/// Keys inserted.
+		size_t count = 0;
+
+		/// The target false positive rate.
+		double fpr;
+
+		/// @brief Scrambles a key (SplitMix64 finalizer).
+		static std::uint64_t mix(std::uint64_t key)
+		{
+			key ^= key >> 30;
+			key *= 0xBF58476D1CE4E5B9ULL;
+			key ^= key >> 27;
+			key *= 0x94D049BB133111EBULL;
+			key ^= key >> 31;
+			return key;
+		}
+
+		/// @brief Picks a key's block from the hash's high half.
+		size_t block_of(std::uint64_t hash) const
+		{
+			return static_cast<size_t>(((hash >> 32) * blocks.size()) >> 32);
+		}
+
+	public:
+
+		/// @brief BloomFilter constructor.
+		/// @param rate The target false positive rate, in (0, 1).
+		/// @param keys The number of keys to size for.
+		explicit BloomFilter(double rate = 0.01, size_t keys = 1024) : fpr(rate)
+		{
+			reset(keys);
+		}
+
+		~BloomFilter() = default;
+
+		/// @brief Empties the filter and sizes it for a number of keys.
+		/// Blocking costs some accuracy, so a few bits per key are added
+		/// on top of the classic -log2(p) / ln 2.
+		/// @param keys The number of keys to size for.
+		void reset(size_t keys)
+		{
+			double rate = std::min(std::max(fpr, 1e-9), 0.5);
+			double bits_per_key = -std::log2(rate) / std::log(2.0) + 2.0;
+
+			capacity = std::max<size_t>(keys, 64);
+			probes = static_cast<std::uint32_t>(std::clamp(std::lround(bits_per_key * std::log(2.0)), 1L, 16L));
+
+			size_t bits = static_cast<size_t>(std::ceil(bits_per_key * static_cast<double>(capacity)));
+			blocks.assign((bits + 511) / 512, Block());
+			count = 0;
+		}
+
+		/// @brief Changes the target false positive rate; the filter is emptied.
+		/// @param rate The target false positive rate, in (0, 1).
+		void set_rate(double rate)
+		{
+			fpr = rate;
+			reset(capacity);
+		}
+
+		/// @brief Adds a key.
+		void insert(std::uint64_t key)
+		{
+			std::uint64_t hash = mix(key);
+			Block& block = blocks[block_of(hash)];
+
+			// Double hashing inside the block: bit i = h1 + i * h2 (mod 512)
+			std::uint32_t h1 = static_cast<std::uint32_t>(hash);
+			std::uint32_t h2 = static_cast<std::uint32_t>(mix(hash) >> 32) | 1U;
+			for (std::uint32_t i = 0; i < probes; i++) {
+				std::uint32_t bit = (h1 + i * h2) & 511U;
+				block.words[bit >> 6] |= 1ULL << (bit & 63U);
+			}
+
+			count++;
+		}
+
+		/// @brief Tests a key.
+		/// @returns False if the key was never inserted, true if it may have been.
+		bool may_contain(std::uint64_t key) const
+		{
+			std::uint64_t hash = mix(key);
+			const Block& block = blocks[block_of(hash)];
+
+			std::uint32_t h1 = static_cast<std::uint32_t>(hash);
+			std::uint32_t h2 = static_cast<std::uint32_t>(mix(hash) >> 32) | 1U;
+			for (std::uint32_t i = 0; i < probes; i++) {
+				std::uint32_t bit = (h1 + i * h2) & 511U;
+				if ((block.words[bit >> 6] & (1ULL << (bit & 63U))) == 0) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		/// @brief Whether more keys were inserted than the filter was sized for.
+		/// Past that point the false positive rate climbs, so the owner should
+		/// `reset` with a larger size and re-insert its keys.
+		bool full() const
+		{
+			return count > capacity;
+		}
+
+		/// @brief Gets the number of keys inserted.
+		size_t size() const
+		{
+			return count;
+		}
+
+		/// @brief Gets the target false positive rate.
+		double rate() const
+		{
+			return fpr;
+		}
+
+		/// @brief Gets the size of the bit array in bytes.
+		size_t bytes() const
+		{
+			return blocks.size() * sizeof(Block);
+		}
+	};
+}
+
+#endif // !BLOOM_H
@@ -0,0 +1,235 @@
+#ifndef BROWSE_H
+#define BROWSE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace LibraryTypes
+{
+	/// An ordered secondary index kept as sorted runs (chunks).
+	/// Inserting or erasing touches one chunk, and a Fenwick tree over
+	/// the chunk sizes finds the chunk holding the Nth entry in
+	/// O(log chunks), so a page of an alphabetical listing costs
+	/// O(log n + page) instead of sorting the catalog.
+	class SortedView
+	{
+	private:
+
+		/// Target chunk length; chunks split at twice this.
+		static constexpr size_t CHUNK = 128;
+
+		/// An entry - the sort key and the book's ISBN code.
+		struct Entry
+		{
+			std::string key;
+			std::string code;
+
+			bool operator<(const Entry& other) const
+			{
+				return key != other.key ? key < other.key : code < other.code;
+			}
+
+			bool operator==(const Entry& other) const
+			{
+				return key == other.key && code == other.code;
+			}
+		};
+
+		/// The sorted runs, in order.
+		std::vector<std::vector<Entry>> chunks;
+
+		/// Fenwick tree over the chunk sizes, 1-based.
+		std::vector<size_t> tree;
+
+		/// Number of entries.
+		size_t count = 0;
+
+		/// @brief Rebuilds the Fenwick tree after chunks split or vanish.
+		void rebuild_tree()
+		{
+			tree.assign(chunks.size() + 1, 0);
+
+			for (size_t i = 1; i <= chunks.size(); i++) {
+				tree[i] += chunks[i - 1].size();
+				size_t parent = i + (i & (~i + 1));
+				if (parent <= chunks.size()) {
+					tree[parent] += tree[i];
+				}
+			}
+		}
+
+		/// @brief Adjusts one chunk's size in the tree.
+		/// @param chunk The chunk index.
+		/// @param grow True to add one, false to remove one.
+		void tree_update(size_t chunk, bool grow)
+		{
+			for (size_t i = chunk + 1; i < tree.size(); i += i & (~i + 1)) {
+				tree[i] = grow ? tree[i] + 1 : tree[i] - 1;
+			}
+		}
+
+		/// @brief Finds the chunk holding the Nth entry.
+		/// @param n The entry position, less than `size()`.
+		/// @param offset Receives the position inside the chunk.
+		/// @returns The chunk index.
+		size_t locate(size_t n, size_t& offset) const
+		{
+			size_t pos = 0;
+			size_t step = 1;
+			while (step * 2 < tree.size()) {
+				step *= 2;
+			}
+
+			for (; step != 0; step /= 2) {
+				if (pos + step < tree.size() && tree[pos + step] <= n) {
+					pos += step;
+					n -= tree[pos];
+				}
+			}
+
+			offset = n;
+			return pos;
+		}
+
+		/// @brief Finds the chunk an entry belongs in.
+		/// @returns The first chunk whose last entry is not less than it.
+		size_t chunk_for(const Entry& entry) const
+		{
+			auto it = std::lower_bound(chunks.begin(), chunks.end(), entry,
+				[](const std::vector<Entry>& chunk, const Entry& value) { return chunk.back() < value; });
+
+			return static_cast<size_t>(it - chunks.begin());
+		}
+
+	public:
+
+		SortedView() = default;
+
+		~SortedView() = default;
+
+		/// @brief Rebuilds the view from unsorted entries.
+		/// @param keys The sort keys.
+		/// @param codes The ISBN codes, one per key.
+		void build(const std::vector<std::string>& keys, const std::vector<std::string>& codes)
+		{
+			std::vector<Entry> entries;
+			entries.reserve(keys.size());
+			for (size_t i = 0; i < keys.size(); i++) {
+				entries.push_back(Entry{ keys[i], codes[i] });
+			}
+
+			std::sort(entries.begin(), entries.end());
+
+			chunks.clear();
+			for (size_t i = 0; i < entries.size(); i += CHUNK) {
+				size_t end = std::min(entries.size(), i + CHUNK);
+				chunks.emplace_back(std::make_move_iterator(entries.begin() + i), std::make_move_iterator(entries.begin() + end));
+			}
+
+			count = entries.size();
+			rebuild_tree();
+		}
+
+		/// @brief Adds an entry.
+		/// @param key The sort key.
+		/// @param code The book's ISBN code.
+		void insert(const std::string& key, const std::string& code)
+		{
+			Entry entry{ key, code };
+			count++;
+
+			if (chunks.empty()) {
+				chunks.push_back({ entry });
+				rebuild_tree();
+				return;
+			}
+
+			size_t c = std::min(chunk_for(entry), chunks.size() - 1);
+			std::vector<Entry>& chunk = chunks[c];
+			chunk.insert(std::upper_bound(chunk.begin(), chunk.end(), entry), entry);
+
+			if (chunk.size() < 2 * CHUNK) {
+				tree_update(c, true);
+				return;
+			}
+
+			std::vector<Entry> upper(std::make_move_iterator(chunk.begin() + CHUNK), std::make_move_iterator(chunk.end()));
+			chunk.resize(CHUNK);
+			chunks.insert(chunks.begin() + static_cast<std::ptrdiff_t>(c) + 1, std::move(upper));
+			rebuild_tree();
+		}
+
+		/// @brief Removes an entry.
+		/// @param key The sort key.
+		/// @param code The book's ISBN code.
+		/// @returns False if the entry was not in the view.
+		bool erase(const std::string& key, const std::string& code)
+		{
+			Entry entry{ key, code };
+			size_t c = chunk_for(entry);
+			if (c == chunks.size()) {
+				return false;
+			}
+
+			std::vector<Entry>& chunk = chunks[c];
+			auto it = std::lower_bound(chunk.begin(), chunk.end(), entry);
+			if (it == chunk.end() || !(*it == entry)) {
+				return false;
+			}
+
+			chunk.erase(it);
+			count--;
+
+			if (chunk.empty()) {
+				chunks.erase(chunks.begin() + static_cast<std::ptrdiff_t>(c));
+				rebuild_tree();
+			}
+			else {
+				tree_update(c, false);
+			}
+
+			return true;
+		}
+
+		/// @brief Lists entries in order.
+		/// @param first The position of the first entry.
+		/// @param n The number of entries.
+		/// @returns The ISBN codes of the entries.
+		std::vector<std::string> range(size_t first, size_t n) const
+		{
+			std::vector<std::string> res;
+			if (first >= count) {
+				return res;
+			}
+
+			size_t offset = 0;
+			size_t c = locate(first, offset);
+
+			for (; c < chunks.size() && res.size() < n; c++, offset = 0) {
+				for (size_t i = offset; i < chunks[c].size() && res.size() < n; i++) {
+					res.push_back(chunks[c][i].code);
+				}
+			}
+
+			return res;
+		}
+
+		/// @brief Gets the number of entries.
+		size_t size() const
+		{
+			return count;
+		}
+
+		/// @brief Removes every entry.
+		void clear()
+		{
+			chunks.clear();
+			tree.clear();
+			count = 0;
+		}
+	};
+}
+
+#endif // !BROWSE_H
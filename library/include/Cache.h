@@ -0,0 +1,175 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Rank.h"
+
+namespace LibraryTypes
+{
+	/// Hit & miss counters of a `QueryCache`.
+	struct CacheStats
+	{
+		/// Lookups answered from the cache.
+		std::uint64_t hits = 0;
+
+		/// Lookups that had to be computed.
+		std::uint64_t misses = 0;
+
+		/// Entries dropped to make room.
+		std::uint64_t evictions = 0;
+
+		/// Entries dropped because the catalog changed.
+		std::uint64_t stale = 0;
+	};
+
+	/// A least-recently-used cache of ranked search results.
+	/// Each entry is stamped with the catalog generation it was computed
+	/// at; the owner bumps its generation on every change that could alter
+	/// a result, so stale entries are never served.
+	class QueryCache
+	{
+	private:
+
+		/// A cached result.
+		struct Entry
+		{
+			std::string key;
+			std::uint64_t generation;
+			std::vector<Hit> hits;
+		};
+
+		/// Entries, most recently used first.
+		std::list<Entry> entries;
+
+		/// Lookup - Key: query key - Value: position in `entries`.
+		std::unordered_map<std::string, std::list<Entry>::iterator> lookup;
+
+		/// Maximum number of entries.
+		size_t capacity;
+
+		/// Counters since construction or `reset_stats`.
+		CacheStats counters;
+
+	public:
+
+		/// Default number of cached queries.
+		static constexpr size_t DEFAULT_CAPACITY = 256;
+
+		/// @brief QueryCache constructor.
+		/// @param capacity The number of queries to keep, 0 disables caching.
+		explicit QueryCache(size_t capacity = DEFAULT_CAPACITY) : capacity(capacity) { }
+
+		/// Copies start empty; `lookup` points into the source's list.
+		QueryCache(const QueryCache& other) : capacity(other.capacity) { }
+
+		QueryCache& operator=(const QueryCache& other)
+		{
+			if (this != &other) {
+				clear();
+				capacity = other.capacity;
+			}
+
+			return *this;
+		}
+
+		~QueryCache() = default;
+
+		/// @brief Finds a cached result.
+		/// @param key The query key.
+		/// @param generation The current catalog generation.
+		/// @returns The hits, or nullptr on a miss.
+		const std::vector<Hit>* find(const std::string& key, std::uint64_t generation)
+		{
+			auto pair = lookup.find(key);
+			if (pair == lookup.end()) {
+				counters.misses++;
+				return nullptr;
+			}
+
+			if (pair->second->generation != generation) {
+				entries.erase(pair->second);
+				lookup.erase(pair);
+				counters.stale++;
+				counters.misses++;
+				return nullptr;
+			}
+
+			entries.splice(entries.begin(), entries, pair->second);
+			counters.hits++;
+			return &pair->second->hits;
+		}
+
+		/// @brief Caches a result, evicting the least recently used one if full.
+		/// @param key The query key.
+		/// @param generation The catalog generation the hits were computed at.
+		/// @param hits The hits.
+		void store(const std::string& key, std::uint64_t generation, std::vector<Hit> hits)
+		{
+			if (capacity == 0) {
+				return;
+			}
+
+			auto pair = lookup.find(key);
+			if (pair != lookup.end()) {
+				pair->second->generation = generation;
+				pair->second->hits = std::move(hits);
+				entries.splice(entries.begin(), entries, pair->second);
+				return;
+			}
+
+			if (entries.size() >= capacity) {
+				lookup.erase(entries.back().key);
+				entries.pop_back();
+				counters.evictions++;
+			}
+
+			entries.push_front(Entry{ key, generation, std::move(hits) });
+			lookup[key] = entries.begin();
+		}
+
+		/// @brief Drops every entry.
+		void clear()
+		{
+			entries.clear();
+			lookup.clear();
+		}
+
+		/// @brief Changes the capacity, evicting the oldest entries.
+		/// @param size The number of queries to keep, 0 disables caching.
+		void resize(size_t size)
+		{
+			capacity = size;
+			while (entries.size() > capacity) {
+				lookup.erase(entries.back().key);
+				entries.pop_back();
+				counters.evictions++;
+			}
+		}
+
+		/// @brief Gets the number of cached queries.
+		size_t size() const
+		{
+			return entries.size();
+		}
+
+		/// @brief Gets the hit & miss counters.
+		const CacheStats& stats() const
+		{
+			return counters;
+		}
+
+		/// @brief Zeroes the counters.
+		void reset_stats()
+		{
+			counters = CacheStats();
+		}
+	};
+}
+
+#endif // !CACHE_H
@@ -0,0 +1,225 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Text.h"
+
+namespace LibraryTypes
+{
+	/// A columnar (structure-of-arrays) layout of a book list.
+	/// ISBNs are stored as packed integers, titles and authors as
+	/// offset/length columns into one shared byte buffer, and
+	/// availability as a bitmap. Rows match the order of `Library::books`.
+	class ColumnarCatalog
+	{
+	private:
+
+		/// Packed 13 digit ISBN codes.
+		std::vector<std::uint64_t> isbns;
+
+		/// Title offsets into `bytes`.
+		std::vector<std::uint32_t> title_offsets;
+
+		/// Title lengths.
+		std::vector<std::uint32_t> title_lengths;
+
+		/// Author offsets into `bytes`.
+		std::vector<std::uint32_t> author_offsets;
+
+		/// Author lengths.
+		std::vector<std::uint32_t> author_lengths;
+
+		/// Shared buffer holding every title & author back to back.
+		std::string bytes;
+
+		/// Availability bitmap, one bit per row.
+		std::vector<std::uint64_t> available;
+
+		/// @brief Scans a string column for a term.
+		/// @param offsets The column offsets.
+		/// @param lengths The column lengths.
+		/// @param term The search term, matched ignoring case.
+		/// @returns The matching rows in order.
+		std::vector<size_t> scan(
+			const std::vector<std::uint32_t>& offsets,
+			const std::vector<std::uint32_t>& lengths,
+			std::string_view term) const
+		{
+			std::vector<size_t> rows;
+			const char* base = bytes.data();
+
+			for (size_t row = 0; row < offsets.size(); row++) {
+				if (Text::icontains(std::string_view(base + offsets[row], lengths[row]), term)) {
+					rows.push_back(row);
+				}
+			}
+
+			return rows;
+		}
+
+	public:
+
+		ColumnarCatalog() = default;
+
+		~ColumnarCatalog() = default;
+
+		/// @brief Removes every row.
+		void clear()
+		{
+			isbns.clear();
+			title_offsets.clear();
+			title_lengths.clear();
+			author_offsets.clear();
+			author_lengths.clear();
+			bytes.clear();
+			available.clear();
+		}
+
+		/// @brief Reserves room for a number of rows.
+		/// @param rows The expected number of rows.
+		/// @param text The expected number of title & author bytes.
+		void reserve(size_t rows, size_t text)
+		{
+			isbns.reserve(rows);
+			title_offsets.reserve(rows);
+			title_lengths.reserve(rows);
+			author_offsets.reserve(rows);
+			author_lengths.reserve(rows);
+			available.reserve((rows + 63) / 64);
+			bytes.reserve(text);
+		}
+
+		/// @brief Appends a row.
+		/// @param title The title.
+		/// @param author The author.
+		/// @param isbn The packed ISBN.
+		/// @param is_available The initial availability.
+		void append(std::string_view title, std::string_view author, std::uint64_t isbn, bool is_available = true)
+		{
+			size_t row = isbns.size();
+
+			isbns.push_back(isbn);
+
+			title_offsets.push_back(static_cast<std::uint32_t>(bytes.size()));
+			title_lengths.push_back(static_cast<std::uint32_t>(title.size()));
+			bytes.append(title);
+
+			author_offsets.push_back(static_cast<std::uint32_t>(bytes.size()));
+			author_lengths.push_back(static_cast<std::uint32_t>(author.size()));
+			bytes.append(author);
+
+			if (row / 64 == available.size()) {
+				available.push_back(0);
+			}
+
+			set_available(row, is_available);
+		}
+
+		/// @brief Gets the number of rows.
+		size_t size() const
+		{
+			return isbns.size();
+		}
+
+		/// @brief Gets the packed ISBN of a row.
+		std::uint64_t isbn(size_t row) const
+		{
+			return isbns[row];
+		}
+
+		/// @brief Gets the title of a row.
+		std::string_view title(size_t row) const
+		{
+			return std::string_view(bytes.data() + title_offsets[row], title_lengths[row]);
+		}
+
+		/// @brief Gets the author of a row.
+		std::string_view author(size_t row) const
+		{
+			return std::string_view(bytes.data() + author_offsets[row], author_lengths[row]);
+		}
+
+		/// @brief Gets the availability of a row.
+		bool is_available(size_t row) const
+		{
+			return (available[row / 64] >> (row % 64)) & 1U;
+		}
+
+		/// @brief Sets the availability of a row.
+		/// @param row The row.
+		/// @param value The availability.
+		void set_available(size_t row, bool value)
+		{
+			std::uint64_t bit = std::uint64_t(1) << (row % 64);
+
+			if (value) {
+				available[row / 64] |= bit;
+			}
+			else {
+				available[row / 64] &= ~bit;
+			}
+		}
+
+		/// @brief Counts the available rows, one word at a time.
+		/// @returns The count of available rows.
+		size_t count_available() const
+		{
+			size_t count = 0;
+			for (std::uint64_t word : available) {
+				count += std::bitset<64>(word).count();
+			}
+
+			return count;
+		}
+
+		/// @brief Finds a row by packed ISBN.
+		/// @param isbn The packed ISBN.
+		/// @returns The row, or `size()` if not found.
+		size_t find_isbn(std::uint64_t isbn) const
+		{
+			for (size_t row = 0; row < isbns.size(); row++) {
+				if (isbns[row] == isbn) {
+					return row;
+				}
+			}
+
+			return isbns.size();
+		}
+
+		/// @brief Scans the title column.
+		/// @param term The search term, matched ignoring case.
+		/// @returns The matching rows in order.
+		std::vector<size_t> find_title(std::string_view term) const
+		{
+			return scan(title_offsets, title_lengths, term);
+		}
+
+		/// @brief Scans the author column.
+		/// @param term The search term, matched ignoring case.
+		/// @returns The matching rows in order.
+		std::vector<size_t> find_author(std::string_view term) const
+		{
+			return scan(author_offsets, author_lengths, term);
+		}
+
+		/// @brief Counts the rows of every author.
+		/// @returns Map of author to number of rows.
+		std::unordered_map<std::string, size_t> author_counts() const
+		{
+			std::unordered_map<std::string, size_t> counts;
+			for (size_t row = 0; row < isbns.size(); row++) {
+				counts[std::string(author(row))]++;
+			}
+
+			return counts;
+		}
+	};
+}
+
+#endif // !CATALOG_H
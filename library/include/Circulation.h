@@ -0,0 +1,322 @@
+#ifndef CIRCULATION_H
+#define CIRCULATION_H
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "LibTypes.h"
+#include "User.h"
+
+/// A batch of borrows & returns applied as one transaction.
+/// The whole batch is validated before anything changes, so it either
+/// applies completely or not at all, and the users & catalog are each
+/// written to disk once instead of once per book.
+/// Returns are applied before borrows, so a returned copy can be
+/// borrowed again in the same batch.
+class Circulation
+{
+private:
+
+	/// A queued operation.
+	struct Op
+	{
+		/// The user borrowing or returning.
+		std::string user;
+
+		/// The book's ISBN.
+		LibraryTypes::ISBN isbn;
+	};
+
+	/// Holds off saving for a scope.
+	/// `end` ends the deferral & saves; if the scope is left early, e.g.
+	/// by an exception, the destructor ends it so saving is never left off.
+	/// @tparam Target A `Library` or `UserManager`.
+	template <typename Target>
+	class DeferredSaves
+	{
+	private:
+
+		/// The object whose saves are deferred.
+		Target& target;
+
+		/// Whether the deferral is still in force.
+		bool active = true;
+
+	public:
+
+		/// @brief DeferredSaves constructor; starts deferring.
+		explicit DeferredSaves(Target& target) : target(target)
+		{
+			target.defer_saves();
+		}
+
+		DeferredSaves(const DeferredSaves&) = delete;
+		DeferredSaves& operator=(const DeferredSaves&) = delete;
+
+		/// Ends the deferral if `end` was not reached.
+		/// A failed save here is dropped, as an exception may be in flight.
+		~DeferredSaves()
+		{
+			if (active)
+			{
+				try
+				{
+					target.flush();
+				}
+				catch (...)
+				{
+				}
+			}
+		}
+
+		/// @brief Ends the deferral, saving once if anything changed.
+		void end()
+		{
+			active = false;
+			target.flush();
+		}
+	};
+
+	/// The users of the transaction.
+	UserManager& UM;
+
+	/// The catalog of the transaction.
+	LibraryTypes::Library& LIB;
+
+	/// Queued borrows.
+	std::vector<Op> borrows;
+
+	/// Queued returns.
+	std::vector<Op> returns;
+
+	/// Why the last `validate` or `commit` failed.
+	std::string reason;
+
+	/// @brief Fails validation.
+	/// @param message Why.
+	/// @returns Always false.
+	bool fail(const std::string& message)
+	{
+		reason = message;
+		return false;
+	}
+
+	/// @brief Applies the batch: returns first, then borrows.
+	/// @param lib The catalog to apply it to.
+	/// @param users The users to apply it to.
+	/// @returns False if an operation failed; the targets are left part way.
+	bool apply(LibraryTypes::Library& lib, UserManager& users)
+	{
+		std::vector<LibraryTypes::Book> restocked;
+		for (const Op& op : returns)
+		{
+			std::optional<LibraryTypes::Book> returned = users.check_in(op.user, op.isbn.packed());
+			if (!returned)
+			{
+				return fail(op.user + " has no loan of: " + op.isbn.code);
+			}
+			LibraryTypes::Book book = *returned;
+
+			bool handed = false;
+			while (std::optional<std::string> holder = lib.next_holder(book))
+			{
+				if (users.lend(*holder, book))
+				{
+					lib.record_borrow(book);
+					handed = true;
+					break;
+				}
+			}
+
+			if (!handed)
+			{
+				restocked.push_back(book);
+			}
+		}
+		lib.restock(restocked);
+
+		std::vector<LibraryTypes::ISBN> isbns;
+		isbns.reserve(borrows.size());
+		for (const Op& op : borrows)
+		{
+			isbns.push_back(op.isbn);
+		}
+
+		std::vector<LibraryTypes::Book> taken = lib.take(isbns);
+		if (taken.size() != borrows.size())
+		{
+			return fail("Not every book to lend is on the shelf");
+		}
+
+		for (size_t i = 0; i < taken.size(); i++)
+		{
+			if (!users.lend(borrows[i].user, taken[i]))
+			{
+				return fail("No user named: " + borrows[i].user);
+			}
+			lib.record_borrow(taken[i]);
+		}
+
+		return true;
+	}
+
+public:
+
+	/// @brief Circulation constructor.
+	/// @param um The users to lend to.
+	/// @param lib The catalog to lend from.
+	Circulation(UserManager& um, LibraryTypes::Library& lib) : UM(um), LIB(lib) { }
+
+	~Circulation() { }
+
+	/// @brief Queues a borrow.
+	/// @param user The borrower's name.
+	/// @param isbn The book's ISBN.
+	Circulation& borrow(const std::string& user, const LibraryTypes::ISBN& isbn)
+	{
+		borrows.push_back(Op{ user, isbn });
+		return *this;
+	}
+
+	/// @brief Queues a return.
+	/// The loan must be held when the batch starts.
+	/// @param user The borrower's name.
+	/// @param isbn The book's ISBN.
+	Circulation& give_back(const std::string& user, const LibraryTypes::ISBN& isbn)
+	{
+		returns.push_back(Op{ user, isbn });
+		return *this;
+	}
+
+	/// @brief Checks the batch against the current state without changing it.
+	/// Copies returned while patrons hold the title are assumed to go to
+	/// them, so a batch that validates always commits.
+	/// @returns False if any operation would fail; see `error`.
+	bool validate()
+	{
+		reason.clear();
+
+		// Loans held per user & book, and shelf copies per packed ISBN
+		std::unordered_map<std::string, std::unordered_map<std::uint64_t, size_t>> loans;
+		std::unordered_map<std::uint64_t, size_t> shelf;
+		std::unordered_map<std::uint64_t, size_t> waiting;
+
+		for (const std::vector<Op>* ops : { &returns, &borrows })
+		{
+			for (const Op& op : *ops)
+			{
+				const User* user = UM.find(op.user);
+				if (user == nullptr)
+				{
+					return fail("No user named: " + op.user);
+				}
+
+				if (loans.count(op.user) == 0)
+				{
+					for (const Loan& loan : user->loans)
+					{
+						loans[op.user][loan.book]++;
+					}
+				}
+
+				shelf[op.isbn.packed()] = 0;
+			}
+		}
+
+		for (const LibraryTypes::Book& book : LIB.books)
+		{
+			auto pair = shelf.find(book.isbn.packed());
+			if (pair != shelf.end())
+			{
+				pair->second++;
+			}
+		}
+
+		for (const Op& op : returns)
+		{
+			std::uint64_t id = op.isbn.packed();
+			size_t& held = loans[op.user][id];
+			if (held == 0)
+			{
+				return fail(op.user + " has not borrowed: " + op.isbn.code);
+			}
+			held--;
+
+			if (waiting.count(id) == 0)
+			{
+				waiting[id] = LIB.holds_waiting(UM.book(Loan(id)));
+			}
+
+			if (waiting[id] != 0)
+			{
+				waiting[id]--;
+			}
+			else
+			{
+				shelf[id]++;
+			}
+		}
+
+		for (const Op& op : borrows)
+		{
+			size_t& copies = shelf[op.isbn.packed()];
+			if (copies == 0)
+			{
+				return fail("No copy left of: " + op.isbn.code);
+			}
+			copies--;
+		}
+
+		return true;
+	}
+
+	/// @brief Validates & applies the batch, then saves once.
+	/// The batch runs on copies of the users & catalog, which replace
+	/// them only once every operation went through, so a batch that fails
+	/// part way leaves both as they were. Saving already writes every
+	/// user & book, so the copies cost the same order as the save.
+	/// @returns False if the batch failed; nothing was changed.
+	bool commit()
+	{
+		if (!validate())
+		{
+			return false;
+		}
+
+		DeferredSaves<LibraryTypes::Library> lib_saves(LIB);
+		DeferredSaves<UserManager> um_saves(UM);
+
+		// Copied while deferred, so the copies hold their saves back too
+		LibraryTypes::Library lib = LIB;
+		UserManager users = UM;
+		if (!apply(lib, users))
+		{
+			return false;
+		}
+
+		LIB = lib;
+		UM = users;
+		lib_saves.end();
+		um_saves.end();
+
+		borrows.clear();
+		returns.clear();
+		return true;
+	}
+
+	/// @brief Gets why the last `validate` or `commit` failed.
+	const std::string& error() const
+	{
+		return reason;
+	}
+
+	/// @brief Gets the number of queued operations.
+	size_t size() const
+	{
+		return borrows.size() + returns.size();
+	}
+};
+
+#endif // !CIRCULATION_H
@@ -0,0 +1,210 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace LibraryTypes
+{
+	/// xoshiro256** - a small, fast, seedable PRNG.
+	/// Meets UniformRandomBitGenerator, so it also works with <random>.
+	class Xoshiro256
+	{
+	private:
+
+		/// The generator state.
+		std::uint64_t s[4];
+
+		static std::uint64_t rotl(std::uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+	public:
+
+		using result_type = std::uint64_t;
+
+		/// @brief Xoshiro256 constructor.
+		/// The state is expanded from the seed with SplitMix64.
+		/// @param seed The seed; equal seeds give equal sequences.
+		explicit Xoshiro256(std::uint64_t seed = 0)
+		{
+			for (std::uint64_t& word : s) {
+				seed += 0x9E3779B97F4A7C15ULL;
+				std::uint64_t z = seed;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				word = z ^ (z >> 31);
+			}
+		}
+
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+		/// @brief Gets the next 64 random bits.
+		result_type operator()()
+		{
+			const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+			const std::uint64_t t = s[1] << 17;
+
+			s[2] ^= s[0];
+			s[3] ^= s[1];
+			s[1] ^= s[2];
+			s[0] ^= s[3];
+			s[2] ^= t;
+			s[3] = rotl(s[3], 45);
+
+			return result;
+		}
+	};
+
+	/// Generates ISBN-13 codes shaped `978-D-DD-DDDDDD-C`.
+	/// The 9 digits between the prefix and the check digit (the
+	/// publication space) come from a keyed pseudorandom permutation of a
+	/// counter, so one generator never repeats a code until all 10^9 are
+	/// used, and the same seed always yields the same sequence.
+	/// Digits are written straight into a fixed buffer.
+	class IsbnGenerator
+	{
+	public:
+
+		/// Characters in a generated code.
+		static constexpr size_t LENGTH = 17;
+
+		/// Size of the publication space.
+		static constexpr std::uint32_t SPACE = 1000000000U;
+
+	private:
+
+		/// Feistel round keys.
+		std::uint32_t keys[4];
+
+		/// The seed the round keys came from.
+		std::uint64_t origin = 0;
+
+		/// Codes handed out so far.
+		std::uint32_t counter = 0;
+
+		/// @brief A keyed permutation of [0, 2^30), as a 4 round Feistel network.
+		std::uint32_t feistel(std::uint32_t x) const
+		{
+			std::uint32_t left = x >> 15;
+			std::uint32_t right = x & 0x7FFFU;
+
+			for (std::uint32_t key : keys) {
+				std::uint32_t mixed = ((right ^ key) * 0x9E3779B1U) >> 17;
+				std::uint32_t next = (left ^ mixed) & 0x7FFFU;
+				left = right;
+				right = next;
+			}
+
+			return (left << 15) | right;
+		}
+
+		/// @brief A keyed permutation of [0, SPACE).
+		/// Cycle walking: values past the space are permuted again until
+		/// they land inside it, which keeps the mapping one to one.
+		std::uint32_t permute(std::uint32_t x) const
+		{
+			do {
+				x = feistel(x);
+			} while (x >= SPACE);
+
+			return x;
+		}
+
+	public:
+
+		/// @brief IsbnGenerator constructor.
+		/// @param seed The seed; equal seeds give equal sequences.
+		/// @param used Codes already handed out, to resume a saved generator.
+		explicit IsbnGenerator(std::uint64_t seed = 0, std::uint32_t used = 0)
+			: origin(seed), counter(std::min(used, SPACE))
+		{
+			Xoshiro256 rng(seed);
+			for (std::uint32_t& key : keys) {
+				key = static_cast<std::uint32_t>(rng() >> 32);
+			}
+		}
+
+		/// @brief Writes a code from its 9 publication digits.
+		/// @param value The publication digits as a number below `SPACE`.
+		/// @param out Receives `LENGTH` characters.
+		static void write(std::uint32_t value, char* out)
+		{
+			static constexpr char TEMPLATE[LENGTH + 1] = "978-0-00-000000-0";
+			static constexpr std::uint8_t SLOTS[9] = { 4, 6, 7, 9, 10, 11, 12, 13, 14 };
+
+			for (size_t i = 0; i < LENGTH; i++) {
+				out[i] = TEMPLATE[i];
+			}
+
+			// 9*1 + 7*3 + 8*1 for the prefix, then weights 3,1,3... for the rest
+			std::uint32_t sum = 38;
+			for (size_t i = 9; i-- > 0; value /= 10) {
+				std::uint32_t digit = value % 10;
+				out[SLOTS[i]] = static_cast<char>('0' + digit);
+				sum += (i % 2 == 0) ? digit * 3 : digit;
+			}
+
+			out[16] = static_cast<char>('0' + (10 - sum % 10) % 10);
+		}
+
+		/// @brief Writes a random code; codes may repeat.
+		/// @param rng Any UniformRandomBitGenerator with 64 bit results.
+		/// @param out Receives `LENGTH` characters.
+		template <typename Rng>
+		static void random(Rng& rng, char* out)
+		{
+			// Multiply-shift maps 32 random bits onto the space without a division
+			std::uint64_t bits = static_cast<std::uint32_t>(rng() >> 32);
+			write(static_cast<std::uint32_t>((bits * SPACE) >> 32), out);
+		}
+
+		/// @brief Writes the next unique code.
+		/// @param out Receives `LENGTH` characters.
+		/// @throws std::runtime_error once every code was handed out.
+		void next(char* out)
+		{
+			if (counter == SPACE) {
+				throw std::runtime_error("ISBN space exhausted");
+			}
+
+			write(permute(counter++), out);
+		}
+
+		/// @brief Gets the next unique code.
+		std::string next()
+		{
+			std::string code(LENGTH, '\0');
+			next(&code[0]);
+			return code;
+		}
+
+		/// @brief Gets the number of codes handed out.
+		std::uint32_t used() const
+		{
+			return counter;
+		}
+
+		/// @brief Gets the seed, to save the generator with `used`.
+		std::uint64_t seed() const
+		{
+			return origin;
+		}
+
+		/// @brief Draws a seed from the system's entropy source.
+		static std::uint64_t random_seed()
+		{
+			std::random_device device;
+			return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+		}
+	};
+}
+
+#endif // !GENERATOR_H
@@ -0,0 +1,239 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+#include "LibTypes.h"
+
+namespace LibraryTypes
+{
+	/// A sparse book x book co-borrow count matrix.
+	/// Each row keeps at most `ROW` neighbours sorted by count, so the
+	/// top neighbours of a book are read straight off the front of its
+	/// row. A full row makes room with the Space-Saving rule: the least
+	/// counted neighbour is replaced and its count carried over, which
+	/// keeps frequent neighbours while bounding memory per book.
+	class CoBorrow
+	{
+	public:
+
+		/// A neighbour and how often it was borrowed by the same patrons.
+		struct Neighbor
+		{
+			std::uint64_t book;
+			std::uint32_t count;
+		};
+
+		/// Neighbours kept per book.
+		static constexpr size_t ROW = 32;
+
+	private:
+
+		/// Rows - Key: packed ISBN - Value: neighbours, highest count first.
+		std::unordered_map<std::uint64_t, std::vector<Neighbor>> rows;
+
+		/// @brief Counts one co-borrow in a row.
+		void bump(std::uint64_t book, std::uint64_t other)
+		{
+			std::vector<Neighbor>& row = rows[book];
+
+			auto it = std::find_if(row.begin(), row.end(), [other](const Neighbor& n) { return n.book == other; });
+			if (it == row.end()) {
+				if (row.size() < ROW) {
+					row.push_back(Neighbor{ other, 0 });
+				}
+				else {
+					row.back().book = other;
+				}
+				it = row.end() - 1;
+			}
+
+			it->count++;
+
+			// One insertion sort step keeps the row ordered
+			while (it != row.begin() && (it - 1)->count < it->count) {
+				std::iter_swap(it - 1, it);
+				--it;
+			}
+		}
+
+	public:
+
+		/// @brief Records that two books were borrowed by the same patron.
+		void add(std::uint64_t a, std::uint64_t b)
+		{
+			if (a == b) {
+				return;
+			}
+
+			bump(a, b);
+			bump(b, a);
+		}
+
+		/// @brief Gets a book's most co-borrowed neighbours.
+		/// @param book The packed ISBN.
+		/// @param n The number of neighbours.
+		/// @returns Up to `n` neighbours, highest count first.
+		std::vector<Neighbor> neighbors(std::uint64_t book, size_t n) const
+		{
+			auto pair = rows.find(book);
+			if (pair == rows.end()) {
+				return {};
+			}
+
+			const std::vector<Neighbor>& row = pair->second;
+			return std::vector<Neighbor>(row.begin(), row.begin() + static_cast<std::ptrdiff_t>(std::min(n, row.size())));
+		}
+
+		/// @brief Removes every count.
+		void clear()
+		{
+			rows.clear();
+		}
+	};
+
+	/// One loan in the history.
+	struct LoanEvent
+	{
+		/// The borrower's name.
+		std::string user;
+
+		/// The book's packed ISBN.
+		std::uint64_t book;
+
+		/// The day the loan started.
+		std::int64_t day;
+	};
+
+	/// Append-only log of every loan, kept after the loan ends.
+	/// Each loan updates the co-borrow matrix against the patron's
+	/// earlier books, so "borrowed this also borrowed" is precomputed.
+	class LoanHistory
+	{
+	private:
+
+		/// Every loan, oldest first.
+		std::vector<LoanEvent> events;
+
+		/// Details of every book ever borrowed - Key: packed ISBN.
+		std::unordered_map<std::uint64_t, Book> books;
+
+		/// Distinct books per patron - Key: name - Value: packed ISBNs.
+		std::unordered_map<std::string, std::vector<std::uint64_t>> borrowed;
+
+		/// Co-borrow counts.
+		CoBorrow matrix;
+
+	public:
+
+		/// @brief Appends a loan.
+		/// @param user The borrower's name.
+		/// @param book The book.
+		/// @param day The day the loan started.
+		void record(const std::string& user, const Book& book, std::int64_t day)
+		{
+			std::uint64_t id = book.isbn.packed();
+			events.push_back(LoanEvent{ user, id, day });
+			books[id] = book;
+
+			// A re-borrow adds nothing new to the patron's pairs
+			std::vector<std::uint64_t>& mine = borrowed[user];
+			if (std::find(mine.begin(), mine.end(), id) != mine.end()) {
+				return;
+			}
+
+			for (std::uint64_t other : mine) {
+				matrix.add(id, other);
+			}
+			mine.push_back(id);
+		}
+
+		/// @brief Gets books most often borrowed by the patrons of a book.
+		/// @param book The book.
+		/// @param n The number of books.
+		/// @returns Up to `n` books, most co-borrowed first.
+		std::vector<Book> recommend(const Book& book, size_t n = 5) const
+		{
+			std::vector<Book> res;
+			for (const CoBorrow::Neighbor& neighbor : matrix.neighbors(book.isbn.packed(), n)) {
+				res.push_back(books.at(neighbor.book));
+			}
+
+			return res;
+		}
+
+		/// @brief Gets the details of a book that was ever borrowed.
+		/// @param id The packed ISBN.
+		/// @returns The book, or null if it was never borrowed.
+		const Book* book(std::uint64_t id) const
+		{
+			auto pair = books.find(id);
+			return pair == books.end() ? nullptr : &pair->second;
+		}
+
+		/// @brief Gets the co-borrow counts.
+		const CoBorrow& co_borrows() const
+		{
+			return matrix;
+		}
+
+		/// @brief Gets every loan, oldest first.
+		const std::vector<LoanEvent>& loans() const
+		{
+			return events;
+		}
+
+		/// @brief Gets the number of loans.
+		size_t size() const
+		{
+			return events.size();
+		}
+
+		/// @brief Writes a loan as one line of the log.
+		/// @param index The loan's position.
+		std::string line(size_t index) const
+		{
+			const LoanEvent& event = events.at(index);
+			nlohmann::json j = books.at(event.book);
+			j["user"] = event.user;
+			j["day"] = event.day;
+			return j.dump();
+		}
+
+		/// @brief Replays one line of the log.
+		/// @param text A line written by `line`.
+		/// @returns False if the line is malformed, e.g. torn by a crash.
+		bool replay(const std::string& text)
+		{
+			nlohmann::json j = nlohmann::json::parse(text, nullptr, false);
+			if (j.is_discarded() || !j.is_object() || !j.contains("user") || !j.contains("day")) {
+				return false;
+			}
+
+			try {
+				record(j.at("user").get<std::string>(), j.get<Book>(), j.at("day").get<std::int64_t>());
+			}
+			catch (const std::exception&) {
+				return false;
+			}
+
+			return true;
+		}
+
+		/// @brief Removes every loan.
+		void clear()
+		{
+			events.clear();
+			books.clear();
+			borrowed.clear();
+			matrix.clear();
+		}
+	};
+}
+
+#endif // !HISTORY_H
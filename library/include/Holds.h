@@ -0,0 +1,265 @@
+#ifndef HOLDS_H
+#define HOLDS_H
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+namespace LibraryTypes
+{
+	/// Per-title FIFO hold queues.
+	/// Every queue is an intrusive singly linked list threaded through
+	/// one shared node pool, so a hold costs 8 bytes plus its book's
+	/// queue header, and both placing and serving a hold are O(1).
+	/// Patron names are interned once and referenced by index.
+	class HoldQueues
+	{
+	private:
+
+		/// End of list marker.
+		static constexpr std::uint32_t NIL = std::numeric_limits<std::uint32_t>::max();
+
+		/// A hold - the patron and the next hold for the same book.
+		struct Node
+		{
+			std::uint32_t user;
+			std::uint32_t next;
+		};
+
+		/// A book's queue - first & last hold, and its length.
+		struct Queue
+		{
+			std::uint32_t head;
+			std::uint32_t tail;
+			std::uint32_t size;
+		};
+
+		/// The node pool shared by every queue.
+		std::vector<Node> nodes;
+
+		/// First free node in the pool.
+		std::uint32_t free_head = NIL;
+
+		/// Map of queues - Key: packed ISBN - Value: queue.
+		std::unordered_map<std::uint64_t, Queue> queues;
+
+		/// Interned patron names.
+		std::vector<std::string> names;
+
+		/// Map of name ids - Key: name - Value: index in names.
+		std::unordered_map<std::string, std::uint32_t> name_ids;
+
+		/// @brief Interns a patron name.
+		/// @param user The name.
+		/// @returns The name's id.
+		std::uint32_t intern(const std::string& user)
+		{
+			auto pair = name_ids.find(user);
+			if (pair != name_ids.end()) {
+				return pair->second;
+			}
+
+			std::uint32_t id = static_cast<std::uint32_t>(names.size());
+			names.push_back(user);
+			name_ids[user] = id;
+			return id;
+		}
+
+		/// @brief Takes a node from the pool.
+		/// @param user The name id to store.
+		/// @returns The node index.
+		std::uint32_t allocate(std::uint32_t user)
+		{
+			std::uint32_t node;
+			if (free_head != NIL) {
+				node = free_head;
+				free_head = nodes[node].next;
+			}
+			else {
+				node = static_cast<std::uint32_t>(nodes.size());
+				nodes.push_back(Node{});
+			}
+
+			nodes[node] = Node{ user, NIL };
+			return node;
+		}
+
+		/// @brief Returns a node to the pool.
+		/// @param node The node index.
+		void release(std::uint32_t node)
+		{
+			nodes[node].next = free_head;
+			free_head = node;
+		}
+
+	public:
+
+		HoldQueues() = default;
+
+		~HoldQueues() = default;
+
+		/// @brief Queues a patron for a book.
+		/// @param book The packed ISBN.
+		/// @param user The patron's name.
+		/// @returns False if the patron already holds the book.
+		bool hold(std::uint64_t book, const std::string& user)
+		{
+			std::uint32_t id = intern(user);
+			auto pair = queues.find(book);
+
+			if (pair == queues.end()) {
+				std::uint32_t node = allocate(id);
+				queues[book] = Queue{ node, node, 1 };
+				return true;
+			}
+
+			Queue& queue = pair->second;
+			for (std::uint32_t node = queue.head; node != NIL; node = nodes[node].next) {
+				if (nodes[node].user == id) {
+					return false;
+				}
+			}
+
+			std::uint32_t node = allocate(id);
+			nodes[queue.tail].next = node;
+			queue.tail = node;
+			queue.size++;
+			return true;
+		}
+
+		/// @brief Serves the first hold of a book.
+		/// @param book The packed ISBN.
+		/// @returns The patron's name, or nothing if no one is waiting.
+		std::optional<std::string> next(std::uint64_t book)
+		{
+			auto pair = queues.find(book);
+			if (pair == queues.end()) {
+				return std::nullopt;
+			}
+
+			Queue& queue = pair->second;
+			std::uint32_t node = queue.head;
+			std::string user = names[nodes[node].user];
+
+			queue.head = nodes[node].next;
+			queue.size--;
+			release(node);
+
+			if (queue.size == 0) {
+				queues.erase(pair);
+			}
+
+			return user;
+		}
+
+		/// @brief Removes a patron's hold on a book.
+		/// @param book The packed ISBN.
+		/// @param user The patron's name.
+		/// @returns True if the hold existed.
+		bool cancel(std::uint64_t book, const std::string& user)
+		{
+			auto pair = queues.find(book);
+			auto name = name_ids.find(user);
+			if (pair == queues.end() || name == name_ids.end()) {
+				return false;
+			}
+
+			Queue& queue = pair->second;
+			std::uint32_t prev = NIL;
+			for (std::uint32_t node = queue.head; node != NIL; prev = node, node = nodes[node].next) {
+				if (nodes[node].user != name->second) {
+					continue;
+				}
+
+				if (prev == NIL) {
+					queue.head = nodes[node].next;
+				}
+				else {
+					nodes[prev].next = nodes[node].next;
+				}
+
+				if (queue.tail == node) {
+					queue.tail = prev;
+				}
+
+				queue.size--;
+				release(node);
+
+				if (queue.size == 0) {
+					queues.erase(pair);
+				}
+
+				return true;
+			}
+
+			return false;
+		}
+
+		/// @brief Gets the number of patrons waiting for a book.
+		/// @param book The packed ISBN.
+		size_t waiting(std::uint64_t book) const
+		{
+			auto pair = queues.find(book);
+			return pair == queues.end() ? 0 : pair->second.size;
+		}
+
+		/// @brief Lists the patrons waiting for a book.
+		/// @param book The packed ISBN.
+		/// @returns The names, first in line first.
+		std::vector<std::string> queue(std::uint64_t book) const
+		{
+			std::vector<std::string> res;
+			auto pair = queues.find(book);
+			if (pair == queues.end()) {
+				return res;
+			}
+
+			for (std::uint32_t node = pair->second.head; node != NIL; node = nodes[node].next) {
+				res.push_back(names[nodes[node].user]);
+			}
+
+			return res;
+		}
+
+		/// @brief Removes every hold.
+		void clear()
+		{
+			nodes.clear();
+			free_head = NIL;
+			queues.clear();
+			names.clear();
+			name_ids.clear();
+		}
+
+		/// @brief Serializes every queue.
+		/// @returns JSON object - Key: packed ISBN - Value: names in order.
+		nlohmann::json to_json() const
+		{
+			nlohmann::json j = nlohmann::json::object();
+			for (const auto& [book, queue] : queues) {
+				j[std::to_string(book)] = this->queue(book);
+			}
+
+			return j;
+		}
+
+		/// @brief Restores every queue.
+		/// @param j JSON produced by `to_json`.
+		void from_json(const nlohmann::json& j)
+		{
+			clear();
+			for (const auto& [book, users] : j.items()) {
+				for (const std::string& user : users.get<std::vector<std::string>>()) {
+					hold(std::stoull(book), user);
+				}
+			}
+		}
+	};
+}
+
+#endif // !HOLDS_H
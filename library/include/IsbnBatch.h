@@ -0,0 +1,267 @@
+#ifndef ISBN_BATCH_H
+#define ISBN_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LIBRARY_ISBN_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+#if defined(LIBRARY_ISBN_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define LIBRARY_ISBN_AVX2 1
+	#include <immintrin.h>
+#endif
+
+/// Batch ISBN validation for imports & loads.
+/// Raw codes are first compacted into fixed 16 byte digit slots (hyphens
+/// and other separators dropped, ISBN-10s widened to ISBN-13); the
+/// weighted mod 10 sums of the slots are then taken with SAD instructions,
+/// one or two slots per instruction, with no per-digit branches.
+namespace IsbnBatch
+{
+	/// Bytes per digit slot.
+	constexpr size_t SLOT = 16;
+
+	/// The outcome of validating a batch.
+	struct Report
+	{
+		/// Canonical ISBN-13 of each code as an integer, 0 if invalid.
+		std::vector<std::uint64_t> packed;
+
+		/// Indexes of the invalid codes.
+		std::vector<size_t> failed;
+
+		/// Indexes of the ISBN-10 codes that were widened to ISBN-13.
+		std::vector<size_t> converted;
+	};
+
+	/// How a code was read into its slot.
+	enum KIND : std::uint8_t
+	{
+		/// Not a valid code
+		INVALID,
+
+		/// 13 digits, check digit still to verify
+		ISBN13,
+
+		/// A valid ISBN-10 widened to 978 + 9 digits, check digit still to fill
+		ISBN10
+	};
+
+	/// @brief Compacts one raw code's digits into a slot.
+	/// Every character but a digit is skipped; an `X` is accepted as the
+	/// tenth (check) digit of an ISBN-10.
+	/// @param code The raw code.
+	/// @param length Its length.
+	/// @param slot The 16 byte slot, zeroed, receiving digit values 0-9.
+	/// @returns How the code was read.
+	inline KIND compact(const char* code, size_t length, std::uint8_t* slot)
+	{
+		std::uint8_t digits[SLOT] = {};
+		size_t count = 0;
+		bool check_x = false;
+
+		for (size_t i = 0; i < length; i++) {
+			unsigned value = static_cast<unsigned>(static_cast<unsigned char>(code[i])) - '0';
+			if (value < 10) {
+				digits[count & (SLOT - 1)] = static_cast<std::uint8_t>(value);
+				count++;
+			}
+			else if ((code[i] == 'X' || code[i] == 'x') && count == 9) {
+				digits[count++] = 10;
+				check_x = true;
+			}
+		}
+
+		if (count == 13 && !check_x) {
+			std::memcpy(slot, digits, 13);
+			return ISBN13;
+		}
+
+		if (count != 10) {
+			return INVALID;
+		}
+
+		// ISBN-10 check: sum of digit * (10 - position) is a multiple of 11
+		unsigned sum = 0;
+		for (size_t i = 0; i < 10; i++) {
+			sum += digits[i] * static_cast<unsigned>(10 - i);
+		}
+
+		if (sum % 11 != 0) {
+			return INVALID;
+		}
+
+		slot[0] = 9;
+		slot[1] = 7;
+		slot[2] = 8;
+		std::memcpy(slot + 3, digits, 9);
+		return ISBN10;
+	}
+
+	/// @brief Weighted ISBN-13 sums (weights 1,3,1,3...) of slots, scalar.
+	inline void sums_scalar(const std::uint8_t* slots, size_t count, std::uint32_t* out, size_t first = 0)
+	{
+		for (size_t i = first; i < count; i++) {
+			const std::uint8_t* slot = slots + i * SLOT;
+			std::uint32_t sum = 0;
+			for (size_t j = 0; j < 13; j++) {
+				sum += slot[j] * ((j & 1) != 0 ? 3U : 1U);
+			}
+			out[i] = sum;
+		}
+	}
+
+#if LIBRARY_ISBN_SSE2
+	/// @brief SSE2 weighted sums, one slot per step.
+	/// sum = SAD(all digits) + 2 * SAD(odd position digits).
+	inline void sums_sse2(const std::uint8_t* slots, size_t count, std::uint32_t* out, size_t first = 0)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i odd_mask = _mm_setr_epi8(0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, 0, 0, 0);
+
+		for (size_t i = first; i < count; i++) {
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(slots + i * SLOT));
+			__m128i all = _mm_sad_epu8(d, zero);
+			__m128i odds = _mm_sad_epu8(_mm_and_si128(d, odd_mask), zero);
+			__m128i s = _mm_add_epi64(all, _mm_add_epi64(odds, odds));
+			s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+			out[i] = static_cast<std::uint32_t>(_mm_cvtsi128_si32(s));
+		}
+	}
+#endif
+
+#if LIBRARY_ISBN_AVX2
+	/// @brief AVX2 weighted sums, two slots per step.
+	__attribute__((target("avx2")))
+	inline void sums_avx2(const std::uint8_t* slots, size_t count, std::uint32_t* out)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i odd_mask = _mm256_setr_epi8(
+			0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, 0, 0, 0,
+			0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, 0, 0, 0);
+
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2) {
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i * SLOT));
+			__m256i all = _mm256_sad_epu8(d, zero);
+			__m256i odds = _mm256_sad_epu8(_mm256_and_si256(d, odd_mask), zero);
+			__m256i s = _mm256_add_epi64(all, _mm256_add_epi64(odds, odds));
+
+			// Lanes 0 & 1 belong to the first slot, 2 & 3 to the second
+			alignas(32) std::uint64_t lanes[4];
+			_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), s);
+			out[i] = static_cast<std::uint32_t>(lanes[0] + lanes[1]);
+			out[i + 1] = static_cast<std::uint32_t>(lanes[2] + lanes[3]);
+		}
+
+		sums_sse2(slots, count, out, i);
+	}
+#endif
+
+	/// Signature shared by the sum kernels.
+	using sums_fn = void (*)(const std::uint8_t*, size_t, std::uint32_t*);
+
+	/// @brief Picks the widest kernel the CPU supports.
+	inline sums_fn select_sums()
+	{
+#if LIBRARY_ISBN_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			return sums_avx2;
+		}
+#endif
+#if LIBRARY_ISBN_SSE2
+		return [](const std::uint8_t* slots, size_t count, std::uint32_t* out) { sums_sse2(slots, count, out); };
+#else
+		return [](const std::uint8_t* slots, size_t count, std::uint32_t* out) { sums_scalar(slots, count, out); };
+#endif
+	}
+
+	/// @brief Computes the weighted sums of many slots.
+	/// The kernel is selected once at runtime.
+	inline void sums(const std::uint8_t* slots, size_t count, std::uint32_t* out)
+	{
+		static const sums_fn kernel = select_sums();
+		kernel(slots, count, out);
+	}
+
+	/// @brief Validates & canonicalizes codes stored back to back.
+	/// Code i is `text[offsets[i], offsets[i + 1])`.
+	/// @param text The codes.
+	/// @param offsets `count + 1` offsets into text.
+	/// @param count The number of codes.
+	/// @returns The canonical ISBN-13s and the failures, by index.
+	inline Report validate(const char* text, const std::uint32_t* offsets, size_t count)
+	{
+		Report report;
+		report.packed.assign(count, 0);
+
+		std::vector<std::uint8_t> slots(count * SLOT, 0);
+		std::vector<KIND> kinds(count);
+		for (size_t i = 0; i < count; i++) {
+			kinds[i] = compact(text + offsets[i], offsets[i + 1] - offsets[i], slots.data() + i * SLOT);
+		}
+
+		std::vector<std::uint32_t> totals(count);
+		sums(slots.data(), count, totals.data());
+
+		for (size_t i = 0; i < count; i++) {
+			std::uint8_t* slot = slots.data() + i * SLOT;
+
+			if (kinds[i] == ISBN10) {
+				// The check digit slot is still 0, so the sum covers the other 12
+				slot[12] = static_cast<std::uint8_t>((10 - totals[i] % 10) % 10);
+				report.converted.push_back(i);
+			}
+			else if (kinds[i] == INVALID || totals[i] % 10 != 0) {
+				report.failed.push_back(i);
+				continue;
+			}
+
+			std::uint64_t value = 0;
+			for (size_t j = 0; j < 13; j++) {
+				value = value * 10 + slot[j];
+			}
+			report.packed[i] = value;
+		}
+
+		return report;
+	}
+
+	/// @brief Validates & canonicalizes a list of codes.
+	/// @param codes The raw codes.
+	/// @returns The canonical ISBN-13s and the failures, by index.
+	inline Report validate(const std::vector<std::string>& codes)
+	{
+		std::string text;
+		std::vector<std::uint32_t> offsets;
+		offsets.reserve(codes.size() + 1);
+		offsets.push_back(0);
+
+		for (const std::string& code : codes) {
+			text += code;
+			offsets.push_back(static_cast<std::uint32_t>(text.size()));
+		}
+
+		return validate(text.data(), offsets.data(), codes.size());
+	}
+
+	/// @brief Formats a canonical ISBN-13 as 13 digits.
+	/// @param packed The ISBN as an integer.
+	inline std::string format(std::uint64_t packed)
+	{
+		std::string code(13, '0');
+		for (size_t i = 13; i-- > 0; packed /= 10) {
+			code[i] = static_cast<char>('0' + packed % 10);
+		}
+
+		return code;
+	}
+}
+
+#endif // !ISBN_BATCH_H
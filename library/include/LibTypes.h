@@ -8,10 +8,26 @@
 #include <fstream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <filesystem>
+#include <memory>
+#include <functional>
 
 #include "UI.h"
+#include "Catalog.h"
+#include "Text.h"
+#include "Rank.h"
+#include "Holds.h"
+#include "Replica.h"
+#include "Browse.h"
+#include "Cache.h"
+#include "Bloom.h"
+#include "Snapshot.h"
+#include "IsbnBatch.h"
+#include "Generator.h"
+#include "Postings.h"
+#include "ReadSnapshot.h"
 
 namespace LibraryTypes
 {
@@ -68,37 +84,19 @@ namespace LibraryTypes
 		/// @returns The string code.
 		std::string create_format13()
 		{
-			//book code - 978 / 979
-			std::string code;
-			code += "978-";
+			// Seeded from rand() once, so std::srand still makes runs repeatable
+			static thread_local Xoshiro256 rng(static_cast<std::uint64_t>(rand()));
 
-			//registration - 1 digit
-			code += std::to_string(rand() % 10);
-
-			code += '-';
-
-			//registrant - 2 digits
-			for (size_t i = 0; i < 2; i++) {
-				code += std::to_string(rand() % 10);
-			}
-
-			code += '-';
-
-			//publication - 6 digits
-			for (size_t i = 0; i < 6; i++) {
-				code += std::to_string(rand() % 10);
-			}
-
-			code += '-';
-
-			std::string digits = getDigits(code);
-
-			int check = calcCheckDigit(digits);
+			char code[IsbnGenerator::LENGTH];
+			IsbnGenerator::random(rng, code);
+			return std::string(code, sizeof(code));
+		}
 
-			code += std::to_string(check);
+		/// Tags the constructor that skips verification.
+		struct Trusted {};
 
-			return code;
-		}
+		/// @brief Wraps a code that was already verified.
+		ISBN(Trusted, std::string code) : code(std::move(code)) {}
 
 		/// @brief Verifies ISBN code with the check digit.
 		/// @param The string reference of the code.
@@ -135,6 +133,26 @@ namespace LibraryTypes
 
 		~ISBN() {}
 
+		/// @brief Wraps a code already checked by `IsbnBatch::validate`.
+		/// @param code The verified code.
+		/// @returns The ISBN, without verifying it again.
+		static ISBN trusted(std::string code) {
+			return ISBN(Trusted{}, std::move(code));
+		}
+
+		/// @brief Packs the code's digits into an integer.
+		/// @returns The 13 digits as a single integer.
+		std::uint64_t packed() const {
+			std::uint64_t value = 0;
+			for (char c : code) {
+				if (isdigit(static_cast<unsigned char>(c))) {
+					value = value * 10 + static_cast<std::uint64_t>(c - '0');
+				}
+			}
+
+			return value;
+		}
+
 		bool operator==(const ISBN& other) const {
 			return this->code == other.code;
 		}
@@ -191,6 +209,13 @@ namespace LibraryTypes
 			}
 		}
 
+		/// @brief Title/Author/ISBN Book constructor
+		/// @param The string title.
+		/// @param The string author.
+		/// @param The ISBN.
+		Book(std::string title, std::string author, ISBN isbn)
+			: title(std::move(title)), author(std::move(author)), isbn(std::move(isbn)) {}
+
 		~Book() { }
 
 		/// @brief Returns the book as a string.
@@ -225,29 +250,86 @@ namespace LibraryTypes
 		book.isbn = ISBN(j.at("isbn").get<std::string>());
 	}
 
+	/// A read-only view of a library's books; see `Library::snapshot`.
+	using BookSnapshot = ReadSnapshot<Book>;
+
 	/// A class representing a Library.
 	/// It stores books. It contains functions
 	/// to manipulate/access the books it contains.
 	class Library {
 	private:
 
-		/// Map of title indexes - Key: title - Value: index in books
-		std::unordered_map<std::string, std::vector<size_t>> title_indexes;
+		/// Map of title indexes - Key: title - Value: indexes in books, compressed
+		std::unordered_map<std::string, Postings> title_indexes;
 
-		/// Map of author indexes - Key: author - Value: index in books
-		std::unordered_map<std::string, std::vector<size_t>> author_indexes;
+		/// Map of author indexes - Key: author - Value: indexes in books, compressed
+		std::unordered_map<std::string, Postings> author_indexes;
 
 		/// Map of ISBN indexes - Key: ISBN code - Value: index in books
 		std::unordered_map<std::string, size_t> isbn_indexes;
 
-		/// @brief Converts a string to lowercase.
-		/// @param The string to be converted.
-		/// @returns The lowercase version of the string.
-		std::string toLC(const std::string& str) const {
-			std::string lower = str;
-			std::transform(lower.begin(), lower.end(), lower.begin(),
-				[](unsigned char c) { return std::tolower(c); });
-			return lower;
+		/// Packed ISBNs of the books on the shelf.
+		/// Matches a book however its code is hyphenated.
+		std::unordered_set<std::uint64_t> isbn_ids;
+
+		/// Filter over `isbn_ids`.
+		/// Lets ISBN lookups that miss skip the hash set.
+		BloomFilter isbn_filter;
+
+		/// Optional columnar layout of `books`, used for scans & reports.
+		ColumnarCatalog columns;
+
+		/// Whether `columns` is maintained.
+		bool use_columns = false;
+
+		/// Borrow counts - Key: packed ISBN - Value: times borrowed.
+		/// Keyed by ISBN so counts survive the book leaving `books` on loan.
+		std::unordered_map<std::uint64_t, std::uint32_t> popularity;
+
+		/// Hold queues for titles with no copy left - Key: packed ISBN.
+		HoldQueues holds;
+
+		/// Shared read-only catalog image; searches use it while open.
+		CatalogReplica image;
+
+		/// Books ordered by title, for browsing.
+		SortedView title_view;
+
+		/// Books ordered by author, then title, for browsing.
+		SortedView author_view;
+
+		/// Bumped by every change that can alter a search result.
+		std::uint64_t generation = 0;
+
+		/// Recent search results, valid while `generation` is unchanged.
+		QueryCache cache;
+
+		/// Nesting depth of `defer_saves`; saving waits for `flush` while non-zero.
+		unsigned deferred = 0;
+
+		/// Hands out unique codes for new books.
+		/// Randomly seeded until `load` restores the saved seed & counter,
+		/// so separate catalogs do not walk the same sequence.
+		IsbnGenerator generator{ IsbnGenerator::random_seed() };
+
+		/// Whether a save was skipped while deferred.
+		bool dirty = false;
+
+		/// Segments handed out by `snapshot`, reused while unchanged.
+		/// Held weakly, so they are freed once every snapshot closes.
+		std::vector<std::weak_ptr<const BookSnapshot::Segment>> segments;
+
+		/// Books before this index are unchanged since `segments` was filled.
+		size_t clean = 0;
+
+		/// @brief Normalizes a search term into a buffer kept per thread.
+		/// The buffers keep their capacity, so repeated queries allocate nothing.
+		/// @param term The term as typed.
+		/// @param slot Which buffer to use, for queries holding several terms.
+		/// @returns The term's key, valid until the slot is reused.
+		static std::string_view term_key(std::string_view term, size_t slot = 0) {
+			thread_local std::string buffers[3];
+			return Text::normalize(term, buffers[slot]);
 		}
 
 		/// @brief Rebuilds all internal indexes.
@@ -258,74 +340,273 @@ namespace LibraryTypes
 			isbn_indexes.clear();
 
 			for (size_t index = 0; index < books.size(); index++) {
-				Book book = books[index];
-				title_indexes[toLC(book.title)].push_back(index);
-				author_indexes[toLC(book.author)].push_back(index);
+				const Book& book = books[index];
+				title_indexes[Text::normalize(book.title)].add(static_cast<std::uint32_t>(index));
+				author_indexes[Text::normalize(book.author)].add(static_cast<std::uint32_t>(index));
 				isbn_indexes[book.isbn.code] = index;
 			}
+
+			build_filter();
+
+			if (use_columns) {
+				build_columns();
+			}
+		}
+
+		/// @brief Reads books from JSON, validating every ISBN in one batch.
+		/// ISBN-10 codes are converted to ISBN-13.
+		/// @param j The books' JSON array.
+		/// @returns The books.
+		/// @throws std::runtime_error if any ISBN is invalid.
+		static std::vector<Book> parse_books(const nlohmann::json& j) {
+			std::string text;
+			std::vector<std::uint32_t> offsets;
+			offsets.reserve(j.size() + 1);
+			offsets.push_back(0);
+
+			for (const nlohmann::json& book : j) {
+				text += book.at("isbn").get_ref<const std::string&>();
+				offsets.push_back(static_cast<std::uint32_t>(text.size()));
+			}
+
+			IsbnBatch::Report report = IsbnBatch::validate(text.data(), offsets.data(), j.size());
+			if (!report.failed.empty()) {
+				throw std::runtime_error("Invalid ISBN code");
+			}
+
+			std::vector<Book> res;
+			res.reserve(j.size());
+			size_t converted = 0;
+			for (size_t i = 0; i < j.size(); i++) {
+				std::string code = text.substr(offsets[i], offsets[i + 1] - offsets[i]);
+				if (converted < report.converted.size() && report.converted[converted] == i) {
+					code = IsbnBatch::format(report.packed[i]);
+					converted++;
+				}
+
+				res.emplace_back(j[i].at("title").get<std::string>(), j[i].at("author").get<std::string>(), ISBN::trusted(std::move(code)));
+			}
+
+			return res;
+		}
+
+		/// @brief Rebuilds the ISBN filter, sized with room to grow.
+		void build_filter() {
+			isbn_filter.reset(books.size() * 2);
+			isbn_ids.clear();
+			for (const Book& book : books) {
+				isbn_filter.insert(book.isbn.packed());
+				isbn_ids.insert(book.isbn.packed());
+			}
+		}
+
+		/// @brief Appends a book and indexes it without saving.
+		/// @param book The book to add.
+		void insert(const Book& book) {
+			clean = std::min(clean, books.size());
+			books.push_back(book);
+			size_t index = books.size() - 1;
+
+			title_indexes[Text::normalize(book.title)].add(static_cast<std::uint32_t>(index));
+			author_indexes[Text::normalize(book.author)].add(static_cast<std::uint32_t>(index));
+			isbn_indexes[book.isbn.code] = index;
+			title_view.insert(Text::normalize(book.title), book.isbn.code);
+			author_view.insert(author_key(book), book.isbn.code);
+			generation++;
+
+			isbn_ids.insert(book.isbn.packed());
+			isbn_filter.insert(book.isbn.packed());
+			if (isbn_filter.full()) {
+				build_filter();
+			}
+
+			if (use_columns) {
+				columns.append(book.title, book.author, book.isbn.packed());
+			}
+		}
+
+		/// @brief Gets a book's sort key in the author view.
+		std::string author_key(const Book& book) const {
+			return Text::normalize(book.author) + '\0' + Text::normalize(book.title);
+		}
+
+		/// @brief Builds the cache key of a query.
+		/// Title & author searches of the indexes ignore case & accents, so
+		/// their terms are normalized; other searches match the term as typed.
+		std::string query_key(const std::string& term, SEARCH type, size_t limit) const {
+			std::string key = std::to_string(static_cast<int>(type)) + ':' + std::to_string(limit) + ':';
+			bool keyed = type != SEARCH::CODE && !use_columns && !image.is_open();
+			return key.append(keyed ? term_key(term) : std::string_view(term));
+		}
+
+		/// @brief Rebuilds the browse views from `books`.
+		/// Only needed after a bulk load; `add` & `remove` keep them current.
+		void build_views() {
+			std::vector<std::string> titles, authors, codes;
+			titles.reserve(books.size());
+			authors.reserve(books.size());
+			codes.reserve(books.size());
+
+			for (const Book& book : books) {
+				titles.push_back(Text::normalize(book.title));
+				authors.push_back(author_key(book));
+				codes.push_back(book.isbn.code);
+			}
+
+			title_view.build(titles, codes);
+			author_view.build(authors, codes);
+		}
+
+		/// @brief Rebuilds the columnar layout from `books`.
+		void build_columns() {
+			size_t text = 0;
+			for (const Book& book : books) {
+				text += book.title.size() + book.author.size();
+			}
+
+			columns.clear();
+			columns.reserve(books.size(), text);
+
+			for (const Book& book : books) {
+				columns.append(book.title, book.author, book.isbn.packed());
+			}
+		}
+
+		/// @brief Gets how often the book at an index was borrowed.
+		/// @param index The index in books.
+		/// @returns The borrow count.
+		std::uint32_t popularity_of(size_t index) const
+		{
+			auto pair = popularity.find(books[index].isbn.packed());
+			return pair == popularity.end() ? 0 : pair->second;
 		}
 
-		/// @brief Appends matching books by partial key to result list.
+		/// @brief Ranks matching books by partial key.
 		/// @param map The index map to search.
-		/// @param res The result vector to append books into.
-		/// @param term The lowercase search term.
+		/// @param top The bounded heap to push hits into.
+		/// @param term The search term, matched ignoring case.
 		void append_indexes(
-			const std::unordered_map<std::string, std::vector<size_t>>& map,
-			std::vector<Book>& res,
-			std::string& term)
+			const std::unordered_map<std::string, Postings>& map,
+			TopK& top,
+			std::string_view term) const
 		{
 			for (const auto& [keys, indices] : map) {
-				if (keys.find(term) != std::string::npos) {
-					for (size_t index : indices) {
-						res.push_back(books[index]);
-					}
+				size_t pos = Text::ifind(keys, term);
+				if (pos != std::string_view::npos) {
+					std::uint32_t relevance = grade(keys, term.size(), pos);
+					indices.for_each([&](std::uint32_t index) {
+						top.push(Hit{ relevance, popularity_of(index), index });
+					});
+				}
+			}
+		}
+
+		/// @brief Collects the books whose key contains a term.
+		/// @param map The index map to search.
+		/// @param term The search term, matched ignoring case.
+		/// @returns The matching indexes in books.
+		IdSet match_indexes(const std::unordered_map<std::string, Postings>& map, std::string_view term) const
+		{
+			IdSet res(books.size());
+			for (const auto& [keys, indices] : map) {
+				if (Text::icontains(keys, term)) {
+					res.add(indices);
 				}
 			}
+
+			return res;
+		}
+
+		/// @brief Ranks matching column rows.
+		/// @param rows The matched rows.
+		/// @param column The column accessor, title or author.
+		/// @param top The bounded heap to push hits into.
+		/// @param term The search term, matched ignoring case.
+		template <typename Column>
+		void append_rows(const std::vector<size_t>& rows, Column column, TopK& top, std::string_view term) const
+		{
+			for (size_t row : rows) {
+				std::string_view key = (columns.*column)(row);
+				std::uint32_t relevance = grade(key, term.size(), Text::ifind(key, term));
+				top.push(Hit{ relevance, popularity_of(row), row });
+			}
 		}
 
-		/// @brief Searches by title.
+		/// @brief Ranks books by title.
 		/// @param term The search term.
-		/// @returns A vector of matched books.
-		std::vector<Book> title_search(std::string& term)
+		/// @param top The bounded heap to push hits into.
+		void title_search(std::string_view term, TopK& top) const
 		{
-			std::vector<Book> res;
-			std::string title = toLC(term);
+			if (use_columns) {
+				append_rows(columns.find_title(term), &ColumnarCatalog::title, top, term);
+				return;
+			}
 
-			append_indexes(title_indexes, res, title);
+			append_indexes(title_indexes, top, term);
+		}
 
-			return res;
+		/// @brief Ranks books by author.
+		/// @param term The search term.
+		/// @param top The bounded heap to push hits into.
+		void author_search(std::string_view term, TopK& top) const
+		{
+			if (use_columns) {
+				append_rows(columns.find_author(term), &ColumnarCatalog::author, top, term);
+				return;
+			}
+
+			append_indexes(author_indexes, top, term);
 		}
 
-		/// @brief Searches by author.
+		/// @brief Ranks the replica's books.
+		/// Titles & authors are scanned straight out of the mapped image,
+		/// ISBNs go through its sorted index. The image holds the display
+		/// text rather than keys, so it matches ignoring ASCII case only.
 		/// @param term The search term.
-		/// @returns A vector of matched books.
-		std::vector<Book> author_search(std::string& term)
+		/// @param type The type of search.
+		/// @param top The bounded heap to push hits into.
+		void replica_search(const std::string& term, SEARCH type, TopK& top) const
 		{
-			std::vector<Book> res;
-			std::string author = toLC(term);
+			if (type == SEARCH::CODE) {
+				std::uint64_t packed = 0;
+				for (char c : term) {
+					if (isdigit(static_cast<unsigned char>(c))) {
+						packed = packed * 10 + static_cast<std::uint64_t>(c - '0');
+					}
+				}
 
-			append_indexes(author_indexes, res, author);
+				size_t row = image.find_isbn(packed);
+				if (row != image.size() && image.code(row) == term) {
+					top.push(Hit{ EXACT, image.popularity(row), row });
+				}
+				return;
+			}
 
-			return res;
+			for (size_t row = 0; row < image.size(); row++) {
+				std::string_view key = type == SEARCH::TITLE ? image.title(row) : image.author(row);
+				size_t pos = Text::ifind(key, term);
+				if (pos != std::string_view::npos) {
+					top.push(Hit{ grade(key, term.size(), pos), image.popularity(row), row });
+				}
+			}
 		}
 
 		/// @brief Searches by ISBN code.
 		/// @param term The ISBN to match.
-		/// @returns A vector of 1 or 0 matched books.
-		std::vector<Book> isbn_search(std::string& term)
+		/// @param top The bounded heap to push the 1 or 0 hits into.
+		void isbn_search(const std::string& term, TopK& top) const
 		{
-			std::vector<Book> res;
-
 			auto pair = isbn_indexes.find(term);
 
 			if (pair != isbn_indexes.end()) {
-				res.push_back(books[pair->second]);
+				top.push(Hit{ EXACT, popularity_of(pair->second), pair->second });
 			}
-
-			return res;
 		}
 
 	public:
+		/// Default number of results returned by `search`.
+		static constexpr size_t SEARCH_LIMIT = 20;
+
 		/// All books stored in the library.
 		std::vector<Book> books;
 
@@ -342,14 +623,192 @@ namespace LibraryTypes
 		/// @param book The book to add.
 		void add(const Book& book)
 		{
-			books.push_back(book);
-			size_t index = books.size() - 1;
+			insert(book);
+			save();
+		}
 
-			title_indexes[toLC(book.title)].push_back(index);
-			author_indexes[toLC(book.author)].push_back(index);
-			isbn_indexes[book.isbn.code] = index;
+		/// @brief Adds many books, skipping ISBNs already in the library.
+		/// Most incoming ISBNs are new, so the filter settles those without
+		/// touching `isbn_indexes`; the library is saved once at the end.
+		/// @param incoming The books to add.
+		/// @returns The number of books added.
+		size_t import(const std::vector<Book>& incoming)
+		{
+			size_t added = 0;
+			for (const Book& book : incoming) {
+				if (contains(book.isbn)) {
+					continue;
+				}
+
+				insert(book);
+				added++;
+			}
+
+			if (added != 0) {
+				save();
+			}
+
+			return added;
+		}
+
+		/// @brief Removes one copy of each of several books.
+		/// Nothing is removed unless every ISBN has a copy on the shelf;
+		/// the indexes are rebuilt & the library saved once. Copies are
+		/// matched by packed ISBN, so hyphenation doesn't matter.
+		/// @param isbns The ISBNs, repeated to take several copies.
+		/// @returns The removed books in order, empty if any was missing.
+		std::vector<Book> take(const std::vector<ISBN>& isbns)
+		{
+			std::unordered_map<std::uint64_t, size_t> wanted;
+			for (const ISBN& isbn : isbns) {
+				wanted[isbn.packed()]++;
+			}
+
+			// Take the last copies, the ones `isbn_indexes` points at
+			std::vector<bool> taken(books.size(), false);
+			for (size_t index = books.size(); index-- > 0; ) {
+				auto pair = wanted.find(books[index].isbn.packed());
+				if (pair != wanted.end() && pair->second != 0) {
+					pair->second--;
+					taken[index] = true;
+				}
+			}
+
+			for (const auto& [id, missing] : wanted) {
+				if (missing != 0) {
+					return {};
+				}
+			}
+
+			std::unordered_map<std::uint64_t, Book> removed;
+			size_t kept = 0;
+			for (size_t index = 0; index < books.size(); index++) {
+				if (!taken[index]) {
+					books[kept++] = std::move(books[index]);
+					continue;
+				}
 
+				clean = std::min(clean, index);
+				title_view.erase(Text::normalize(books[index].title), books[index].isbn.code);
+				author_view.erase(author_key(books[index]), books[index].isbn.code);
+				removed.emplace(books[index].isbn.packed(), books[index]);
+			}
+			books.resize(kept);
+			generation++;
+
+			re_index();
 			save();
+
+			std::vector<Book> res;
+			res.reserve(isbns.size());
+			for (const ISBN& isbn : isbns) {
+				res.push_back(removed.at(isbn.packed()));
+			}
+
+			return res;
+		}
+
+		/// @brief Puts several books back on the shelf, saving once.
+		/// @param returned The books.
+		void restock(const std::vector<Book>& returned)
+		{
+			for (const Book& book : returned) {
+				insert(book);
+			}
+
+			if (!returned.empty()) {
+				save();
+			}
+		}
+
+		/// @brief Holds back saving until a matching `flush`.
+		/// Lets a batch of changes reach the disk in one write.
+		void defer_saves()
+		{
+			deferred++;
+		}
+
+		/// @brief Ends a `defer_saves`, saving once if anything changed.
+		void flush()
+		{
+			if (deferred != 0 && --deferred == 0 && dirty) {
+				dirty = false;
+				save();
+			}
+		}
+
+		/// @brief Checks whether a book with an ISBN is in the library.
+		/// @param isbn The ISBN.
+		/// @returns True if a copy is on the shelf.
+		bool contains(const ISBN& isbn) const
+		{
+			if (!isbn_filter.may_contain(isbn.packed())) {
+				return false;
+			}
+
+			return isbn_ids.count(isbn.packed()) != 0;
+		}
+
+		/// @brief Generates an ISBN no book of the catalog uses.
+		/// Codes on the shelf or ever borrowed are skipped, and so are codes
+		/// `taken` reports, e.g. books out on loan, which the shelf lacks.
+		/// @param taken Returns true for packed ISBNs in use elsewhere.
+		/// @returns The ISBN.
+		ISBN new_isbn(const std::function<bool(std::uint64_t)>& taken = nullptr)
+		{
+			char code[IsbnGenerator::LENGTH];
+			while (true) {
+				generator.next(code);
+				ISBN isbn = ISBN::trusted(std::string(code, sizeof(code)));
+
+				if (!contains(isbn) && popularity.count(isbn.packed()) == 0
+					&& !(taken && taken(isbn.packed()))) {
+					return isbn;
+				}
+			}
+		}
+
+		/// @brief Generates many unique ISBNs, e.g. for test catalogs.
+		/// @param count The number of ISBNs.
+		/// @param taken Returns true for packed ISBNs in use elsewhere.
+		/// @returns Distinct ISBNs no book of the catalog uses.
+		std::vector<ISBN> new_isbns(size_t count, const std::function<bool(std::uint64_t)>& taken = nullptr)
+		{
+			std::vector<ISBN> res;
+			res.reserve(count);
+			for (size_t i = 0; i < count; i++) {
+				res.push_back(new_isbn(taken));
+			}
+
+			return res;
+		}
+
+		/// @brief Gets the ISBN generator's seed & counter, saved with the catalog.
+		nlohmann::json isbn_state() const
+		{
+			return { { "seed", generator.seed() }, { "used", generator.used() } };
+		}
+
+		/// @brief Resumes ISBN generation where a saved catalog left off.
+		/// @param state A state from `isbn_state`.
+		void restore_isbns(const nlohmann::json& state)
+		{
+			generator = IsbnGenerator(state.at("seed").get<std::uint64_t>(), state.at("used").get<std::uint32_t>());
+		}
+
+		/// @brief Restarts ISBN generation from a seed.
+		/// @param seed The seed; equal seeds give equal sequences.
+		void seed_isbns(std::uint64_t seed)
+		{
+			generator = IsbnGenerator(seed);
+		}
+
+		/// @brief Sets the ISBN filter's target false positive rate.
+		/// @param rate The rate, in (0, 1).
+		void set_filter_rate(double rate)
+		{
+			isbn_filter.set_rate(rate);
+			build_filter();
 		}
 
 		/// @brief Removes a book by ISBN.
@@ -365,7 +824,11 @@ namespace LibraryTypes
 
 			size_t index = pair->second;
 
+			title_view.erase(Text::normalize(books[index].title), books[index].isbn.code);
+			author_view.erase(author_key(books[index]), books[index].isbn.code);
 			books.erase(books.begin() + index);
+			clean = std::min(clean, index);
+			generation++;
 
 			re_index();
 
@@ -374,29 +837,304 @@ namespace LibraryTypes
 			return true;
 		}
 
-		/// @brief Searches books by a given term and type.
+		/// @brief Ranks books matching a term.
+		/// Title & author terms are normalized like the index keys, so
+		/// "emile" finds "Émile"; the columns & the replica hold display
+		/// text and match ignoring ASCII case only. Hits are ordered by
+		/// relevance, then popularity, and only the best `limit` are kept.
 		/// @param term The search keyword.
 		/// @param type The type of search (TITLE, AUTHOR, ISBN).
-		/// @returns A list of books that match the search.
-		std::vector<Book> search(std::string term, SEARCH type)
+		/// @param limit The number of hits to keep, 0 keeps every hit.
+		/// @returns The hits, best first.
+		std::vector<Hit> rank(const std::string& term, SEARCH type, size_t limit = SEARCH_LIMIT) const
 		{
-            std::vector<Book> res;
+			TopK top(limit);
+			if (image.is_open()) {
+				replica_search(term, type, top);
+				return top.take();
+			}
+
+			// The columns hold display text, so they take the term as typed
 			switch (type)
 			{
 			case SEARCH::TITLE:
-				res = title_search(term);
-                break;
+				title_search(use_columns ? std::string_view(term) : term_key(term), top);
+				break;
 			case SEARCH::AUTHOR:
-				res = author_search(term);
-                break;
+				author_search(use_columns ? std::string_view(term) : term_key(term), top);
+				break;
 			case SEARCH::CODE:
-				res = isbn_search(term);
-                break;
+				isbn_search(term, top);
+				break;
 			default:
 				break;
 			}
 
-            return res;
+			return top.take();
+		}
+
+		/// @brief Searches books by a given term and type.
+		/// With a replica open, the books come from the replica.
+		/// Repeated queries are answered from the cache until the catalog changes.
+		/// @param term The search keyword.
+		/// @param type The type of search (TITLE, AUTHOR, ISBN).
+		/// @param limit The number of results to keep, 0 keeps every result.
+		/// @returns A list of books that match the search, best first.
+		std::vector<Book> search(std::string term, SEARCH type, size_t limit = SEARCH_LIMIT)
+		{
+			std::string key = query_key(term, type, limit);
+			std::vector<Hit> ranked;
+			const std::vector<Hit>* hits = cache.find(key, generation);
+
+			if (hits == nullptr) {
+				ranked = rank(term, type, limit);
+				cache.store(key, generation, ranked);
+				hits = &ranked;
+			}
+
+			std::vector<Book> res;
+			for (const Hit& hit : *hits) {
+				if (image.is_open()) {
+					res.emplace_back(std::string(image.title(hit.index)), std::string(image.author(hit.index)), std::string(image.code(hit.index)));
+				}
+				else {
+					res.push_back(books[hit.index]);
+				}
+			}
+
+			return res;
+		}
+
+		/// @brief Searches books matching both a title term and an author term.
+		/// Each term's matching keys are unioned into a bitmap of the catalog
+		/// and the two bitmaps intersected, so only books matching both are
+		/// ranked. Always searches the local catalog.
+		/// @param title The title keyword.
+		/// @param author The author keyword.
+		/// @param limit The number of results to keep, 0 keeps every result.
+		/// @returns A list of books that match both, best title match first.
+		std::vector<Book> search_both(const std::string& title, const std::string& author, size_t limit = SEARCH_LIMIT) const
+		{
+			std::string_view title_term = term_key(title, 0);
+			IdSet found = match_indexes(title_indexes, title_term);
+			found.intersect(match_indexes(author_indexes, term_key(author, 1)));
+
+			TopK top(limit);
+			found.for_each([&](std::uint32_t index) {
+				std::string_view key = term_key(books[index].title, 2);
+				top.push(Hit{ grade(key, title_term.size(), Text::ifind(key, title_term)), popularity_of(index), index });
+			});
+
+			std::vector<Book> res;
+			for (const Hit& hit : top.take()) {
+				res.push_back(books[hit.index]);
+			}
+
+			return res;
+		}
+
+		/// @brief Opens a consistent read-only view of the books.
+		/// Reports & exports read the snapshot while borrows & returns
+		/// carry on; nothing the library does later changes it.
+		/// Only segments changed since the previous snapshot are copied,
+		/// so a snapshot of an unchanged catalog copies no books at all.
+		/// @returns The snapshot.
+		BookSnapshot snapshot()
+		{
+			const size_t SEGMENT = BookSnapshot::SEGMENT;
+			size_t count = (books.size() + SEGMENT - 1) / SEGMENT;
+			segments.resize(count);
+
+			std::vector<std::shared_ptr<const BookSnapshot::Segment>> parts(count);
+			for (size_t index = 0; index < count; index++) {
+				size_t first = index * SEGMENT;
+				size_t last = std::min(books.size(), first + SEGMENT);
+
+				std::shared_ptr<const BookSnapshot::Segment> part = segments[index].lock();
+				if (!part || last > clean || part->size() != last - first) {
+					part = std::make_shared<const BookSnapshot::Segment>(books.begin() + static_cast<std::ptrdiff_t>(first), books.begin() + static_cast<std::ptrdiff_t>(last));
+					segments[index] = part;
+				}
+				parts[index] = std::move(part);
+			}
+
+			clean = books.size();
+			return BookSnapshot(std::move(parts), books.size(), generation);
+		}
+
+		/// @brief Lists one page of the catalog in alphabetical order.
+		/// The views are kept sorted as books come & go, so a page costs
+		/// O(log n + page) rather than a sort of the whole catalog.
+		/// @param type AUTHOR orders by author then title, otherwise by title.
+		/// @param page The page number, from 0.
+		/// @param per_page The number of books per page.
+		/// @returns The books on the page, empty past the last page.
+		std::vector<Book> browse(SEARCH type, size_t page, size_t per_page = SEARCH_LIMIT) const
+		{
+			const SortedView& view = type == SEARCH::AUTHOR ? author_view : title_view;
+
+			std::vector<Book> res;
+			for (const std::string& code : view.range(page * per_page, per_page)) {
+				auto pair = isbn_indexes.find(code);
+				if (pair != isbn_indexes.end()) {
+					res.push_back(books[pair->second]);
+				}
+			}
+
+			return res;
+		}
+
+		/// @brief Gets the number of browse pages.
+		/// @param per_page The number of books per page.
+		size_t pages(size_t per_page = SEARCH_LIMIT) const
+		{
+			return (title_view.size() + per_page - 1) / per_page;
+		}
+
+		/// @brief Publishes the catalog as a shared read-only image.
+		/// Readers in other processes pick it up with `refresh_replica`.
+		/// @param path The image file.
+		/// @returns The published generation, 0 on failure.
+		std::uint64_t publish(const std::filesystem::path& path) const
+		{
+			std::vector<std::string_view> titles, authors, codes;
+			std::vector<std::uint64_t> packed;
+			std::vector<std::uint32_t> counts;
+
+			for (size_t index = 0; index < books.size(); index++) {
+				titles.push_back(books[index].title);
+				authors.push_back(books[index].author);
+				codes.push_back(books[index].isbn.code);
+				packed.push_back(books[index].isbn.packed());
+				counts.push_back(popularity_of(index));
+			}
+
+			return CatalogReplica::publish(path, titles, authors, codes, packed, counts);
+		}
+
+		/// @brief Serves searches from a shared read-only image.
+		/// @param path The image file written by `publish`.
+		/// @returns False if the image could not be opened.
+		bool open_replica(const std::filesystem::path& path)
+		{
+			generation++;
+			return image.open(path);
+		}
+
+		/// @brief Picks up a newer published generation.
+		/// @returns True if the replica changed.
+		bool refresh_replica()
+		{
+			if (!image.refresh()) {
+				return false;
+			}
+
+			generation++;
+			return true;
+		}
+
+		/// @brief Goes back to searching the local catalog.
+		void close_replica()
+		{
+			image.close();
+			generation++;
+		}
+
+		/// @brief Gets the replica.
+		/// @returns The replica, closed unless `open_replica` succeeded.
+		const CatalogReplica& replica() const
+		{
+			return image;
+		}
+
+		/// @brief Records a borrow of a book, raising its rank in searches.
+		/// @param book The borrowed book.
+		void record_borrow(const Book& book)
+		{
+			popularity[book.isbn.packed()]++;
+			generation++;
+		}
+
+		/// @brief Gets the search cache's hit & miss counters.
+		const CacheStats& cache_stats() const
+		{
+			return cache.stats();
+		}
+
+		/// @brief Sets how many queries the search cache keeps.
+		/// @param size The number of queries, 0 disables caching.
+		void set_cache_capacity(size_t size)
+		{
+			cache.resize(size);
+		}
+
+		/// @brief Gets how often a book was borrowed.
+		/// @param book The book.
+		/// @returns The borrow count.
+		std::uint32_t borrows(const Book& book) const
+		{
+			auto pair = popularity.find(book.isbn.packed());
+			return pair == popularity.end() ? 0 : pair->second;
+		}
+
+		/// @brief Queues a patron for a title.
+		/// @param isbn The title's ISBN.
+		/// @param user The patron's name.
+		/// @returns False if the patron is already queued.
+		bool place_hold(const ISBN& isbn, const std::string& user)
+		{
+			bool placed = holds.hold(isbn.packed(), user);
+
+			if (placed) {
+				save();
+			}
+
+			return placed;
+		}
+
+		/// @brief Takes the next patron waiting for a book.
+		/// @param book The returned book.
+		/// @returns The patron's name, or nothing if no one is waiting.
+		std::optional<std::string> next_holder(const Book& book)
+		{
+			std::optional<std::string> user = holds.next(book.isbn.packed());
+
+			if (user) {
+				save();
+			}
+
+			return user;
+		}
+
+		/// @brief Gets the number of patrons waiting for a book.
+		/// @param book The book.
+		size_t holds_waiting(const Book& book) const
+		{
+			return holds.waiting(book.isbn.packed());
+		}
+
+		/// @brief Enables or disables the columnar layout.
+		/// When enabled, title & author searches scan the columns
+		/// instead of the hash map keys.
+		/// @param enable Whether to maintain the columns.
+		void columnar(bool enable)
+		{
+			use_columns = enable;
+			generation++;
+
+			if (use_columns) {
+				build_columns();
+			}
+			else {
+				columns.clear();
+			}
+		}
+
+		/// @brief Gets the columnar layout.
+		/// @returns The columns, empty unless `columnar(true)` was called.
+		const ColumnarCatalog& catalog() const
+		{
+			return columns;
 		}
 
 		/// @brief Gets the number of books in the library.
@@ -405,22 +1143,36 @@ namespace LibraryTypes
 			return books.size();
 		}
 
-		/// @brief Saves all books to a JSON file.
-		void save()
+		/// @brief Saves the books, borrow counts, holds & ISBN generator.
+		/// Each file is replaced atomically, but not the set: a crash part
+		/// way leaves some files one save behind. They are all keyed by ISBN,
+		/// so a stale count, hold or generator state never breaks a load.
+		/// @returns False if any file could not be written; each failure is reported on stderr.
+		bool save()
 		{
+			if (deferred != 0) {
+				dirty = true;
+				return true;
+			}
+
 			if(UI::TEST_MODE)
 			{
-				return;
+				return true;
 			}
 
-			//std::cout << "Saving books to:" << std::filesystem::current_path() / "data" / "library_books.json" << std::endl;
-			std::filesystem::path books_path = std::filesystem::current_path() / "data" / "library_books.json";
-
+			std::filesystem::path data_path = std::filesystem::current_path() / "data";
 
 			nlohmann::json books_j = books;
-			std::ofstream o(books_path);
-			o << std::setw(4) << books_j << std::endl;
-			o.close();
+			bool saved = Snapshot::write_checked(data_path / "library_books.json", books_j.dump(4) + "\n");
+
+			nlohmann::json popularity_j = popularity;
+			saved = Snapshot::write_checked(data_path / "library_popularity.json", popularity_j.dump() + "\n") && saved;
+
+			saved = Snapshot::write_checked(data_path / "library_holds.json", holds.to_json().dump() + "\n") && saved;
+
+			saved = Snapshot::write_checked(data_path / "library_isbns.json", isbn_state().dump() + "\n") && saved;
+
+			return saved;
 		}
 
 		std::string save_as_json()
@@ -431,6 +1183,7 @@ namespace LibraryTypes
 
 		/// @brief Loads books from a JSON file.
 		/// @returns True if loaded, false otherwise.
+		/// @throws std::runtime_error if a snapshot is damaged; it is moved to `<file>.corrupt`.
 		bool load() 
         {
 			
@@ -446,26 +1199,42 @@ namespace LibraryTypes
 				std::filesystem::create_directory(data_path);
 			}
 
+			// Snapshots are checksummed; a damaged file is set aside, never half read
+			std::filesystem::path popularity_path = data_path / "library_popularity.json";
+			if (std::optional<std::string> text = Snapshot::read_checked(popularity_path)) {
+				nlohmann::json popularity_j = nlohmann::json::parse(*text);
+				popularity = popularity_j.get<std::unordered_map<std::uint64_t, std::uint32_t>>();
+			}
+
+			std::filesystem::path holds_path = data_path / "library_holds.json";
+			if (std::optional<std::string> text = Snapshot::read_checked(holds_path)) {
+				holds.from_json(nlohmann::json::parse(*text));
+			}
+
+			std::filesystem::path isbns_path = data_path / "library_isbns.json";
+			if (std::optional<std::string> text = Snapshot::read_checked(isbns_path)) {
+				restore_isbns(nlohmann::json::parse(*text));
+			}
+
 			if (!std::filesystem::exists(books_path)) 
 			{
-				std::ofstream o(books_path);
-				o << "[]" << std::endl; 
-				o.close();
+				Snapshot::write(books_path, "[]\n");
 				return false;
 			}
 
-			std::ifstream i(books_path);
-			if (!i.is_open()) {
+			std::optional<std::string> text = Snapshot::read_checked(books_path);
+			if (!text) {
 				return false;
 			}
 
-			nlohmann::json j;
-			i >> j;
-			i.close();
+			nlohmann::json j = nlohmann::json::parse(*text);
 
-			books = j;
+			books = parse_books(j);
+			clean = 0;
 
 			re_index();
+			build_views();
+			generation++;
 			return true;
 		}
 
@@ -473,9 +1242,12 @@ namespace LibraryTypes
 		{
 			nlohmann::json j = nlohmann::json::parse(json);
 
-			books = j;
+			books = parse_books(j);
+			clean = 0;
 
 			re_index();
+			build_views();
+			generation++;
 			return true;
 		}
 	};
@@ -0,0 +1,290 @@
+#ifndef OVERDUE_H
+#define OVERDUE_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// A loan that is past its due date.
+struct OverdueLoan
+{
+public:
+	/// The borrower's name.
+	std::string user;
+
+	/// The packed ISBN of the book.
+	std::uint64_t book;
+
+	/// The due day, in days since 1970-01-01.
+	std::int64_t due;
+};
+
+/// Tracks loan due dates on a hierarchical timing wheel.
+/// Ticks are days. Loans due within 64 days sit in the first wheel,
+/// later ones in coarser wheels that cascade down as time passes, so
+/// advancing a day only touches the loans that expire on it.
+/// Overdue loans are kept in their own table, so "who is overdue"
+/// never scans every user.
+class OverdueTracker
+{
+private:
+
+	/// Identifies a loan.
+	struct Key
+	{
+		std::string user;
+		std::uint64_t book;
+
+		bool operator==(const Key& other) const {
+			return book == other.book && user == other.user;
+		}
+	};
+
+	/// Hashes a loan key.
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const {
+			return std::hash<std::string>{}(key.user) ^ (std::hash<std::uint64_t>{}(key.book) * 0x9e3779b97f4a7c15ULL);
+		}
+	};
+
+	/// Number of slots per wheel.
+	static constexpr std::int64_t SLOTS = 64;
+
+	/// Bits per wheel level.
+	static constexpr std::int64_t BITS = 6;
+
+	/// Number of wheel levels, covering 64^3 days before the overflow list.
+	static constexpr size_t LEVELS = 3;
+
+	/// The wheels - a slot holds the loans firing in its span.
+	std::array<std::array<std::vector<OverdueLoan>, SLOTS>, LEVELS> wheels;
+
+	/// Loans too far out for the wheels.
+	std::vector<OverdueLoan> overflow;
+
+	/// Loans waiting to expire - Key: loan - Value: due day.
+	/// Returned loans are erased here and dropped lazily when their slot fires.
+	std::unordered_map<Key, std::int64_t, KeyHash> pending;
+
+	/// Loans that are overdue - Key: loan - Value: due day.
+	std::unordered_map<Key, std::int64_t, KeyHash> expired;
+
+	/// The last processed day.
+	std::int64_t now = 0;
+
+	/// @brief Places a loan in the wheel matching its firing day.
+	/// A loan fires the day after it is due.
+	/// @param loan The loan to place.
+	void insert(const OverdueLoan& loan)
+	{
+		std::int64_t fire = loan.due + 1;
+
+		if (fire - now < SLOTS) {
+			wheels[0][fire & (SLOTS - 1)].push_back(loan);
+			return;
+		}
+
+		for (size_t level = 1; level < LEVELS; level++) {
+			std::int64_t shift = BITS * static_cast<std::int64_t>(level);
+			if ((fire >> shift) - (now >> shift) < SLOTS) {
+				wheels[level][(fire >> shift) & (SLOTS - 1)].push_back(loan);
+				return;
+			}
+		}
+
+		overflow.push_back(loan);
+	}
+
+	/// @brief Re-places every loan of a slot one level down.
+	/// @param slot The slot to empty.
+	void cascade(std::vector<OverdueLoan>& slot)
+	{
+		std::vector<OverdueLoan> loans;
+		loans.swap(slot);
+
+		for (const OverdueLoan& loan : loans) {
+			insert(loan);
+		}
+	}
+
+	/// @brief Moves one day forward.
+	/// @param fired Receives the loans that became overdue.
+	void tick(std::vector<OverdueLoan>& fired)
+	{
+		now++;
+
+		if ((now & ((std::int64_t(1) << (BITS * LEVELS)) - 1)) == 0) {
+			cascade(overflow);
+		}
+
+		for (size_t level = LEVELS - 1; level > 0; level--) {
+			std::int64_t shift = BITS * static_cast<std::int64_t>(level);
+			if ((now & ((std::int64_t(1) << shift) - 1)) == 0) {
+				cascade(wheels[level][(now >> shift) & (SLOTS - 1)]);
+			}
+		}
+
+		std::vector<OverdueLoan> slot;
+		slot.swap(wheels[0][now & (SLOTS - 1)]);
+
+		for (OverdueLoan& loan : slot) {
+			Key key{ loan.user, loan.book };
+			auto pair = pending.find(key);
+
+			// Returned or rescheduled since it was placed
+			if (pair == pending.end() || pair->second != loan.due) {
+				continue;
+			}
+
+			pending.erase(pair);
+			expired[key] = loan.due;
+			fired.push_back(std::move(loan));
+		}
+	}
+
+public:
+
+	/// @brief OverdueTracker constructor.
+	/// @param today The day to start the wheel at.
+	explicit OverdueTracker(std::int64_t today = OverdueTracker::today()) : now(today) { }
+
+	~OverdueTracker() = default;
+
+	/// @brief Gets the current day.
+	/// @returns Days since 1970-01-01.
+	static std::int64_t today()
+	{
+		auto hours = std::chrono::duration_cast<std::chrono::hours>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		return hours / 24;
+	}
+
+	/// @brief Formats a day as YYYY-MM-DD.
+	/// @param day Days since 1970-01-01.
+	/// @returns The formatted date.
+	static std::string format(std::int64_t day)
+	{
+		// Civil-from-days, see http://howardhinnant.github.io/date_algorithms.html
+		day += 719468;
+		std::int64_t era = (day >= 0 ? day : day - 146096) / 146097;
+		std::int64_t doe = day - era * 146097;
+		std::int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		std::int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		std::int64_t mp = (5 * doy + 2) / 153;
+		std::int64_t d = doy - (153 * mp + 2) / 5 + 1;
+		std::int64_t m = mp < 10 ? mp + 3 : mp - 9;
+		std::int64_t y = yoe + era * 400 + (m <= 2);
+
+		std::ostringstream oss;
+		oss << std::setfill('0') << std::setw(4) << y << '-' << std::setw(2) << m << '-' << std::setw(2) << d;
+		return oss.str();
+	}
+
+	/// @brief Gets the last processed day.
+	std::int64_t day() const
+	{
+		return now;
+	}
+
+	/// @brief Starts tracking a loan.
+	/// Rescheduling a loan replaces its due day.
+	/// @param user The borrower's name.
+	/// @param book The packed ISBN.
+	/// @param due The due day.
+	void schedule(const std::string& user, std::uint64_t book, std::int64_t due)
+	{
+		Key key{ user, book };
+		expired.erase(key);
+
+		if (due < now) {
+			pending.erase(key);
+			expired[key] = due;
+			return;
+		}
+
+		pending[key] = due;
+		insert(OverdueLoan{ user, book, due });
+	}
+
+	/// @brief Stops tracking a loan, e.g. when it is returned.
+	/// @param user The borrower's name.
+	/// @param book The packed ISBN.
+	void cancel(const std::string& user, std::uint64_t book)
+	{
+		Key key{ user, book };
+		pending.erase(key);
+		expired.erase(key);
+	}
+
+	/// @brief Stops tracking every loan.
+	void clear()
+	{
+		for (auto& wheel : wheels) {
+			for (auto& slot : wheel) {
+				slot.clear();
+			}
+		}
+
+		overflow.clear();
+		pending.clear();
+		expired.clear();
+	}
+
+	/// @brief Advances the wheel to a day.
+	/// Costs one step per day plus the loans that expire.
+	/// @param today The day to advance to.
+	/// @returns The loans that became overdue.
+	std::vector<OverdueLoan> advance(std::int64_t today = OverdueTracker::today())
+	{
+		std::vector<OverdueLoan> fired;
+		while (now < today) {
+			tick(fired);
+		}
+
+		return fired;
+	}
+
+	/// @brief Checks if a loan is overdue.
+	/// @param user The borrower's name.
+	/// @param book The packed ISBN.
+	/// @returns True if overdue as of the last processed day.
+	bool is_overdue(const std::string& user, std::uint64_t book) const
+	{
+		return expired.count(Key{ user, book }) != 0;
+	}
+
+	/// @brief Gets the number of tracked loans that are not yet overdue.
+	size_t pending_size() const
+	{
+		return pending.size();
+	}
+
+	/// @brief Lists every overdue loan.
+	/// Costs O(overdue), sorted by user then due day.
+	/// @returns The overdue loans.
+	std::vector<OverdueLoan> report() const
+	{
+		std::vector<OverdueLoan> res;
+		res.reserve(expired.size());
+
+		for (const auto& [key, due] : expired) {
+			res.push_back(OverdueLoan{ key.user, key.book, due });
+		}
+
+		std::sort(res.begin(), res.end(), [](const OverdueLoan& a, const OverdueLoan& b) {
+			return a.user != b.user ? a.user < b.user : a.due < b.due;
+		});
+
+		return res;
+	}
+};
+
+#endif // !OVERDUE_H
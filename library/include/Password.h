@@ -0,0 +1,347 @@
+#ifndef PASSWORD_H
+#define PASSWORD_H
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hash_sha256.h"
+#include "hash_sha256_batch.h"
+
+/// Salted, iterated password hashing (PBKDF2-HMAC-SHA256).
+/// Every hash carries its own salt & iteration count, so the cost can
+/// be raised later and old hashes upgraded the next time they verify.
+namespace Password
+{
+	/// A per-user random salt.
+	using salt_type = std::array<std::uint8_t, 16U>;
+
+	/// Iteration count for new hashes.
+	constexpr std::uint32_t ITERATIONS = 100000;
+
+	/// @brief Generates a random salt.
+	inline salt_type make_salt()
+	{
+		static thread_local std::random_device device;
+
+		salt_type salt;
+		for (auto& b : salt) {
+			b = static_cast<std::uint8_t>(device());
+		}
+
+		return salt;
+	}
+
+	/// @brief Compares two hashes in constant time.
+	/// @returns True if equal.
+	inline bool equal(const sha256_type& a, const sha256_type& b)
+	{
+		std::uint8_t diff = 0;
+		for (size_t i = 0; i < a.size(); i++) {
+			diff |= static_cast<std::uint8_t>(a[i] ^ b[i]);
+		}
+
+		return diff == 0;
+	}
+
+	/// HMAC-SHA256 keyed with a password.
+	/// The padded key blocks are built once and reused for every message.
+	class Hmac
+	{
+	private:
+
+		/// The key XOR ipad.
+		std::array<std::uint8_t, 64U> inner{};
+
+		/// The key XOR opad.
+		std::array<std::uint8_t, 64U> outer{};
+
+		/// Hashing state.
+		hash_sha256 hash;
+
+	public:
+
+		/// @brief Hmac constructor.
+		/// @param key The key bytes.
+		/// @param length The key length.
+		Hmac(const std::uint8_t* key, size_t length)
+		{
+			std::array<std::uint8_t, 64U> block{};
+
+			// Keys longer than a block are hashed first
+			if (length > block.size()) {
+				hash.sha256_init();
+				hash.sha256_update(key, length);
+				sha256_type digest = hash.sha256_final();
+				std::copy(digest.begin(), digest.end(), block.begin());
+			}
+			else {
+				std::copy(key, key + length, block.begin());
+			}
+
+			for (size_t i = 0; i < block.size(); i++) {
+				inner[i] = static_cast<std::uint8_t>(block[i] ^ 0x36U);
+				outer[i] = static_cast<std::uint8_t>(block[i] ^ 0x5CU);
+			}
+		}
+
+		/// @brief Gets the key XOR ipad block.
+		const std::array<std::uint8_t, 64U>& inner_pad() const
+		{
+			return inner;
+		}
+
+		/// @brief Gets the key XOR opad block.
+		const std::array<std::uint8_t, 64U>& outer_pad() const
+		{
+			return outer;
+		}
+
+		/// @brief Authenticates a message.
+		/// @param msg The message bytes.
+		/// @param length The message length.
+		/// @returns The MAC.
+		sha256_type operator()(const std::uint8_t* msg, size_t length)
+		{
+			hash.sha256_init();
+			hash.sha256_update(inner.data(), inner.size());
+			hash.sha256_update(msg, length);
+			return finish();
+		}
+
+		/// @brief Authenticates a message given in two parts, without joining them.
+		/// @param msg The first part.
+		/// @param length The first part's length.
+		/// @param tail The second part.
+		/// @param tail_length The second part's length.
+		/// @returns The MAC.
+		sha256_type operator()(const std::uint8_t* msg, size_t length, const std::uint8_t* tail, size_t tail_length)
+		{
+			hash.sha256_init();
+			hash.sha256_update(inner.data(), inner.size());
+			hash.sha256_update(msg, length);
+			hash.sha256_update(tail, tail_length);
+			return finish();
+		}
+
+	private:
+
+		/// @brief Runs the outer hash over the inner digest.
+		/// @returns The MAC.
+		sha256_type finish()
+		{
+			sha256_type digest = hash.sha256_final();
+
+			hash.sha256_init();
+			hash.sha256_update(outer.data(), outer.size());
+			hash.sha256_update(digest.data(), digest.size());
+			return hash.sha256_final();
+		}
+	};
+
+	/// INT(1), the big-endian index of the only block a 32 byte key needs.
+	inline constexpr std::array<std::uint8_t, 4U> BLOCK_INDEX = { 0, 0, 0, 1 };
+
+	/// @brief Derives a 32 byte key with PBKDF2-HMAC-SHA256.
+	/// @param password The password.
+	/// @param salt The salt bytes.
+	/// @param salt_length The salt length.
+	/// @param iterations The iteration count.
+	/// @returns The derived key.
+	inline sha256_type derive(const std::string& password, const std::uint8_t* salt, size_t salt_length, std::uint32_t iterations)
+	{
+		Hmac hmac(reinterpret_cast<const std::uint8_t*>(password.data()), password.size());
+
+		// U1 = HMAC(P, S || INT(1)); everything lives on the stack
+		sha256_type u = hmac(salt, salt_length, BLOCK_INDEX.data(), BLOCK_INDEX.size());
+		sha256_type key = u;
+
+		for (std::uint32_t i = 1; i < iterations; i++) {
+			u = hmac(u.data(), u.size());
+			for (size_t j = 0; j < key.size(); j++) {
+				key[j] ^= u[j];
+			}
+		}
+
+		return key;
+	}
+
+	/// @brief Derives a key with a per-user salt.
+	inline sha256_type derive(const std::string& password, const salt_type& salt, std::uint32_t iterations)
+	{
+		return derive(password, salt.data(), salt.size(), iterations);
+	}
+
+	/// @brief Derives many keys at once, e.g. for a bulk import.
+	/// The iteration chains are independent, so each HMAC step is run for
+	/// every password together through `hash_sha256_batch`'s SIMD lanes.
+	/// @param passwords The passwords.
+	/// @param salts One salt per password.
+	/// @param iterations The iteration count.
+	/// @returns One key per password.
+	inline std::vector<sha256_type> derive(const std::vector<std::string>& passwords, const std::vector<salt_type>& salts, std::uint32_t iterations)
+	{
+		const size_t count = passwords.size();
+		std::vector<sha256_type> keys(count);
+		if (count == 0) {
+			return keys;
+		}
+
+		// Message buffers: a pad block followed by the 32 byte value being MACed
+		std::vector<std::array<std::uint8_t, 96U>> inner(count);
+		std::vector<std::array<std::uint8_t, 96U>> outer(count);
+		std::vector<const std::uint8_t*> inner_ptrs(count);
+		std::vector<const std::uint8_t*> outer_ptrs(count);
+		std::vector<size_t> lengths(count, 96U);
+		std::vector<sha256_type> digests(count);
+		std::vector<sha256_type> u(count);
+
+		for (size_t i = 0; i < count; i++) {
+			Hmac hmac(reinterpret_cast<const std::uint8_t*>(passwords[i].data()), passwords[i].size());
+			std::copy(hmac.inner_pad().begin(), hmac.inner_pad().end(), inner[i].begin());
+			std::copy(hmac.outer_pad().begin(), hmac.outer_pad().end(), outer[i].begin());
+			inner_ptrs[i] = inner[i].data();
+			outer_ptrs[i] = outer[i].data();
+
+			// The first block's message is the salt, so it runs per password
+			u[i] = hmac(salts[i].data(), salts[i].size(), BLOCK_INDEX.data(), BLOCK_INDEX.size());
+			keys[i] = u[i];
+		}
+
+		for (std::uint32_t n = 1; n < iterations; n++) {
+			for (size_t i = 0; i < count; i++) {
+				std::copy(u[i].begin(), u[i].end(), inner[i].begin() + 64);
+			}
+			hash_sha256_batch::hash(inner_ptrs.data(), lengths.data(), count, digests.data());
+
+			for (size_t i = 0; i < count; i++) {
+				std::copy(digests[i].begin(), digests[i].end(), outer[i].begin() + 64);
+			}
+			hash_sha256_batch::hash(outer_ptrs.data(), lengths.data(), count, u.data());
+
+			for (size_t i = 0; i < count; i++) {
+				for (size_t j = 0; j < keys[i].size(); j++) {
+					keys[i][j] ^= u[i][j];
+				}
+			}
+		}
+
+		return keys;
+	}
+
+	/// A fixed pool of threads that verifies passwords.
+	/// Verification is deliberately slow, so concurrent sign ins are
+	/// spread over the cores instead of queuing behind one another.
+	class VerifyPool
+	{
+	private:
+
+		/// The worker threads.
+		std::vector<std::thread> workers;
+
+		/// Jobs waiting for a worker.
+		std::queue<std::packaged_task<bool()>> jobs;
+
+		/// Guards `jobs` & `stopping`.
+		std::mutex lock;
+
+		/// Signals new jobs or shutdown.
+		std::condition_variable ready;
+
+		/// Set when the pool shuts down.
+		bool stopping = false;
+
+		/// @brief Runs jobs until the pool shuts down.
+		void work()
+		{
+			while (true) {
+				std::packaged_task<bool()> job;
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					ready.wait(guard, [this] { return stopping || !jobs.empty(); });
+
+					if (jobs.empty()) {
+						return;
+					}
+
+					job = std::move(jobs.front());
+					jobs.pop();
+				}
+
+				job();
+			}
+		}
+
+	public:
+
+		/// @brief VerifyPool constructor.
+		/// @param threads The number of workers, 0 uses every core.
+		explicit VerifyPool(size_t threads = 0)
+		{
+			if (threads == 0) {
+				threads = std::max(1U, std::thread::hardware_concurrency());
+			}
+
+			for (size_t i = 0; i < threads; i++) {
+				workers.emplace_back([this] { work(); });
+			}
+		}
+
+		VerifyPool(const VerifyPool&) = delete;
+		VerifyPool& operator=(const VerifyPool&) = delete;
+
+		/// Finishes the queued jobs and joins the workers.
+		~VerifyPool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				stopping = true;
+			}
+
+			ready.notify_all();
+			for (std::thread& worker : workers) {
+				worker.join();
+			}
+		}
+
+		/// @brief Queues a verification.
+		/// @param job Returns true if the password matched.
+		/// @returns The job's result.
+		std::future<bool> submit(std::function<bool()> job)
+		{
+			std::packaged_task<bool()> task(std::move(job));
+			std::future<bool> res = task.get_future();
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				jobs.push(std::move(task));
+			}
+
+			ready.notify_one();
+			return res;
+		}
+
+		/// @brief Gets the number of workers.
+		size_t size() const
+		{
+			return workers.size();
+		}
+
+		/// @brief Gets the pool shared by every UserManager.
+		static VerifyPool& shared()
+		{
+			static VerifyPool pool;
+			return pool;
+		}
+	};
+}
+
+#endif // !PASSWORD_H
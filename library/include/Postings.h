@@ -0,0 +1,497 @@
+#ifndef POSTINGS_H
+#define POSTINGS_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LIBRARY_POSTINGS_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+#if defined(LIBRARY_POSTINGS_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define LIBRARY_POSTINGS_AVX2 1
+	#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace LibraryTypes
+{
+	/// Bitwise kernels over 64 bit word arrays, used by `Postings` & `IdSet`.
+	/// Sources are read as raw bytes, so a bitmap kept in a string works too.
+	namespace Bitmap
+	{
+		/// @brief Gets the index of the lowest set bit of a non-zero word.
+		inline unsigned lowest_bit(std::uint64_t word)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, word);
+			return static_cast<unsigned>(index);
+#else
+			return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+		}
+
+		/// @brief Reads a word from a byte buffer.
+		inline std::uint64_t load(const void* src, size_t i)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, static_cast<const char*>(src) + i * sizeof(word), sizeof(word));
+			return word;
+		}
+
+		/// @brief Writes a word to a byte buffer.
+		inline void store(void* dst, size_t i, std::uint64_t word)
+		{
+			std::memcpy(static_cast<char*>(dst) + i * sizeof(word), &word, sizeof(word));
+		}
+
+		/// @brief dst |= src, scalar.
+		inline void or_scalar(std::uint64_t* dst, const void* src, size_t words, size_t first = 0)
+		{
+			for (size_t i = first; i < words; i++) {
+				dst[i] |= load(src, i);
+			}
+		}
+
+		/// @brief dst &= src, scalar.
+		inline void and_scalar(std::uint64_t* dst, const void* src, size_t words, size_t first = 0)
+		{
+			for (size_t i = first; i < words; i++) {
+				dst[i] &= load(src, i);
+			}
+		}
+
+#if LIBRARY_POSTINGS_SSE2
+		/// @brief dst |= src, two words per step.
+		inline void or_sse2(std::uint64_t* dst, const void* src, size_t words, size_t first = 0)
+		{
+			const char* from = static_cast<const char*>(src);
+			size_t i = first;
+			for (; i + 2 <= words; i += 2) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i * 8));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(a, b));
+			}
+
+			or_scalar(dst, src, words, i);
+		}
+
+		/// @brief dst &= src, two words per step.
+		inline void and_sse2(std::uint64_t* dst, const void* src, size_t words, size_t first = 0)
+		{
+			const char* from = static_cast<const char*>(src);
+			size_t i = first;
+			for (; i + 2 <= words; i += 2) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i * 8));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(a, b));
+			}
+
+			and_scalar(dst, src, words, i);
+		}
+#endif
+
+#if LIBRARY_POSTINGS_AVX2
+		/// @brief dst |= src, four words per step.
+		__attribute__((target("avx2")))
+		inline void or_avx2(std::uint64_t* dst, const void* src, size_t words)
+		{
+			const char* from = static_cast<const char*>(src);
+			size_t i = 0;
+			for (; i + 4 <= words; i += 4) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i * 8));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(a, b));
+			}
+
+			or_sse2(dst, src, words, i);
+		}
+
+		/// @brief dst &= src, four words per step.
+		__attribute__((target("avx2")))
+		inline void and_avx2(std::uint64_t* dst, const void* src, size_t words)
+		{
+			const char* from = static_cast<const char*>(src);
+			size_t i = 0;
+			for (; i + 4 <= words; i += 4) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i * 8));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_and_si256(a, b));
+			}
+
+			and_sse2(dst, src, words, i);
+		}
+#endif
+
+		/// Signature shared by the kernels.
+		using combine_fn = void (*)(std::uint64_t*, const void*, size_t);
+
+		/// @brief Picks the widest union kernel the CPU supports.
+		inline combine_fn select_or()
+		{
+#if LIBRARY_POSTINGS_AVX2
+			if (__builtin_cpu_supports("avx2")) {
+				return or_avx2;
+			}
+#endif
+#if LIBRARY_POSTINGS_SSE2
+			return [](std::uint64_t* dst, const void* src, size_t words) { or_sse2(dst, src, words); };
+#else
+			return [](std::uint64_t* dst, const void* src, size_t words) { or_scalar(dst, src, words); };
+#endif
+		}
+
+		/// @brief Picks the widest intersection kernel the CPU supports.
+		inline combine_fn select_and()
+		{
+#if LIBRARY_POSTINGS_AVX2
+			if (__builtin_cpu_supports("avx2")) {
+				return and_avx2;
+			}
+#endif
+#if LIBRARY_POSTINGS_SSE2
+			return [](std::uint64_t* dst, const void* src, size_t words) { and_sse2(dst, src, words); };
+#else
+			return [](std::uint64_t* dst, const void* src, size_t words) { and_scalar(dst, src, words); };
+#endif
+		}
+	}
+
+	class IdSet;
+
+	/// A sorted list of 32 bit book ids, kept in one of two compact forms.
+	/// Sparse lists are delta coded in groups of four: a control byte holds
+	/// the byte length of the four deltas after it, so a group decodes
+	/// without testing every byte for the end of an id. Once a bitmap over
+	/// the list's range is no larger, the list switches to it, like a
+	/// roaring container, and `IdSet` unions it a vector register at a time.
+	/// The bytes live in a `std::string`, whose inline buffer holds short
+	/// lists (the common case, one book per title) without a heap allocation.
+	class Postings
+	{
+		friend class IdSet;
+
+	private:
+
+		/// Lists shorter than this stay delta coded.
+		static constexpr std::uint32_t DENSE_MIN = 64;
+
+		/// Sparse: groups of a control byte and four 1 to 4 byte deltas.
+		/// Dense: the 64 bit words of a bitmap, from word `head` on.
+		std::string bytes;
+
+		/// The number of ids.
+		std::uint32_t count = 0;
+
+		/// The last id, which the next delta is taken from.
+		std::uint32_t last = 0;
+
+		/// Sparse: the offset of the open group's control byte.
+		/// Dense: the index of the bitmap's first word among all ids.
+		std::uint32_t head = 0;
+
+		/// Whether the ids are kept as a bitmap.
+		bool dense = false;
+
+		/// @brief Reads 4 little endian bytes.
+		static std::uint32_t load(const unsigned char* p)
+		{
+			return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 |
+				static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+		}
+
+		/// @brief Reads a little endian delta of up to 4 bytes.
+		static std::uint32_t load(const unsigned char* p, unsigned length)
+		{
+			std::uint32_t value = 0;
+			for (unsigned i = 0; i < length; i++) {
+				value |= static_cast<std::uint32_t>(p[i]) << (i * 8);
+			}
+
+			return value;
+		}
+
+		/// @brief Gets the bytes of a bitmap covering two ids.
+		static size_t span(std::uint32_t low, std::uint32_t high)
+		{
+			return (size_t{ high >> 6 } - (low >> 6) + 1) * sizeof(std::uint64_t);
+		}
+
+		/// @brief Gets the smallest id of a non-empty list.
+		std::uint32_t first() const
+		{
+			const unsigned char* p = reinterpret_cast<const unsigned char*>(bytes.data());
+			if (dense) {
+				return static_cast<std::uint32_t>(size_t{ head } * 64 + Bitmap::lowest_bit(Bitmap::load(p, 0)));
+			}
+
+			return load(p + 1, (p[0] & 3U) + 1);
+		}
+
+		/// @brief Appends a delta coded id.
+		void push(std::uint32_t id)
+		{
+			std::uint32_t delta = count == 0 ? id : id - last;
+			unsigned slot = count % 4;
+			if (slot == 0) {
+				head = static_cast<std::uint32_t>(bytes.size());
+				bytes.push_back('\0');
+			}
+
+			unsigned length = delta < 0x100U ? 1 : delta < 0x10000U ? 2 : delta < 0x1000000U ? 3 : 4;
+			bytes[head] = static_cast<char>(static_cast<unsigned char>(bytes[head]) | ((length - 1) << (slot * 2)));
+			for (unsigned i = 0; i < length; i++, delta >>= 8) {
+				bytes.push_back(static_cast<char>(delta & 0xFFU));
+			}
+
+			last = id;
+			count++;
+		}
+
+		/// @brief Sets a bit of the bitmap.
+		void mark(std::uint32_t id)
+		{
+			size_t bit = id - size_t{ head } * 64;
+			Bitmap::store(&bytes[0], bit / 64, Bitmap::load(bytes.data(), bit / 64) | (std::uint64_t{ 1 } << (bit % 64)));
+		}
+
+		/// @brief Moves the delta coded ids into a bitmap.
+		void pack()
+		{
+			std::uint32_t low = first();
+			Postings list;
+			list.bytes.assign(span(low, last), '\0');
+			list.count = count;
+			list.last = last;
+			list.head = low >> 6;
+			list.dense = true;
+
+			for_each([&list](std::uint32_t id) { list.mark(id); });
+			*this = std::move(list);
+		}
+
+		/// @brief Moves the bitmap's ids back to delta coding.
+		void unpack()
+		{
+			Postings list;
+			for_each([&list](std::uint32_t id) { list.push(id); });
+			*this = std::move(list);
+		}
+
+	public:
+
+		/// @brief Appends an id.
+		/// @param id The id, greater than every id already in the list.
+		void add(std::uint32_t id)
+		{
+			// A bitmap stays while it takes at most 2 bytes an id
+			if (dense && span(first(), id) > (size_t{ count } + 1) * 2) {
+				unpack();
+			}
+
+			if (dense) {
+				bytes.resize(span(first(), id), '\0');
+				mark(id);
+				last = id;
+				count++;
+				return;
+			}
+
+			push(id);
+
+			// Deltas take at least 1.25 bytes an id, so a bitmap this small always wins
+			if (count >= DENSE_MIN && count % 4 == 0 && span(first(), last) <= count) {
+				pack();
+			}
+		}
+
+		/// @brief Calls a function with each id, in ascending order.
+		/// @param visit Called with each id.
+		template <typename Visit>
+		void for_each(Visit visit) const
+		{
+			const unsigned char* p = reinterpret_cast<const unsigned char*>(bytes.data());
+
+			if (dense) {
+				for (size_t i = 0; i < bytes.size() / sizeof(std::uint64_t); i++) {
+					for (std::uint64_t word = Bitmap::load(p, i); word != 0; word &= word - 1) {
+						visit(static_cast<std::uint32_t>((head + i) * 64 + Bitmap::lowest_bit(word)));
+					}
+				}
+				return;
+			}
+
+			static constexpr std::uint32_t MASKS[4] = { 0xFFU, 0xFFFFU, 0xFFFFFFU, 0xFFFFFFFFU };
+			const unsigned char* end = p + bytes.size();
+			std::uint32_t id = 0;
+			std::uint32_t i = 0;
+
+			// Whole groups with 16 bytes to spare: every delta is read as 4 bytes and masked
+			for (; i + 4 <= count && end - p > 16; i += 4) {
+				unsigned control = *p++;
+				unsigned a = control & 3U;
+				unsigned b = (control >> 2) & 3U;
+				unsigned c = (control >> 4) & 3U;
+				unsigned d = control >> 6;
+
+				std::uint32_t delta_a = load(p) & MASKS[a];
+				std::uint32_t delta_b = load(p + a + 1) & MASKS[b];
+				std::uint32_t delta_c = load(p + a + b + 2) & MASKS[c];
+				std::uint32_t delta_d = load(p + a + b + c + 3) & MASKS[d];
+				p += a + b + c + d + 4;
+
+				visit(id += delta_a);
+				visit(id += delta_b);
+				visit(id += delta_c);
+				visit(id += delta_d);
+			}
+
+			for (; i < count; i += 4) {
+				unsigned control = *p++;
+				for (std::uint32_t slot = 0; slot < 4 && i + slot < count; slot++, control >>= 2) {
+					unsigned length = (control & 3U) + 1;
+					id += load(p, length);
+					p += length;
+					visit(id);
+				}
+			}
+		}
+
+		/// @brief Decodes every id.
+		/// @returns The ids, ascending.
+		std::vector<std::uint32_t> decode() const
+		{
+			std::vector<std::uint32_t> ids;
+			ids.reserve(count);
+			for_each([&ids](std::uint32_t id) { ids.push_back(id); });
+			return ids;
+		}
+
+		/// @brief Gets the number of ids.
+		size_t size() const
+		{
+			return count;
+		}
+
+		/// @brief Checks whether the list is empty.
+		bool empty() const
+		{
+			return count == 0;
+		}
+
+		/// @brief Checks whether the ids are kept as a bitmap.
+		bool is_bitmap() const
+		{
+			return dense;
+		}
+
+		/// @brief Gets the size of the encoded ids in bytes.
+		size_t encoded_size() const
+		{
+			return bytes.size();
+		}
+	};
+
+	/// A set of book ids as a bitmap over the catalog.
+	/// Delta coded posting lists are added to it one id at a time; bitmap
+	/// lists and whole sets are combined a vector register at a time.
+	class IdSet
+	{
+	private:
+
+		/// One bit per id.
+		std::vector<std::uint64_t> words;
+
+	public:
+
+		/// @brief IdSet constructor.
+		/// @param universe One past the largest id the set may hold.
+		explicit IdSet(size_t universe = 0) : words((universe + 63) / 64, 0) { }
+
+		/// @brief Adds an id.
+		/// @param id The id, below the universe.
+		void add(std::uint32_t id)
+		{
+			words[id >> 6] |= std::uint64_t{ 1 } << (id & 63U);
+		}
+
+		/// @brief Adds every id of a posting list.
+		void add(const Postings& postings)
+		{
+			static const Bitmap::combine_fn kernel = Bitmap::select_or();
+
+			if (!postings.dense) {
+				postings.for_each([this](std::uint32_t id) { add(id); });
+				return;
+			}
+
+			size_t count = postings.bytes.size() / sizeof(std::uint64_t);
+			if (postings.head + count > words.size()) {
+				words.resize(postings.head + count, 0);
+			}
+			kernel(words.data() + postings.head, postings.bytes.data(), count);
+		}
+
+		/// @brief Checks whether an id is in the set.
+		bool contains(std::uint32_t id) const
+		{
+			return (id >> 6) < words.size() && ((words[id >> 6] >> (id & 63U)) & 1U) != 0;
+		}
+
+		/// @brief Adds every id of another set.
+		void unite(const IdSet& other)
+		{
+			static const Bitmap::combine_fn kernel = Bitmap::select_or();
+
+			if (other.words.size() > words.size()) {
+				words.resize(other.words.size(), 0);
+			}
+			kernel(words.data(), other.words.data(), other.words.size());
+		}
+
+		/// @brief Keeps only the ids also in another set.
+		void intersect(const IdSet& other)
+		{
+			static const Bitmap::combine_fn kernel = Bitmap::select_and();
+
+			if (other.words.size() < words.size()) {
+				words.resize(other.words.size());
+			}
+			kernel(words.data(), other.words.data(), words.size());
+		}
+
+		/// @brief Counts the ids.
+		size_t count() const
+		{
+			size_t total = 0;
+			for (std::uint64_t word : words) {
+				total += std::bitset<64>(word).count();
+			}
+
+			return total;
+		}
+
+		/// @brief Calls a function with each id, in ascending order.
+		/// @param visit Called with each id.
+		template <typename Visit>
+		void for_each(Visit visit) const
+		{
+			for (size_t i = 0; i < words.size(); i++) {
+				for (std::uint64_t word = words[i]; word != 0; word &= word - 1) {
+					visit(static_cast<std::uint32_t>(i * 64 + Bitmap::lowest_bit(word)));
+				}
+			}
+		}
+	};
+}
+
+#endif // !POSTINGS_H
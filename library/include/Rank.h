@@ -0,0 +1,136 @@
+#ifndef RANK_H
+#define RANK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <queue>
+#include <string_view>
+#include <vector>
+
+namespace LibraryTypes
+{
+	/// How closely a search key matched a term.
+	enum RELEVANCE : std::uint32_t
+	{
+		/// The term occurs inside the key
+		SUBSTRING,
+
+		/// The term starts a word of the key
+		WORD,
+
+		/// The key starts with the term
+		PREFIX,
+
+		/// The key is the term
+		EXACT
+	};
+
+	/// A single ranked search hit.
+	struct Hit
+	{
+	public:
+		/// How closely the key matched.
+		std::uint32_t relevance;
+
+		/// How often the book was borrowed.
+		std::uint32_t popularity;
+
+		/// Index of the book in `Library::books`.
+		size_t index;
+
+		/// @brief Orders hits best first.
+		/// Relevance wins, then popularity, then catalog order.
+		/// @param other The hit to compare.
+		/// @returns True if this hit ranks above the other.
+		bool better(const Hit& other) const
+		{
+			if (relevance != other.relevance) {
+				return relevance > other.relevance;
+			}
+
+			if (popularity != other.popularity) {
+				return popularity > other.popularity;
+			}
+
+			return index < other.index;
+		}
+	};
+
+	/// @brief Grades a match found by `Text::ifind`.
+	/// @param key The matched key.
+	/// @param length The term length.
+	/// @param pos The match position.
+	/// @returns The relevance of the match.
+	inline std::uint32_t grade(std::string_view key, size_t length, size_t pos)
+	{
+		if (pos == 0) {
+			return key.size() == length ? EXACT : PREFIX;
+		}
+
+		return key[pos - 1] == ' ' ? WORD : SUBSTRING;
+	}
+
+	/// Keeps the best K hits in a bounded heap.
+	/// Each push costs O(log K) no matter how many hits there are,
+	/// so a short query matching half the catalog never sorts it all.
+	class TopK
+	{
+	private:
+
+		/// Orders the heap so the worst kept hit is on top.
+		struct Worse
+		{
+			bool operator()(const Hit& a, const Hit& b) const
+			{
+				return a.better(b);
+			}
+		};
+
+		/// The number of hits to keep, 0 keeps every hit.
+		size_t limit;
+
+		/// The kept hits, worst on top.
+		std::priority_queue<Hit, std::vector<Hit>, Worse> heap;
+
+	public:
+
+		/// @brief TopK constructor.
+		/// @param limit The number of hits to keep, 0 keeps every hit.
+		explicit TopK(size_t limit) : limit(limit) { }
+
+		~TopK() = default;
+
+		/// @brief Offers a hit.
+		/// @param hit The hit to keep if it ranks in the top K.
+		void push(const Hit& hit)
+		{
+			if (limit != 0 && heap.size() == limit) {
+				if (!hit.better(heap.top())) {
+					return;
+				}
+
+				heap.pop();
+			}
+
+			heap.push(hit);
+		}
+
+		/// @brief Gets the kept hits.
+		/// @returns The hits, best first.
+		std::vector<Hit> take()
+		{
+			std::vector<Hit> hits;
+			hits.reserve(heap.size());
+
+			while (!heap.empty()) {
+				hits.push_back(heap.top());
+				heap.pop();
+			}
+
+			std::reverse(hits.begin(), hits.end());
+			return hits;
+		}
+	};
+}
+
+#endif // !RANK_H
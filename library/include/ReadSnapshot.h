@@ -0,0 +1,113 @@
+#ifndef READ_SNAPSHOT_H
+#define READ_SNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+namespace LibraryTypes
+{
+	/// A consistent, read-only view of a catalog's books at one moment.
+	/// The books are held in immutable shared segments: segments that did
+	/// not change between two snapshots are shared by both, and a segment
+	/// is freed as soon as the last snapshot holding it closes.
+	/// A snapshot never refers back to its library, so it may be read on
+	/// any thread while the library keeps changing.
+	/// @tparam Item The record type, `Book` for a library.
+	template <typename Item>
+	class ReadSnapshot
+	{
+	public:
+
+		/// One immutable run of records.
+		using Segment = std::vector<Item>;
+
+		/// Records per segment.
+		static constexpr size_t SEGMENT = 1024;
+
+	private:
+
+		/// The segments, in catalog order; all but the last hold `SEGMENT` records.
+		std::vector<std::shared_ptr<const Segment>> segments;
+
+		/// The number of records.
+		size_t count = 0;
+
+		/// The library generation the snapshot was taken at.
+		std::uint64_t taken_at = 0;
+
+	public:
+
+		ReadSnapshot() = default;
+
+		/// @brief ReadSnapshot constructor.
+		/// @param segments The segments.
+		/// @param count The number of records across them.
+		/// @param version The library generation.
+		ReadSnapshot(std::vector<std::shared_ptr<const Segment>> segments, size_t count, std::uint64_t version)
+			: segments(std::move(segments)), count(count), taken_at(version) { }
+
+		/// @brief Gets a record.
+		/// @param index The record's position in the catalog, below `size`.
+		const Item& operator[](size_t index) const
+		{
+			return (*segments[index / SEGMENT])[index % SEGMENT];
+		}
+
+		/// @brief Calls a function with each record, in catalog order.
+		/// @param visit Called with each record.
+		template <typename Visit>
+		void for_each(Visit visit) const
+		{
+			for (const std::shared_ptr<const Segment>& segment : segments) {
+				for (const Item& item : *segment) {
+					visit(item);
+				}
+			}
+		}
+
+		/// @brief Gets the segments, e.g. to scan them on several threads.
+		const std::vector<std::shared_ptr<const Segment>>& parts() const
+		{
+			return segments;
+		}
+
+		/// @brief Gets the number of records.
+		size_t size() const
+		{
+			return count;
+		}
+
+		/// @brief Checks whether the snapshot holds no records.
+		bool empty() const
+		{
+			return count == 0;
+		}
+
+		/// @brief Gets the library generation the snapshot was taken at.
+		std::uint64_t version() const
+		{
+			return taken_at;
+		}
+
+		/// @brief Exports the records as a JSON array.
+		std::string save_as_json() const
+		{
+			nlohmann::json j = nlohmann::json::array();
+			for_each([&j](const Item& item) { j.push_back(item); });
+			return j.dump();
+		}
+
+		/// @brief Releases the snapshot's segments.
+		void close()
+		{
+			segments.clear();
+			count = 0;
+		}
+	};
+}
+
+#endif // !READ_SNAPSHOT_H
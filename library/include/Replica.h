@@ -0,0 +1,444 @@
+#ifndef REPLICA_H
+#define REPLICA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define LIBRARY_REPLICA_MMAP 1
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace LibraryTypes
+{
+	/// A read-only catalog image shared between processes.
+	/// A writer process publishes the catalog, its ISBN index and borrow
+	/// counts as one flat file; readers map it read-only, so every
+	/// process on the host shares the same page cache copy and none of
+	/// them parses JSON or builds indexes.
+	/// Publishing writes a temporary file and renames it over the old
+	/// one, so readers see either generation whole, never a mix.
+	class CatalogReplica
+	{
+	private:
+
+		/// Identifies an image file.
+		static constexpr char MAGIC[8] = { 'L', 'I', 'B', 'C', 'A', 'T', 'I', 'M' };
+
+		/// Image layout version.
+		static constexpr std::uint32_t VERSION = 1;
+
+		/// The image header. The sections follow in order:
+		/// rows, ISBNs, ISBN order, text.
+		struct Header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t reserved;
+			std::uint64_t generation;
+			std::uint64_t rows;
+			std::uint64_t text;
+		};
+
+		/// A book's location in the text section & its borrow count.
+		struct Row
+		{
+			std::uint32_t title_offset;
+			std::uint32_t title_length;
+			std::uint32_t author_offset;
+			std::uint32_t author_length;
+			std::uint32_t code_offset;
+			std::uint32_t code_length;
+			std::uint32_t popularity;
+			std::uint32_t reserved;
+		};
+
+		/// The mapped image, or nullptr.
+		const std::uint8_t* base = nullptr;
+
+		/// The mapped length.
+		size_t length = 0;
+
+		/// The image copy when memory mapping is unavailable.
+		std::vector<std::uint64_t> buffer;
+
+		/// The file the image was opened from.
+		std::filesystem::path source;
+
+		/// Identity of the mapped file, to notice a swap.
+		std::uint64_t file_id = 0;
+
+		/// Views into the image.
+		const Header* header = nullptr;
+		const Row* rows = nullptr;
+		const std::uint64_t* isbns = nullptr;
+		const std::uint32_t* order = nullptr;
+		const char* text = nullptr;
+
+		/// @brief Gets the bytes needed before the text section.
+		static size_t text_start(std::uint64_t count)
+		{
+			size_t bytes = sizeof(Header) + count * (sizeof(Row) + sizeof(std::uint64_t) + sizeof(std::uint32_t));
+			return (bytes + 7) & ~size_t(7);
+		}
+
+		/// @brief Identifies the file currently at a path.
+		/// @returns 0 if it does not exist.
+		static std::uint64_t identify(const std::filesystem::path& path)
+		{
+#if LIBRARY_REPLICA_MMAP
+			struct stat info;
+			if (::stat(path.c_str(), &info) != 0) {
+				return 0;
+			}
+
+			return (static_cast<std::uint64_t>(info.st_dev) << 32) ^ static_cast<std::uint64_t>(info.st_ino);
+#else
+			std::error_code error;
+			auto time = std::filesystem::last_write_time(path, error);
+			return error ? 0 : static_cast<std::uint64_t>(time.time_since_epoch().count());
+#endif
+		}
+
+		/// @brief Releases the current image.
+		void unmap()
+		{
+#if LIBRARY_REPLICA_MMAP
+			if (base != nullptr && buffer.empty()) {
+				::munmap(const_cast<std::uint8_t*>(base), length);
+			}
+#endif
+			buffer.clear();
+			base = nullptr;
+			length = 0;
+			header = nullptr;
+			rows = nullptr;
+			isbns = nullptr;
+			order = nullptr;
+			text = nullptr;
+		}
+
+		/// @brief Checks an image & sets up the section views.
+		/// @returns False if the image is malformed.
+		bool attach()
+		{
+			if (length < sizeof(Header)) {
+				return false;
+			}
+
+			header = reinterpret_cast<const Header*>(base);
+			if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) {
+				return false;
+			}
+
+			// Subtracting, as a huge text length could wrap the sum back to `length`
+			std::uint64_t count = header->rows;
+			if (count > length || text_start(count) > length || header->text != length - text_start(count)) {
+				return false;
+			}
+
+			rows = reinterpret_cast<const Row*>(base + sizeof(Header));
+			isbns = reinterpret_cast<const std::uint64_t*>(rows + count);
+			order = reinterpret_cast<const std::uint32_t*>(isbns + count);
+			text = reinterpret_cast<const char*>(base + text_start(count));
+
+			for (std::uint64_t i = 0; i < count; i++) {
+				const Row& row = rows[i];
+				if (std::uint64_t(row.title_offset) + row.title_length > header->text
+					|| std::uint64_t(row.author_offset) + row.author_length > header->text
+					|| std::uint64_t(row.code_offset) + row.code_length > header->text
+					|| order[i] >= count) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		/// @brief Maps a file.
+		/// @returns False if it could not be read or is malformed.
+		bool map(const std::filesystem::path& path)
+		{
+			std::uint64_t id = identify(path);
+
+#if LIBRARY_REPLICA_MMAP
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return false;
+			}
+
+			struct stat info;
+			if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+				::close(fd);
+				return false;
+			}
+
+			length = static_cast<size_t>(info.st_size);
+			void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+
+			if (mapped == MAP_FAILED) {
+				length = 0;
+				return false;
+			}
+
+			base = static_cast<const std::uint8_t*>(mapped);
+			id = (static_cast<std::uint64_t>(info.st_dev) << 32) ^ static_cast<std::uint64_t>(info.st_ino);
+#else
+			std::ifstream in(path, std::ios::binary | std::ios::ate);
+			if (!in.is_open()) {
+				return false;
+			}
+
+			length = static_cast<size_t>(in.tellg());
+			buffer.resize((length + 7) / 8);
+			in.seekg(0);
+			in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(length));
+			base = reinterpret_cast<const std::uint8_t*>(buffer.data());
+#endif
+
+			if (!attach()) {
+				unmap();
+				return false;
+			}
+
+			source = path;
+			file_id = id;
+			return true;
+		}
+
+	public:
+
+		CatalogReplica() = default;
+
+		/// Copies map the same file again, sharing its pages.
+		CatalogReplica(const CatalogReplica& other)
+		{
+			if (other.is_open()) {
+				map(other.source);
+			}
+		}
+
+		CatalogReplica& operator=(const CatalogReplica& other)
+		{
+			if (this != &other) {
+				close();
+				if (other.is_open()) {
+					map(other.source);
+				}
+			}
+
+			return *this;
+		}
+
+		~CatalogReplica()
+		{
+			unmap();
+		}
+
+		/// @brief Writes a new generation of the image.
+		/// The file is written beside the target and renamed over it.
+		/// @param path The image file.
+		/// @param titles The book titles.
+		/// @param authors The book authors.
+		/// @param codes The ISBN codes.
+		/// @param packed The packed ISBNs.
+		/// @param popularity The borrow counts.
+		/// @returns The published generation, 0 on failure.
+		static std::uint64_t publish(
+			const std::filesystem::path& path,
+			const std::vector<std::string_view>& titles,
+			const std::vector<std::string_view>& authors,
+			const std::vector<std::string_view>& codes,
+			const std::vector<std::uint64_t>& packed,
+			const std::vector<std::uint32_t>& popularity)
+		{
+			const size_t count = titles.size();
+
+			// The next generation follows whatever is published now
+			std::uint64_t generation = 1;
+			{
+				CatalogReplica current;
+				if (current.open(path)) {
+					generation = current.generation() + 1;
+				}
+			}
+
+			std::vector<Row> table(count);
+			std::string bytes;
+			for (size_t i = 0; i < count; i++) {
+				Row& row = table[i];
+				row.title_offset = static_cast<std::uint32_t>(bytes.size());
+				row.title_length = static_cast<std::uint32_t>(titles[i].size());
+				bytes += titles[i];
+				row.author_offset = static_cast<std::uint32_t>(bytes.size());
+				row.author_length = static_cast<std::uint32_t>(authors[i].size());
+				bytes += authors[i];
+				row.code_offset = static_cast<std::uint32_t>(bytes.size());
+				row.code_length = static_cast<std::uint32_t>(codes[i].size());
+				bytes += codes[i];
+				row.popularity = popularity[i];
+				row.reserved = 0;
+			}
+
+			std::vector<std::uint32_t> sorted(count);
+			for (size_t i = 0; i < count; i++) {
+				sorted[i] = static_cast<std::uint32_t>(i);
+			}
+			std::sort(sorted.begin(), sorted.end(), [&packed](std::uint32_t a, std::uint32_t b) {
+				return packed[a] != packed[b] ? packed[a] < packed[b] : a < b;
+			});
+
+			Header head{};
+			std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+			head.version = VERSION;
+			head.generation = generation;
+			head.rows = count;
+			head.text = bytes.size();
+
+			std::filesystem::path temp = path;
+			temp += ".tmp";
+
+			{
+				std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+				if (!out.is_open()) {
+					return 0;
+				}
+
+				out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+				out.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(count * sizeof(Row)));
+				out.write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(count * sizeof(std::uint64_t)));
+				out.write(reinterpret_cast<const char*>(sorted.data()), static_cast<std::streamsize>(count * sizeof(std::uint32_t)));
+
+				size_t written = sizeof(Header) + count * (sizeof(Row) + sizeof(std::uint64_t) + sizeof(std::uint32_t));
+				const char pad[8] = {};
+				out.write(pad, static_cast<std::streamsize>(text_start(count) - written));
+				out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+				if (!out.good()) {
+					return 0;
+				}
+			}
+
+			std::error_code error;
+			std::filesystem::rename(temp, path, error);
+			return error ? 0 : generation;
+		}
+
+		/// @brief Opens an image read-only.
+		/// @param path The image file.
+		/// @returns False if it could not be read or is malformed.
+		bool open(const std::filesystem::path& path)
+		{
+			unmap();
+			return map(path);
+		}
+
+		/// @brief Picks up a newer generation if one was published.
+		/// Costs one stat when nothing changed. The current image stays
+		/// open if the new one cannot be read.
+		/// @returns True if a new generation was mapped.
+		bool refresh()
+		{
+			if (!is_open() || identify(source) == file_id) {
+				return false;
+			}
+
+			CatalogReplica next;
+			if (!next.map(source)) {
+				return false;
+			}
+
+			std::swap(base, next.base);
+			std::swap(length, next.length);
+			std::swap(buffer, next.buffer);
+			std::swap(file_id, next.file_id);
+			std::swap(header, next.header);
+			std::swap(rows, next.rows);
+			std::swap(isbns, next.isbns);
+			std::swap(order, next.order);
+			std::swap(text, next.text);
+			return true;
+		}
+
+		/// @brief Closes the image.
+		void close()
+		{
+			unmap();
+			source.clear();
+			file_id = 0;
+		}
+
+		/// @brief Checks if an image is open.
+		bool is_open() const
+		{
+			return base != nullptr;
+		}
+
+		/// @brief Gets the generation of the open image.
+		std::uint64_t generation() const
+		{
+			return header == nullptr ? 0 : header->generation;
+		}
+
+		/// @brief Gets the number of books.
+		size_t size() const
+		{
+			return header == nullptr ? 0 : static_cast<size_t>(header->rows);
+		}
+
+		/// @brief Gets a title.
+		std::string_view title(size_t row) const
+		{
+			return std::string_view(text + rows[row].title_offset, rows[row].title_length);
+		}
+
+		/// @brief Gets an author.
+		std::string_view author(size_t row) const
+		{
+			return std::string_view(text + rows[row].author_offset, rows[row].author_length);
+		}
+
+		/// @brief Gets an ISBN code.
+		std::string_view code(size_t row) const
+		{
+			return std::string_view(text + rows[row].code_offset, rows[row].code_length);
+		}
+
+		/// @brief Gets a packed ISBN.
+		std::uint64_t isbn(size_t row) const
+		{
+			return isbns[row];
+		}
+
+		/// @brief Gets a borrow count as of the image's generation.
+		std::uint32_t popularity(size_t row) const
+		{
+			return rows[row].popularity;
+		}
+
+		/// @brief Finds a book by packed ISBN through the sorted index.
+		/// @returns The row, or `size()` if not found.
+		size_t find_isbn(std::uint64_t packed) const
+		{
+			const std::uint32_t* first = order;
+			const std::uint32_t* last = order + size();
+			const std::uint32_t* it = std::lower_bound(first, last, packed, [this](std::uint32_t row, std::uint64_t value) {
+				return isbns[row] < value;
+			});
+
+			return (it != last && isbns[*it] == packed) ? *it : size();
+		}
+	};
+}
+
+#endif // !REPLICA_H
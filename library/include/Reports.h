@@ -0,0 +1,451 @@
+#ifndef REPORTS_H
+#define REPORTS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "LibTypes.h"
+#include "Overdue.h"
+#include "User.h"
+
+/// Aggregate reports over the catalog and the loans.
+/// Every query is a partitioned scan: each thread aggregates its own
+/// slice of a table into a private partial result, and the partials
+/// are merged once all threads are done, so the scan takes no locks.
+/// The catalog and the loans are snapshotted together when the reports
+/// are opened, so every query sees the same moment and the scans never
+/// read users that are being changed. Loans whose book has no record
+/// are left out of the per-book figures and counted instead.
+class Reports
+{
+public:
+
+	/// Books on the shelf and on loan by one author.
+	struct AuthorCount
+	{
+		std::string author;
+		size_t on_shelf = 0;
+		size_t on_loan = 0;
+	};
+
+	/// How many books a user has out.
+	struct UserLoans
+	{
+		std::string name;
+		size_t loans = 0;
+		size_t overdue = 0;
+	};
+
+	/// Copies of one title on the shelf and on loan.
+	struct Availability
+	{
+		LibraryTypes::Book book;
+		size_t on_shelf = 0;
+		size_t on_loan = 0;
+
+		/// @brief Gets the share of copies on the shelf, from 0 to 1.
+		double ratio() const
+		{
+			size_t total = on_shelf + on_loan;
+			return total == 0 ? 0.0 : static_cast<double>(on_shelf) / static_cast<double>(total);
+		}
+	};
+
+	/// How often a title was borrowed.
+	struct Borrowed
+	{
+		LibraryTypes::Book book;
+		size_t loans = 0;
+	};
+
+	/// How long a query took.
+	struct Timing
+	{
+		std::string query;
+		double ms = 0;
+		size_t rows = 0;
+		size_t threads = 0;
+	};
+
+	/// Rows below which a table is scanned on a single thread.
+	static constexpr size_t MIN_ROWS = 4096;
+
+private:
+
+	/// One user's loans.
+	struct LoanRow
+	{
+		std::string name;
+		std::vector<Loan> loans;
+	};
+
+	/// The catalog, as it was when the reports were opened.
+	LibraryTypes::BookSnapshot catalog;
+
+	/// Every user's loans, as they were when the reports were opened.
+	std::vector<LoanRow> loan_table;
+
+	/// Every loan ever made, as it was when the reports were opened.
+	std::vector<LibraryTypes::LoanEvent> events;
+
+	/// The books on loan or ever borrowed, by packed ISBN.
+	std::unordered_map<std::uint64_t, LibraryTypes::Book> records;
+
+	/// Threads per scan at most.
+	size_t threads;
+
+	/// The day loans are checked against for being overdue.
+	std::int64_t today;
+
+	/// Timings of the queries run so far.
+	std::vector<Timing> timings;
+
+	/// Loans the last query could not resolve to a book.
+	size_t unresolved = 0;
+
+	/// @brief Scans a table in parallel partitions.
+	/// @param query The query's name, for its timing.
+	/// @param rows The number of rows.
+	/// @param scan Called as `scan(first, last, partial)` for each partition.
+	/// @param merge Called as `merge(into, partial)` for each partial after the first.
+	/// @returns The merged partial.
+	/// @throws Whatever a scan threw, once every thread has joined.
+	template <typename Partial, typename Scan, typename Merge>
+	Partial run(const std::string& query, size_t rows, Scan scan, Merge merge)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		size_t workers = std::max<size_t>(1, std::min(threads, rows / MIN_ROWS));
+		size_t per = (rows + workers - 1) / workers;
+		std::vector<Partial> partials(workers);
+		std::vector<std::exception_ptr> errors(workers);
+
+		// An exception escaping a thread would terminate, so each worker keeps its own
+		auto work = [&](size_t worker)
+		{
+			try
+			{
+				scan(std::min(rows, worker * per), std::min(rows, (worker + 1) * per), partials[worker]);
+			}
+			catch (...)
+			{
+				errors[worker] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (size_t worker = 1; worker < workers; worker++)
+		{
+			pool.emplace_back(work, worker);
+		}
+		work(0);
+
+		for (std::thread& thread : pool)
+		{
+			thread.join();
+		}
+
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+
+		for (size_t worker = 1; worker < workers; worker++)
+		{
+			merge(partials[0], partials[worker]);
+		}
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		timings.push_back(Timing{ query, ms, rows, workers });
+
+		return std::move(partials[0]);
+	}
+
+	/// @brief Adds one count map into another.
+	template <typename Key, typename Value>
+	static void add_counts(std::unordered_map<Key, Value>& into, std::unordered_map<Key, Value>& partial)
+	{
+		for (auto& [key, value] : partial)
+		{
+			into[key] += value;
+		}
+	}
+
+	/// @brief Adds up the catalog's copies per key.
+	template <typename KeyOf>
+	auto shelf_counts(const std::string& query, KeyOf key_of) -> std::unordered_map<decltype(key_of(std::declval<const LibraryTypes::Book&>())), size_t>
+	{
+		using Map = std::unordered_map<decltype(key_of(std::declval<const LibraryTypes::Book&>())), size_t>;
+		return run<Map>(query, catalog.size(),
+			[this, &key_of](size_t first, size_t last, Map& partial)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					partial[key_of(catalog[i])]++;
+				}
+			},
+			add_counts<typename Map::key_type, size_t>);
+	}
+
+	/// @brief Adds up the current loans per book.
+	/// @returns Loans per packed ISBN.
+	std::unordered_map<std::uint64_t, size_t> loan_counts(const std::string& query)
+	{
+		using Map = std::unordered_map<std::uint64_t, size_t>;
+		return run<Map>(query, loan_table.size(),
+			[this](size_t first, size_t last, Map& partial)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					for (const Loan& loan : loan_table[i].loans)
+					{
+						partial[loan.book]++;
+					}
+				}
+			},
+			add_counts<std::uint64_t, size_t>);
+	}
+
+	/// @brief Gets the record of a book on loan or ever borrowed.
+	/// @returns The book, or null if it has no record.
+	const LibraryTypes::Book* record(std::uint64_t id) const
+	{
+		auto pair = records.find(id);
+		return pair == records.end() ? nullptr : &pair->second;
+	}
+
+public:
+
+	/// @brief Reports constructor; snapshots the catalog & the loans.
+	/// @param um The users.
+	/// @param lib The catalog.
+	/// @param threads Threads per scan at most; 0 uses one per hardware thread.
+	/// @param today The day loans are checked against for being overdue.
+	Reports(const UserManager& um, LibraryTypes::Library& lib, size_t threads = 0, std::int64_t today = OverdueTracker::today())
+		: catalog(lib.snapshot()), threads(threads == 0 ? std::max(1U, std::thread::hardware_concurrency()) : threads), today(today)
+	{
+		loan_table.reserve(um.all().size());
+		for (const User& user : um.all())
+		{
+			loan_table.push_back(LoanRow{ user.name, user.loans });
+			for (const Loan& loan : user.loans)
+			{
+				if (records.count(loan.book) == 0)
+				{
+					if (const LibraryTypes::Book* book = um.find_book(loan))
+					{
+						records.emplace(loan.book, *book);
+					}
+				}
+			}
+		}
+
+		const LibraryTypes::LoanHistory& history = um.loan_history();
+		events = history.loans();
+		for (const LibraryTypes::LoanEvent& event : events)
+		{
+			if (records.count(event.book) == 0)
+			{
+				if (const LibraryTypes::Book* book = history.book(event.book))
+				{
+					records.emplace(event.book, *book);
+				}
+			}
+		}
+	}
+
+	~Reports() { }
+
+	/// @brief Groups the books by author.
+	/// @returns Copies on the shelf & on loan per author, most books first.
+	std::vector<AuthorCount> by_author()
+	{
+		std::unordered_map<std::string, size_t> shelf = shelf_counts("by_author shelf",
+			[](const LibraryTypes::Book& book) { return book.author; });
+		std::unordered_map<std::uint64_t, size_t> loaned = loan_counts("by_author loans");
+
+		std::unordered_map<std::string, AuthorCount> authors;
+		for (const auto& [author, count] : shelf)
+		{
+			authors[author].on_shelf = count;
+		}
+
+		// Titles are resolved once each, after the scan
+		unresolved = 0;
+		for (const auto& [id, count] : loaned)
+		{
+			const LibraryTypes::Book* book = record(id);
+			if (book == nullptr)
+			{
+				unresolved += count;
+				continue;
+			}
+			authors[book->author].on_loan += count;
+		}
+
+		std::vector<AuthorCount> res;
+		res.reserve(authors.size());
+		for (auto& [author, count] : authors)
+		{
+			count.author = author;
+			res.push_back(count);
+		}
+
+		std::sort(res.begin(), res.end(), [](const AuthorCount& a, const AuthorCount& b)
+		{
+			size_t total_a = a.on_shelf + a.on_loan;
+			size_t total_b = b.on_shelf + b.on_loan;
+			return total_a != total_b ? total_a > total_b : a.author < b.author;
+		});
+
+		return res;
+	}
+
+	/// @brief Counts each user's loans.
+	/// @returns Loans & overdue loans per user, most loans first.
+	std::vector<UserLoans> loans_per_user()
+	{
+		std::vector<UserLoans> res = run<std::vector<UserLoans>>("loans_per_user", loan_table.size(),
+			[this](size_t first, size_t last, std::vector<UserLoans>& partial)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					UserLoans row{ loan_table[i].name, loan_table[i].loans.size(), 0 };
+					for (const Loan& loan : loan_table[i].loans)
+					{
+						row.overdue += (loan.due != 0 && loan.due < today) ? 1 : 0;
+					}
+					partial.push_back(row);
+				}
+			},
+			[](std::vector<UserLoans>& into, std::vector<UserLoans>& partial)
+			{
+				into.insert(into.end(), partial.begin(), partial.end());
+			});
+
+		std::stable_sort(res.begin(), res.end(), [](const UserLoans& a, const UserLoans& b) { return a.loans > b.loans; });
+		return res;
+	}
+
+	/// @brief Works out how much of each title is on the shelf.
+	/// @returns Copies per title, least available first.
+	std::vector<Availability> availability()
+	{
+		std::unordered_map<std::uint64_t, size_t> shelf = shelf_counts("availability shelf",
+			[](const LibraryTypes::Book& book) { return book.isbn.packed(); });
+		std::unordered_map<std::uint64_t, size_t> loaned = loan_counts("availability loans");
+
+		std::unordered_map<std::uint64_t, const LibraryTypes::Book*> books;
+		catalog.for_each([&books](const LibraryTypes::Book& book) { books.emplace(book.isbn.packed(), &book); });
+
+		std::vector<Availability> res;
+		for (const auto& [id, count] : shelf)
+		{
+			auto pair = loaned.find(id);
+			res.push_back(Availability{ *books.at(id), count, pair == loaned.end() ? 0 : pair->second });
+		}
+		unresolved = 0;
+		for (const auto& [id, count] : loaned)
+		{
+			if (shelf.count(id) != 0)
+			{
+				continue;
+			}
+
+			const LibraryTypes::Book* book = record(id);
+			if (book == nullptr)
+			{
+				unresolved += count;
+				continue;
+			}
+			res.push_back(Availability{ *book, 0, count });
+		}
+
+		std::sort(res.begin(), res.end(), [](const Availability& a, const Availability& b)
+		{
+			return a.ratio() != b.ratio() ? a.ratio() < b.ratio() : a.book.title < b.book.title;
+		});
+
+		return res;
+	}
+
+	/// @brief Gets the share of all copies that are on the shelf, from 0 to 1.
+	double availability_ratio()
+	{
+		size_t on_loan = 0;
+		for (const auto& [id, count] : loan_counts("availability_ratio"))
+		{
+			on_loan += count;
+		}
+
+		size_t total = catalog.size() + on_loan;
+		return total == 0 ? 0.0 : static_cast<double>(catalog.size()) / static_cast<double>(total);
+	}
+
+	/// @brief Ranks titles by how often they were ever borrowed.
+	/// @param n The number of titles.
+	/// @returns Up to `n` titles, most borrowed first.
+	std::vector<Borrowed> top_borrowed(size_t n = 10)
+	{
+		using Map = std::unordered_map<std::uint64_t, size_t>;
+		Map counts = run<Map>("top_borrowed", events.size(),
+			[this](size_t first, size_t last, Map& partial)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					partial[events[i].book]++;
+				}
+			},
+			add_counts<std::uint64_t, size_t>);
+
+		std::vector<std::pair<std::uint64_t, size_t>> ranked(counts.begin(), counts.end());
+		auto better = [](const std::pair<std::uint64_t, size_t>& a, const std::pair<std::uint64_t, size_t>& b)
+		{
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		};
+
+		size_t kept = std::min(n, ranked.size());
+		std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(kept), ranked.end(), better);
+
+		std::vector<Borrowed> res;
+		for (size_t i = 0; i < kept; i++)
+		{
+			if (const LibraryTypes::Book* book = record(ranked[i].first))
+			{
+				res.push_back(Borrowed{ *book, ranked[i].second });
+			}
+		}
+
+		return res;
+	}
+
+	/// @brief Gets the timing of every query run so far, in order.
+	const std::vector<Timing>& timing() const
+	{
+		return timings;
+	}
+
+	/// @brief Gets the loans the last `by_author` or `availability` left out
+	/// because their book had no record.
+	size_t missing() const
+	{
+		return unresolved;
+	}
+
+	/// @brief Gets the catalog snapshot the reports read.
+	const LibraryTypes::BookSnapshot& books() const
+	{
+		return catalog;
+	}
+};
+
+#endif // !REPORTS_H
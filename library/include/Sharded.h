@@ -0,0 +1,401 @@
+#ifndef SHARDED_H
+#define SHARDED_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+#include "LibTypes.h"
+
+namespace LibraryTypes
+{
+	/// A catalog partitioned across several `Library` shards by ISBN hash.
+	/// Each shard owns its indexes and is only ever touched by its own
+	/// worker thread, so shards need no locks and work on different
+	/// shards runs in parallel. Point lookups go to a single shard;
+	/// searches are sent to every shard and their ranked results merged,
+	/// keeping only the best K.
+	/// Shards never write to disk themselves; use `save_as_json` & `load`.
+	class ShardedLibrary
+	{
+	private:
+
+		/// One partition and the thread that serves it.
+		struct Shard
+		{
+			/// The shard's books & indexes, owned by `worker`.
+			Library lib;
+
+			/// Serves `tasks` in order.
+			std::thread worker;
+
+			/// Guards `tasks` & `stopping`.
+			std::mutex lock;
+
+			/// Signalled when a task is queued or the shard stops.
+			std::condition_variable ready;
+
+			/// Queued work.
+			std::deque<std::function<void()>> tasks;
+
+			/// Set when the worker should exit once `tasks` is drained.
+			bool stopping = false;
+
+			/// @brief Runs queued tasks until stopped.
+			void serve()
+			{
+				for (;;) {
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> guard(lock);
+						ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+
+						if (tasks.empty()) {
+							return;
+						}
+
+						task = std::move(tasks.front());
+						tasks.pop_front();
+					}
+
+					task();
+				}
+			}
+		};
+
+		/// A shard's hit with the book it refers to.
+		struct Ranked
+		{
+			Hit hit;
+			Book book;
+		};
+
+		/// The shards.
+		std::vector<std::unique_ptr<Shard>> shards;
+
+		/// @brief Queues work on a shard's thread.
+		/// @param index The shard.
+		/// @param work Called with the shard's library.
+		/// @returns The result of `work`, once it ran.
+		template <typename Work>
+		auto submit(size_t index, Work work) -> std::future<decltype(work(std::declval<Library&>()))>
+		{
+			using Result = decltype(work(std::declval<Library&>()));
+
+			Shard& shard = *shards[index];
+			auto task = std::make_shared<std::packaged_task<Result()>>([&shard, work]() { return work(shard.lib); });
+			std::future<Result> result = task->get_future();
+
+			{
+				std::lock_guard<std::mutex> guard(shard.lock);
+				shard.tasks.emplace_back([task]() { (*task)(); });
+			}
+			shard.ready.notify_one();
+
+			return result;
+		}
+
+		/// @brief Runs work on every shard in parallel.
+		/// @param work Called with each shard's library.
+		/// @returns The results, by shard.
+		template <typename Work>
+		auto scatter(Work work) -> std::vector<decltype(work(std::declval<Library&>()))>
+		{
+			std::vector<std::future<decltype(work(std::declval<Library&>()))>> pending;
+			pending.reserve(shards.size());
+			for (size_t index = 0; index < shards.size(); index++) {
+				pending.push_back(submit(index, work));
+			}
+
+			std::vector<decltype(work(std::declval<Library&>()))> res;
+			res.reserve(pending.size());
+			for (auto& result : pending) {
+				res.push_back(result.get());
+			}
+
+			return res;
+		}
+
+		/// @brief Splits books into one list per shard.
+		std::vector<std::vector<Book>> partition(const std::vector<Book>& books) const
+		{
+			std::vector<std::vector<Book>> parts(shards.size());
+			for (const Book& book : books) {
+				parts[shard_of(book.isbn)].push_back(book);
+			}
+
+			return parts;
+		}
+
+		/// @brief Gets the shard that owns a packed ISBN-13.
+		size_t shard_of(std::uint64_t packed) const
+		{
+			std::uint64_t h = packed * 0x9E3779B97F4A7C15ULL;
+			return static_cast<size_t>((h >> 32) % shards.size());
+		}
+
+	public:
+
+		/// @brief ShardedLibrary constructor.
+		/// @param count The number of shards; 0 uses one per hardware thread.
+		explicit ShardedLibrary(size_t count = 0)
+		{
+			if (count == 0) {
+				count = std::max(1U, std::thread::hardware_concurrency());
+			}
+
+			shards.reserve(count);
+			for (size_t index = 0; index < count; index++) {
+				shards.push_back(std::make_unique<Shard>());
+
+				Shard& shard = *shards.back();
+				shard.lib.defer_saves();
+				shard.worker = std::thread([&shard] { shard.serve(); });
+			}
+		}
+
+		ShardedLibrary(const ShardedLibrary&) = delete;
+		ShardedLibrary& operator=(const ShardedLibrary&) = delete;
+
+		/// Finishes queued work and stops the shard threads.
+		~ShardedLibrary()
+		{
+			for (std::unique_ptr<Shard>& shard : shards) {
+				{
+					std::lock_guard<std::mutex> guard(shard->lock);
+					shard->stopping = true;
+				}
+				shard->ready.notify_one();
+			}
+
+			for (std::unique_ptr<Shard>& shard : shards) {
+				shard->worker.join();
+			}
+		}
+
+		/// @brief Gets the shard that owns an ISBN.
+		/// The packed ISBN is mixed first, as neighbouring codes share
+		/// most of their digits.
+		/// @param isbn The ISBN.
+		/// @returns The shard's index.
+		size_t shard_of(const ISBN& isbn) const
+		{
+			return shard_of(isbn.packed());
+		}
+
+		/// @brief Gets the number of shards.
+		size_t shard_count() const
+		{
+			return shards.size();
+		}
+
+		/// @brief Adds a book to its shard.
+		/// @param book The book to add.
+		void add(const Book& book)
+		{
+			submit(shard_of(book.isbn), [book](Library& lib) { lib.add(book); }).get();
+		}
+
+		/// @brief Adds many books, each shard importing its part in parallel.
+		/// ISBNs already in the catalog are skipped.
+		/// @param incoming The books to add.
+		/// @returns The number of books added.
+		size_t import(const std::vector<Book>& incoming)
+		{
+			std::vector<std::vector<Book>> parts = partition(incoming);
+
+			std::vector<std::future<size_t>> pending;
+			for (size_t index = 0; index < shards.size(); index++) {
+				pending.push_back(submit(index, [part = std::move(parts[index])](Library& lib) { return lib.import(part); }));
+			}
+
+			size_t added = 0;
+			for (std::future<size_t>& result : pending) {
+				added += result.get();
+			}
+
+			return added;
+		}
+
+		/// @brief Removes a book by ISBN.
+		/// @param book The book to remove.
+		/// @returns True if removed, false if not found.
+		bool remove(const Book& book)
+		{
+			return submit(shard_of(book.isbn), [book](Library& lib) { return lib.remove(book); }).get();
+		}
+
+		/// @brief Checks whether a book with an ISBN is in the catalog.
+		/// @param isbn The ISBN.
+		bool contains(const ISBN& isbn)
+		{
+			return submit(shard_of(isbn), [isbn](Library& lib) { return lib.contains(isbn); }).get();
+		}
+
+		/// @brief Looks a book up by ISBN in its shard only.
+		/// @param isbn The ISBN.
+		/// @returns The book, or nothing if no copy is on the shelf.
+		std::optional<Book> find(const ISBN& isbn)
+		{
+			return submit(shard_of(isbn), [isbn](Library& lib) -> std::optional<Book> {
+				std::vector<Book> res = lib.search(isbn.code, SEARCH::CODE, 1);
+				if (res.empty()) {
+					return std::nullopt;
+				}
+				return res.front();
+			}).get();
+		}
+
+		/// @brief Records a borrow of a book with its shard.
+		/// @param book The borrowed book.
+		void record_borrow(const Book& book)
+		{
+			submit(shard_of(book.isbn), [book](Library& lib) { lib.record_borrow(book); }).get();
+		}
+
+		/// @brief Searches every shard and merges their results.
+		/// Each shard ranks its own best `limit` hits; since each list is
+		/// already sorted, the merge only ever compares the shards' heads
+		/// and stops after `limit` books.
+		/// ISBN searches go to the owning shard only.
+		/// @param term The search keyword.
+		/// @param type The type of search (TITLE, AUTHOR, ISBN).
+		/// @param limit The number of results to keep, 0 keeps every result.
+		/// @returns The books that match, best first.
+		std::vector<Book> search(const std::string& term, SEARCH type, size_t limit = Library::SEARCH_LIMIT)
+		{
+			if (type == SEARCH::CODE) {
+				try {
+					std::optional<Book> book = find(ISBN(term));
+					return book ? std::vector<Book>{ *book } : std::vector<Book>{};
+				}
+				catch (const std::exception&) {
+					return {};
+				}
+			}
+
+			std::vector<std::vector<Ranked>> lists = scatter([term, type, limit](Library& lib) {
+				std::vector<Ranked> ranked;
+				for (const Hit& hit : lib.rank(term, type, limit)) {
+					ranked.push_back(Ranked{ hit, lib.books[hit.index] });
+				}
+				return ranked;
+			});
+
+			std::vector<size_t> heads(lists.size(), 0);
+			std::vector<Book> res;
+
+			for (;;) {
+				if (limit != 0 && res.size() == limit) {
+					break;
+				}
+
+				// Hit indexes are per shard, so ties on rank go to the lower shard
+				size_t best = lists.size();
+				for (size_t index = 0; index < lists.size(); index++) {
+					if (heads[index] == lists[index].size()) {
+						continue;
+					}
+
+					const Hit& hit = lists[index][heads[index]].hit;
+					if (best == lists.size() ||
+						hit.relevance > lists[best][heads[best]].hit.relevance ||
+						(hit.relevance == lists[best][heads[best]].hit.relevance && hit.popularity > lists[best][heads[best]].hit.popularity)) {
+						best = index;
+					}
+				}
+
+				if (best == lists.size()) {
+					break;
+				}
+
+				res.push_back(std::move(lists[best][heads[best]++].book));
+			}
+
+			return res;
+		}
+
+		/// @brief Gets the number of books across all shards.
+		size_t size()
+		{
+			size_t total = 0;
+			for (size_t count : scatter([](Library& lib) { return lib.size(); })) {
+				total += count;
+			}
+
+			return total;
+		}
+
+		/// @brief Gets the number of books in each shard.
+		std::vector<size_t> sizes()
+		{
+			return scatter([](Library& lib) { return lib.size(); });
+		}
+
+		/// @brief Replaces the catalog with books from JSON.
+		/// The books are partitioned here; each shard then parses,
+		/// validates & indexes its own part in parallel.
+		/// @param json A JSON array of books, as written by `save_as_json`.
+		/// @returns True if every shard loaded its part.
+		/// @throws std::runtime_error if any ISBN is invalid.
+		bool load(const std::string& json)
+		{
+			nlohmann::json j = nlohmann::json::parse(json);
+
+			// Route by the canonical ISBN-13, which ISBN-10 codes are converted to
+			std::vector<std::string> codes;
+			codes.reserve(j.size());
+			for (const nlohmann::json& book : j) {
+				codes.push_back(book.at("isbn").get<std::string>());
+			}
+
+			IsbnBatch::Report report = IsbnBatch::validate(codes);
+			if (!report.failed.empty()) {
+				throw std::runtime_error("Invalid ISBN code");
+			}
+
+			std::vector<nlohmann::json> parts(shards.size(), nlohmann::json::array());
+			for (size_t i = 0; i < j.size(); i++) {
+				parts[shard_of(report.packed[i])].push_back(std::move(j[i]));
+			}
+
+			std::vector<std::future<bool>> pending;
+			for (size_t index = 0; index < shards.size(); index++) {
+				pending.push_back(submit(index, [text = parts[index].dump()](Library& lib) { return lib.load(text); }));
+			}
+
+			bool loaded = true;
+			for (std::future<bool>& result : pending) {
+				loaded = result.get() && loaded;
+			}
+
+			return loaded;
+		}
+
+		/// @brief Writes every shard's books as one JSON array.
+		std::string save_as_json()
+		{
+			nlohmann::json j = nlohmann::json::array();
+			for (std::vector<Book>& books : scatter([](Library& lib) { return lib.books; })) {
+				for (const Book& book : books) {
+					j.push_back(book);
+				}
+			}
+
+			return j.dump();
+		}
+	};
+}
+
+#endif // !SHARDED_H
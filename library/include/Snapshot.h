@@ -0,0 +1,369 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define LIBRARY_SNAPSHOT_FSYNC 1
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define LIBRARY_SNAPSHOT_SSE42 1
+	#include <immintrin.h>
+#endif
+
+namespace LibraryTypes
+{
+	/// CRC-32C (Castagnoli), used to checksum snapshot blocks.
+	namespace Crc32c
+	{
+		/// @brief Builds the byte-at-a-time lookup table.
+		inline std::array<std::uint32_t, 256U> make_table()
+		{
+			std::array<std::uint32_t, 256U> table{};
+			for (std::uint32_t i = 0; i < 256U; i++) {
+				std::uint32_t crc = i;
+				for (int bit = 0; bit < 8; bit++) {
+					crc = (crc & 1U) != 0 ? (crc >> 1) ^ 0x82F63B78U : crc >> 1;
+				}
+				table[i] = crc;
+			}
+
+			return table;
+		}
+
+		/// @brief Table driven CRC-32C.
+		inline std::uint32_t update_scalar(std::uint32_t crc, const std::uint8_t* data, size_t length)
+		{
+			static const std::array<std::uint32_t, 256U> table = make_table();
+
+			for (size_t i = 0; i < length; i++) {
+				crc = table[(crc ^ data[i]) & 0xFFU] ^ (crc >> 8);
+			}
+
+			return crc;
+		}
+
+#if LIBRARY_SNAPSHOT_SSE42
+		/// @brief CRC-32C with the SSE4.2 `crc32` instruction, 8 bytes at a time.
+		__attribute__((target("sse4.2")))
+		inline std::uint32_t update_sse42(std::uint32_t crc, const std::uint8_t* data, size_t length)
+		{
+			size_t i = 0;
+#if defined(__x86_64__)
+			std::uint64_t wide = crc;
+			for (; i + 8 <= length; i += 8) {
+				std::uint64_t word;
+				std::memcpy(&word, data + i, sizeof(word));
+				wide = _mm_crc32_u64(wide, word);
+			}
+			crc = static_cast<std::uint32_t>(wide);
+#endif
+			for (; i < length; i++) {
+				crc = _mm_crc32_u8(crc, data[i]);
+			}
+
+			return crc;
+		}
+#endif
+
+		/// Signature shared by the CRC kernels.
+		using update_fn = std::uint32_t (*)(std::uint32_t, const std::uint8_t*, size_t);
+
+		/// @brief Picks the fastest kernel the CPU supports.
+		inline update_fn select()
+		{
+#if LIBRARY_SNAPSHOT_SSE42
+			if (__builtin_cpu_supports("sse4.2")) {
+				return update_sse42;
+			}
+#endif
+			return update_scalar;
+		}
+
+		/// @brief Computes the CRC-32C of a byte range.
+		/// @param data The bytes.
+		/// @param length The number of bytes.
+		/// @returns The checksum.
+		inline std::uint32_t compute(const void* data, size_t length)
+		{
+			static const update_fn kernel = select();
+			return ~kernel(~0U, static_cast<const std::uint8_t*>(data), length);
+		}
+	}
+
+	/// Crash-consistent snapshot files.
+	/// A snapshot is written beside its target, flushed to disk and renamed
+	/// over it, so a crash leaves either the old file or the new one whole.
+	/// The payload is split into blocks with a CRC-32C each; reading checks
+	/// the blocks on several threads and rejects a damaged file.
+	/// Files without the snapshot header (plain JSON from older versions)
+	/// are read as they are.
+	class Snapshot
+	{
+	private:
+
+		/// Identifies a snapshot file.
+		static constexpr char MAGIC[8] = { 'L', 'I', 'B', 'S', 'N', 'A', 'P', '1' };
+
+		/// Snapshot layout version.
+		static constexpr std::uint32_t VERSION = 1;
+
+		/// The file header, followed by one CRC per block, then the payload.
+		struct Header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t block;
+			std::uint64_t length;
+			std::uint32_t blocks;
+
+			/// CRC of the fields above.
+			std::uint32_t crc;
+		};
+
+		/// @brief Gets the CRC covering a header's fields.
+		static std::uint32_t header_crc(const Header& head)
+		{
+			return Crc32c::compute(&head, offsetof(Header, crc));
+		}
+
+		/// @brief Writes a whole file and flushes it to disk.
+		/// @returns False on any error.
+		static bool write_file(const std::filesystem::path& path, const std::string& bytes)
+		{
+#if LIBRARY_SNAPSHOT_FSYNC
+			int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0) {
+				return false;
+			}
+
+			size_t done = 0;
+			while (done < bytes.size()) {
+				ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+				if (n <= 0) {
+					::close(fd);
+					return false;
+				}
+				done += static_cast<size_t>(n);
+			}
+
+			bool synced = ::fsync(fd) == 0;
+			return ::close(fd) == 0 && synced;
+#else
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+			out.flush();
+			return out.good();
+#endif
+		}
+
+		/// @brief Flushes a directory entry, making a rename durable.
+		static void sync_directory(const std::filesystem::path& dir)
+		{
+#if LIBRARY_SNAPSHOT_FSYNC
+			int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+			if (fd >= 0) {
+				::fsync(fd);
+				::close(fd);
+			}
+#else
+			(void)dir;
+#endif
+		}
+
+	public:
+
+		/// Payload bytes per checksummed block.
+		static constexpr std::uint32_t BLOCK = 64U * 1024U;
+
+		/// @brief Atomically replaces a file with a snapshot of a payload.
+		/// @param path The target file.
+		/// @param payload The contents.
+		/// @returns False if the snapshot could not be written; the target is untouched.
+		static bool write(const std::filesystem::path& path, const std::string& payload)
+		{
+			Header head{};
+			std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+			head.version = VERSION;
+			head.block = BLOCK;
+			head.length = payload.size();
+			head.blocks = static_cast<std::uint32_t>((payload.size() + BLOCK - 1) / BLOCK);
+			head.crc = header_crc(head);
+
+			std::vector<std::uint32_t> crcs(head.blocks);
+			for (size_t i = 0; i < crcs.size(); i++) {
+				size_t start = i * BLOCK;
+				crcs[i] = Crc32c::compute(payload.data() + start, std::min<size_t>(BLOCK, payload.size() - start));
+			}
+
+			std::string bytes;
+			bytes.reserve(sizeof(Header) + crcs.size() * sizeof(std::uint32_t) + payload.size());
+			bytes.append(reinterpret_cast<const char*>(&head), sizeof(Header));
+			bytes.append(reinterpret_cast<const char*>(crcs.data()), crcs.size() * sizeof(std::uint32_t));
+			bytes += payload;
+
+			std::filesystem::path temp = path;
+			temp += ".tmp";
+
+			if (!write_file(temp, bytes)) {
+				std::error_code ignored;
+				std::filesystem::remove(temp, ignored);
+				return false;
+			}
+
+			std::error_code error;
+			std::filesystem::rename(temp, path, error);
+			if (error) {
+				return false;
+			}
+
+			sync_directory(path.parent_path());
+			return true;
+		}
+
+		/// @brief Writes a snapshot, reporting a failure on stderr.
+		/// Saves run from menus with no caller to hand an error to, so a
+		/// failed write is at least visible.
+		/// @param path The target file.
+		/// @param payload The contents.
+		/// @returns False if the snapshot could not be written.
+		static bool write_checked(const std::filesystem::path& path, const std::string& payload)
+		{
+			if (write(path, payload)) {
+				return true;
+			}
+
+			std::cerr << "Could not save " << path.string() << std::endl;
+			return false;
+		}
+
+		/// @brief Reads a snapshot, checking every block.
+		/// @param path The file.
+		/// @returns The payload, or nothing if the file is missing or damaged.
+		static std::optional<std::string> read(const std::filesystem::path& path)
+		{
+			std::ifstream in(path, std::ios::binary);
+			if (!in.is_open()) {
+				return std::nullopt;
+			}
+
+			std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+			if (bytes.size() < sizeof(MAGIC) || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0) {
+				return bytes;
+			}
+
+			Header head;
+			if (bytes.size() < sizeof(Header)) {
+				return std::nullopt;
+			}
+			std::memcpy(&head, bytes.data(), sizeof(Header));
+
+			if (head.crc != header_crc(head) || head.version != VERSION || head.block == 0) {
+				return std::nullopt;
+			}
+
+			size_t table = sizeof(Header);
+			size_t data = table + static_cast<size_t>(head.blocks) * sizeof(std::uint32_t);
+			if ((head.length + head.block - 1) / head.block != head.blocks || bytes.size() != data + head.length) {
+				return std::nullopt;
+			}
+
+			if (!verify(bytes.data() + table, bytes.data() + data, head.length, head.block, head.blocks)) {
+				return std::nullopt;
+			}
+
+			return bytes.substr(data);
+		}
+
+		/// @brief Reads a snapshot, setting a damaged file aside.
+		/// A file that fails its checks is renamed to `<file>.corrupt`, so a
+		/// later save cannot write over it, and the failure is reported.
+		/// @param path The file.
+		/// @returns The payload, or nothing if the file is missing.
+		/// @throws std::runtime_error if the file is damaged.
+		static std::optional<std::string> read_checked(const std::filesystem::path& path)
+		{
+			std::optional<std::string> payload = read(path);
+			if (payload || !std::filesystem::exists(path)) {
+				return payload;
+			}
+
+			std::filesystem::path aside = path;
+			aside += ".corrupt";
+
+			std::error_code error;
+			std::filesystem::rename(path, aside, error);
+
+			std::string message = "Damaged snapshot " + path.string();
+			message += error ? " could not be moved aside" : " moved to " + aside.string();
+			std::cerr << message << std::endl;
+			throw std::runtime_error(message);
+		}
+
+		/// @brief Checks payload blocks against their CRCs.
+		/// Large payloads are split across threads.
+		/// @param table The stored CRCs.
+		/// @param data The payload.
+		/// @param length The payload length.
+		/// @param block The block size.
+		/// @param blocks The number of blocks.
+		/// @returns True if every block matches.
+		static bool verify(const char* table, const char* data, size_t length, size_t block, size_t blocks)
+		{
+			std::atomic<bool> ok{ true };
+
+			auto check = [&](size_t first, size_t last) {
+				for (size_t i = first; i < last && ok.load(std::memory_order_relaxed); i++) {
+					std::uint32_t stored;
+					std::memcpy(&stored, table + i * sizeof(std::uint32_t), sizeof(stored));
+
+					size_t start = i * block;
+					if (Crc32c::compute(data + start, std::min(block, length - start)) != stored) {
+						ok.store(false, std::memory_order_relaxed);
+					}
+				}
+			};
+
+			// A thread per few blocks at most; small files are checked inline
+			size_t threads = std::min<size_t>(std::max(1U, std::thread::hardware_concurrency()), blocks / 4);
+			if (threads <= 1) {
+				check(0, blocks);
+				return ok.load();
+			}
+
+			std::vector<std::thread> workers;
+			size_t per = (blocks + threads - 1) / threads;
+			for (size_t first = per; first < blocks; first += per) {
+				workers.emplace_back(check, first, std::min(blocks, first + per));
+			}
+			check(0, std::min(blocks, per));
+
+			for (std::thread& worker : workers) {
+				worker.join();
+			}
+
+			return ok.load();
+		}
+	};
+}
+
+#endif // !SNAPSHOT_H
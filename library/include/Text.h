@@ -0,0 +1,440 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LIBRARY_TEXT_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+#if defined(LIBRARY_TEXT_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define LIBRARY_TEXT_AVX2 1
+	#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+/// Text helpers shared by the search paths.
+/// The case-insensitive kernels fold ASCII letters on the fly, so
+/// neither the term nor the key has to be copied to lowercase first.
+/// `normalize` goes further for UTF-8: it folds case & strips accents,
+/// so it is applied once to index keys rather than on every compare.
+namespace Text
+{
+	/// @brief Folds an ASCII letter to lowercase.
+	/// @param c The byte to fold.
+	/// @returns The folded byte.
+	inline unsigned char fold(unsigned char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c | 0x20) : c;
+	}
+
+	/// @brief Compares two byte ranges ignoring ASCII case.
+	/// @param a The first range.
+	/// @param b The second range.
+	/// @param n The number of bytes to compare.
+	/// @returns True if equal.
+	inline bool iequal(const char* a, const char* b, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			if (fold(static_cast<unsigned char>(a[i])) != fold(static_cast<unsigned char>(b[i]))) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// @brief Gets the index of the lowest set bit.
+	inline unsigned lowest_bit(std::uint32_t mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<unsigned>(index);
+#else
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+	}
+
+	/// @brief Scalar case-insensitive substring search.
+	/// @param hay The text to search.
+	/// @param needle The term to find.
+	/// @param from The first position to consider.
+	/// @returns The match position or `std::string_view::npos`.
+	inline size_t ifind_scalar(std::string_view hay, std::string_view needle, size_t from = 0)
+	{
+		if (needle.size() > hay.size()) {
+			return std::string_view::npos;
+		}
+
+		if (needle.empty()) {
+			return 0;
+		}
+
+		unsigned char first = fold(static_cast<unsigned char>(needle[0]));
+		size_t last = hay.size() - needle.size();
+
+		for (size_t i = from; i <= last; i++) {
+			if (fold(static_cast<unsigned char>(hay[i])) == first
+				&& iequal(hay.data() + i + 1, needle.data() + 1, needle.size() - 1)) {
+				return i;
+			}
+		}
+
+		return std::string_view::npos;
+	}
+
+#if LIBRARY_TEXT_SSE2
+	/// @brief Folds 16 ASCII letters to lowercase.
+	inline __m128i fold16(__m128i v)
+	{
+		// 'A'..'Z' map onto -128..-103 so a single signed compare finds them.
+		__m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(0x3F));
+		__m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+		return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+	}
+
+	/// @brief Checks 16 candidate positions with SSE2.
+	/// @param h The first candidate position.
+	/// @param needle The term to find.
+	/// @param first The folded first needle byte, broadcast.
+	/// @param last The folded last needle byte, broadcast.
+	/// @param skip The number of leading positions already checked.
+	/// @returns The offset of the first match or 16.
+	inline unsigned block16(const char* h, std::string_view needle, __m128i first, __m128i last, unsigned skip)
+	{
+		size_t n = needle.size();
+		__m128i a = fold16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h)));
+		__m128i b = fold16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h + n - 1)));
+
+		std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+		mask &= ~((std::uint32_t(1) << skip) - 1);
+
+		while (mask != 0) {
+			unsigned bit = lowest_bit(mask);
+			if (n <= 2 || iequal(h + bit + 1, needle.data() + 1, n - 2)) {
+				return bit;
+			}
+			mask &= mask - 1;
+		}
+
+		return 16;
+	}
+
+	/// @brief SSE2 case-insensitive substring search.
+	/// Compares the first & last needle bytes against 16 positions
+	/// at once and only verifies the candidates. The tail is covered
+	/// by one overlapping block instead of a scalar loop.
+	/// @param hay The text to search.
+	/// @param needle The term to find.
+	/// @param from The first position to consider.
+	/// @returns The match position or `std::string_view::npos`.
+	inline size_t ifind_sse2(std::string_view hay, std::string_view needle, size_t from = 0)
+	{
+		size_t n = needle.size();
+
+		if (n == 0 || n > hay.size() || hay.size() - n + 1 < 16) {
+			return ifind_scalar(hay, needle, from);
+		}
+
+		const char* h = hay.data();
+		const size_t positions = hay.size() - n + 1;
+		const __m128i first = _mm_set1_epi8(static_cast<char>(fold(static_cast<unsigned char>(needle[0]))));
+		const __m128i last = _mm_set1_epi8(static_cast<char>(fold(static_cast<unsigned char>(needle[n - 1]))));
+
+		size_t i = from;
+		for (; i + 16 <= positions; i += 16) {
+			unsigned bit = block16(h + i, needle, first, last, 0);
+			if (bit != 16) {
+				return i + bit;
+			}
+		}
+
+		if (i < positions) {
+			size_t start = positions - 16;
+			unsigned bit = block16(h + start, needle, first, last, static_cast<unsigned>(i - start));
+			if (bit != 16) {
+				return start + bit;
+			}
+		}
+
+		return std::string_view::npos;
+	}
+#endif
+
+#if LIBRARY_TEXT_AVX2
+	/// @brief AVX2 case-insensitive substring search.
+	/// Same approach as `ifind_sse2` over 32 positions at once,
+	/// handing the tail to the SSE2 kernel.
+	__attribute__((target("avx2")))
+	inline size_t ifind_avx2(std::string_view hay, std::string_view needle)
+	{
+		size_t n = needle.size();
+
+		if (n == 0 || n > hay.size()) {
+			return ifind_scalar(hay, needle);
+		}
+
+		const char* h = hay.data();
+		const __m256i bias = _mm256_set1_epi8(0x3F);
+		const __m256i limit = _mm256_set1_epi8(-128 + 26);
+		const __m256i lower = _mm256_set1_epi8(0x20);
+		const __m256i first = _mm256_set1_epi8(static_cast<char>(fold(static_cast<unsigned char>(needle[0]))));
+		const __m256i last = _mm256_set1_epi8(static_cast<char>(fold(static_cast<unsigned char>(needle[n - 1]))));
+
+		size_t i = 0;
+		for (; i + n - 1 + 32 <= hay.size(); i += 32) {
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i + n - 1));
+
+			a = _mm256_or_si256(a, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(a, bias)), lower));
+			b = _mm256_or_si256(b, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(b, bias)), lower));
+
+			std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+				_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+
+			while (mask != 0) {
+				size_t pos = i + lowest_bit(mask);
+				if (n <= 2 || iequal(h + pos + 1, needle.data() + 1, n - 2)) {
+					return pos;
+				}
+				mask &= mask - 1;
+			}
+		}
+
+		return ifind_sse2(hay, needle, i);
+	}
+#endif
+
+	/// Signature shared by the substring kernels.
+	using find_fn = size_t (*)(std::string_view, std::string_view);
+
+	/// @brief Picks the widest kernel the CPU supports.
+	/// @returns The selected kernel.
+	inline find_fn select_ifind()
+	{
+#if LIBRARY_TEXT_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			return ifind_avx2;
+		}
+#endif
+#if LIBRARY_TEXT_SSE2
+		return [](std::string_view hay, std::string_view needle) { return ifind_sse2(hay, needle); };
+#else
+		return [](std::string_view hay, std::string_view needle) { return ifind_scalar(hay, needle); };
+#endif
+	}
+
+	/// @brief Case-insensitive (ASCII) substring search.
+	/// The kernel is selected once at runtime.
+	/// @param hay The text to search.
+	/// @param needle The term to find.
+	/// @returns The match position or `std::string_view::npos`.
+	inline size_t ifind(std::string_view hay, std::string_view needle)
+	{
+		static const find_fn kernel = select_ifind();
+		return kernel(hay, needle);
+	}
+
+	/// @brief Case-insensitive (ASCII) containment test.
+	inline bool icontains(std::string_view hay, std::string_view needle)
+	{
+		return ifind(hay, needle) != std::string_view::npos;
+	}
+
+	/// Base letters of U+00C0..U+017F, case folded & accents stripped.
+	/// '0' keeps the character as is; '1'..'5' index `LIGATURES`.
+	inline constexpr char LATIN[] =
+		"aaaaaa1ceeeeiiiidnooooo0ouuuuy23aaaaaa1ceeeeiiiidnooooo0ouuuuy2y"
+		"aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii44jjkkkllllllllll"
+		"nnnnnnnnnoooooo55rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+	static_assert(sizeof(LATIN) - 1 == 0x180 - 0xC0, "LATIN needs one entry per code point");
+
+	/// Letters written as two in search keys, e.g. "Æ" as "ae".
+	inline constexpr char LIGATURES[][3] = { "ae", "th", "ss", "ij", "oe" };
+
+	/// @brief Normalizes one 2-byte UTF-8 character.
+	/// Latin letters lose their accents, Greek & Cyrillic capitals are
+	/// folded to lowercase and combining accents are dropped.
+	/// The result is never longer than the 2 bytes read.
+	/// @param cp The code point, U+0080..U+07FF.
+	/// @param out Receives up to 2 bytes.
+	/// @returns The number of bytes written.
+	inline size_t fold2(unsigned cp, char* out)
+	{
+		if (cp >= 0xC0 && cp <= 0x17F) {
+			char base = LATIN[cp - 0xC0];
+			if (base >= 'a') {
+				out[0] = base;
+				return 1;
+			}
+			if (base != '0') {
+				out[0] = LIGATURES[base - '1'][0];
+				out[1] = LIGATURES[base - '1'][1];
+				return 2;
+			}
+		}
+		else if (cp >= 0x300 && cp <= 0x36F) {
+			return 0;
+		}
+		else if ((cp >= 0x391 && cp <= 0x3A9) || (cp >= 0x410 && cp <= 0x42F)) {
+			cp += 0x20;
+		}
+		else if (cp >= 0x400 && cp <= 0x40F) {
+			cp += 0x50;
+		}
+		else if (cp == 0x3C2) {
+			// Final sigma matches the medial form
+			cp = 0x3C3;
+		}
+
+		out[0] = static_cast<char>(0xC0 | (cp >> 6));
+		out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+		return 2;
+	}
+
+	/// @brief Scalar ASCII run folding; leaves everything to the caller.
+	/// @returns 0, the number of bytes folded.
+	inline size_t fold_ascii_scalar(const char*, size_t, char*)
+	{
+		return 0;
+	}
+
+#if LIBRARY_TEXT_SSE2
+	/// @brief Folds the leading pure-ASCII blocks of a text with SSE2.
+	/// Stops at the first 16-byte block holding a non-ASCII byte.
+	/// @param in The text.
+	/// @param n The number of bytes.
+	/// @param out Receives the folded bytes.
+	/// @returns The number of bytes folded, a multiple of 16.
+	inline size_t fold_ascii_sse2(const char* in, size_t n, char* out)
+	{
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			if (_mm_movemask_epi8(v) != 0) {
+				break;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), fold16(v));
+		}
+
+		return i;
+	}
+#endif
+
+#if LIBRARY_TEXT_AVX2
+	/// @brief Folds the leading pure-ASCII blocks of a text with AVX2.
+	/// Same as `fold_ascii_sse2` over 32 bytes at a time.
+	__attribute__((target("avx2")))
+	inline size_t fold_ascii_avx2(const char* in, size_t n, char* out)
+	{
+		const __m256i bias = _mm256_set1_epi8(0x3F);
+		const __m256i limit = _mm256_set1_epi8(-128 + 26);
+		const __m256i lower = _mm256_set1_epi8(0x20);
+
+		size_t i = 0;
+		for (; i + 32 <= n; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+			if (_mm256_movemask_epi8(v) != 0) {
+				break;
+			}
+			v = _mm256_or_si256(v, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, bias)), lower));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+		}
+
+		return i + fold_ascii_sse2(in + i, n - i, out + i);
+	}
+#endif
+
+	/// Signature shared by the ASCII folding kernels.
+	using fold_fn = size_t (*)(const char*, size_t, char*);
+
+	/// @brief Picks the widest ASCII folding kernel the CPU supports.
+	/// @returns The selected kernel.
+	inline fold_fn select_fold_ascii()
+	{
+#if LIBRARY_TEXT_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			return fold_ascii_avx2;
+		}
+#endif
+#if LIBRARY_TEXT_SSE2
+		return fold_ascii_sse2;
+#else
+		return fold_ascii_scalar;
+#endif
+	}
+
+	/// @brief Normalizes UTF-8 text into a search key.
+	/// ASCII letters are lowercased, accented Latin letters reduced to
+	/// their base letters ("Émile" to "emile", "ß" to "ss"), Greek &
+	/// Cyrillic capitals lowercased and combining accents dropped.
+	/// Other characters, and malformed bytes, are copied as they are.
+	/// Pure-ASCII runs are folded by a vector kernel.
+	/// @param text The text.
+	/// @param out Receives the key; its capacity is reused, so a
+	/// buffer kept across calls makes normalizing allocation free.
+	/// @returns A view of `out`.
+	inline std::string_view normalize(std::string_view text, std::string& out)
+	{
+		static const fold_fn ascii = select_fold_ascii();
+
+		// No character grows, so the key fits in the text's length
+		out.resize(text.size());
+
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(text.data());
+		char* dst = out.data();
+		const size_t n = text.size();
+		size_t i = 0;
+		size_t o = 0;
+
+		while (i < n) {
+			size_t run = ascii(text.data() + i, n - i, dst + o);
+			i += run;
+			o += run;
+
+			// The block that stopped the kernel goes one character at a time
+			const size_t stop = std::min(n, i + 16);
+			while (i < stop) {
+				unsigned char c = in[i];
+				if (c < 0x80) {
+					dst[o++] = static_cast<char>(fold(c));
+					i++;
+				}
+				else if (c >= 0xC2 && c <= 0xDF && i + 1 < n && (in[i + 1] & 0xC0) == 0x80) {
+					o += fold2((static_cast<unsigned>(c & 0x1F) << 6) | (in[i + 1] & 0x3F), dst + o);
+					i += 2;
+				}
+				else {
+					dst[o++] = static_cast<char>(c);
+					i++;
+				}
+			}
+		}
+
+		out.resize(o);
+		return out;
+	}
+
+	/// @brief Normalizes UTF-8 text into a new search key.
+	/// @param text The text.
+	/// @returns The key.
+	inline std::string normalize(std::string_view text)
+	{
+		std::string out;
+		normalize(text, out);
+		return out;
+	}
+}
+
+#endif // !TEXT_H
@@ -0,0 +1,276 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+#include "UI.h"
+
+/// Recording & replaying console sessions, for load testing.
+/// A trace file holds one JSON object per line, one per answer typed:
+/// `{"session": id, "label": prompt, "answer": text}`. Answers are
+/// stored as typed, passwords included, so record test accounts only.
+namespace UI
+{
+	/// One answer of a recorded session.
+	struct Step
+	{
+	public:
+
+		/// What the answer responded to: a menu option or a prompt.
+		std::string label;
+
+		/// The line typed.
+		std::string answer;
+	};
+
+	/// Appends the calling thread's console answers to a trace file.
+	/// Each answer is written & flushed at once, so a session ended by
+	/// `std::exit` is still recorded whole.
+	class Recorder
+	{
+	private:
+
+		/// The trace file, opened for appending.
+		std::ofstream file;
+
+		/// Tells this session's lines apart from earlier recordings.
+		std::uint64_t id;
+
+	public:
+
+		/// @brief Recorder constructor; starts recording.
+		/// @param path The trace file.
+		explicit Recorder(const std::filesystem::path& path)
+			: file(path, std::ios::app),
+			  id(static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()))
+		{
+			SESSION.on_answer = [this](const std::string& label, const std::string& answer)
+			{
+				nlohmann::json j = { { "session", id }, { "label", label }, { "answer", answer } };
+				file << j.dump() << "\n";
+				file.flush();
+			};
+		}
+
+		Recorder(const Recorder&) = delete;
+		Recorder& operator=(const Recorder&) = delete;
+
+		/// Stops recording.
+		~Recorder()
+		{
+			SESSION.on_answer = nullptr;
+		}
+
+		/// @brief Checks whether the trace file could be opened.
+		bool is_open() const
+		{
+			return file.is_open();
+		}
+	};
+
+	/// @brief Reads the sessions of a trace file.
+	/// Malformed lines, e.g. one torn by a crash, are skipped.
+	/// @param path The trace file.
+	/// @returns The sessions in the order they were first recorded.
+	inline std::vector<std::vector<Step>> load_trace(const std::filesystem::path& path)
+	{
+		std::vector<std::vector<Step>> sessions;
+		std::unordered_map<std::uint64_t, size_t> index;
+
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			nlohmann::json j = nlohmann::json::parse(line, nullptr, false);
+			if (j.is_discarded() || !j.is_object() || !j.contains("session") || !j.contains("label") || !j.contains("answer"))
+			{
+				continue;
+			}
+
+			std::uint64_t id = j.at("session").get<std::uint64_t>();
+			auto pair = index.find(id);
+			if (pair == index.end())
+			{
+				pair = index.emplace(id, sessions.size()).first;
+				sessions.emplace_back();
+			}
+
+			sessions[pair->second].push_back(Step{ j.at("label").get<std::string>(), j.at("answer").get<std::string>() });
+		}
+
+		return sessions;
+	}
+
+	/// Latency samples per operation, in microseconds.
+	class LatencyStats
+	{
+	public:
+
+		/// The latency distribution of one operation.
+		struct Summary
+		{
+		public:
+			std::string label;
+			size_t count;
+			double p50;
+			double p90;
+			double p99;
+			double max;
+		};
+
+	private:
+
+		/// Samples - Key: operation label.
+		std::map<std::string, std::vector<double>> samples;
+
+		/// @brief Gets a percentile of sorted samples, nearest rank.
+		static double percentile(const std::vector<double>& sorted, double p)
+		{
+			size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+			return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+		}
+
+	public:
+
+		/// @brief Adds a sample.
+		/// @param label The operation.
+		/// @param us Its latency in microseconds.
+		void add(const std::string& label, double us)
+		{
+			samples[label].push_back(us);
+		}
+
+		/// @brief Adds every sample of another set, e.g. another thread's.
+		void merge(const LatencyStats& other)
+		{
+			for (const auto& [label, values] : other.samples)
+			{
+				std::vector<double>& mine = samples[label];
+				mine.insert(mine.end(), values.begin(), values.end());
+			}
+		}
+
+		/// @brief Gets the number of samples.
+		size_t total() const
+		{
+			size_t count = 0;
+			for (const auto& [label, values] : samples)
+			{
+				count += values.size();
+			}
+
+			return count;
+		}
+
+		/// @brief Summarizes each operation.
+		/// @returns One summary per operation, by label.
+		std::vector<Summary> summary() const
+		{
+			std::vector<Summary> res;
+			for (auto [label, values] : samples)
+			{
+				std::sort(values.begin(), values.end());
+				res.push_back(Summary{ label, values.size(), percentile(values, 50), percentile(values, 90), percentile(values, 99), values.back() });
+			}
+
+			return res;
+		}
+	};
+
+	/// How a replayed session went.
+	struct Outcome
+	{
+	public:
+
+		/// False if the session ran out of answers before it ended.
+		bool finished = true;
+
+		/// Answers whose live prompt differed from the recorded one.
+		size_t diverged = 0;
+	};
+
+	/// @brief Replays a session headlessly on the calling thread.
+	/// The answers are fed to the console and the output discarded; the
+	/// time from each answer to the next prompt is that answer's latency.
+	/// @param steps The recorded answers.
+	/// @param run Runs the app, e.g. `LibraryApp::start`.
+	/// @param stats Receives one latency sample per answer.
+	/// @returns Whether the session finished & matched its recording.
+	inline Outcome replay(const std::vector<Step>& steps, const std::function<void()>& run, LatencyStats& stats)
+	{
+		using clock = std::chrono::steady_clock;
+
+		std::string script;
+		for (const Step& step : steps)
+		{
+			script += step.answer + '\n';
+		}
+
+		std::istringstream in(script);
+		std::ostream out(nullptr);
+
+		Outcome outcome;
+		size_t read = 0;
+		std::string pending;
+		clock::time_point since;
+
+		auto settle = [&](clock::time_point now)
+		{
+			if (read != 0)
+			{
+				stats.add(pending, std::chrono::duration<double, std::micro>(now - since).count());
+			}
+		};
+
+		Session saved = SESSION;
+		SESSION.in = &in;
+		SESSION.out = &out;
+		SESSION.strict = true;
+		SESSION.on_answer = [&](const std::string& label, const std::string&)
+		{
+			clock::time_point now = clock::now();
+			settle(now);
+
+			if (read >= steps.size() || steps[read].label != label)
+			{
+				outcome.diverged++;
+			}
+
+			pending = label;
+			read++;
+			since = clock::now();
+		};
+
+		try
+		{
+			run();
+		}
+		catch (const EndOfInput&)
+		{
+			outcome.finished = false;
+		}
+		catch (...)
+		{
+			SESSION = saved;
+			throw;
+		}
+
+		settle(clock::now());
+		SESSION = saved;
+
+		return outcome;
+	}
+}
+
+#endif // !TRACE_H
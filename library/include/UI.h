@@ -7,6 +7,7 @@
 #include <functional>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 namespace UI
 {
@@ -47,6 +48,35 @@ namespace UI
 		[[maybe_unused]] int ignored1 = std::system("clear");	
 	}
 
+	/// Thrown by a strict session once its input runs out.
+	struct EndOfInput : public std::runtime_error
+	{
+		EndOfInput() : std::runtime_error("End of input") { }
+	};
+
+	/// Where a thread's console reads & writes.
+	/// Defaults to the process console; the replay harness gives each
+	/// simulated user its own streams.
+	struct Session
+	{
+	public:
+
+		/// Answers are read from here.
+		std::istream* in = &std::cin;
+
+		/// Prompts & messages are written here.
+		std::ostream* out = &std::cout;
+
+		/// Called with every line read and the prompt it answered, e.g. to record it.
+		std::function<void(const std::string& label, const std::string& answer)> on_answer;
+
+		/// Throw `EndOfInput` once input runs out, rather than reading empty lines.
+		bool strict = false;
+	};
+
+	/// The calling thread's console session.
+	inline thread_local Session SESSION;
+
 	/// Basic question structure for console interaction.
 	struct Question
 	{
@@ -96,6 +126,58 @@ namespace UI
 			return input.length() == 1; // Accepts any single character input
 		}
 
+		/// Reads one line from the session.
+		/// @param prompt Written before reading.
+		/// @returns The line.
+		static std::string get_line(const std::string& prompt)
+		{
+			std::string input;
+			*SESSION.out << prompt;
+			if (!std::getline(*SESSION.in, input) && SESSION.strict)
+			{
+				throw EndOfInput();
+			}
+
+			return input;
+		}
+
+		/// Reports a line read to the session's listener; nothing is reported at end of input.
+		/// @param label What the line answered.
+		/// @param input The line.
+		static void answered(const std::string& label, const std::string& input)
+		{
+			if (SESSION.on_answer && *SESSION.in)
+			{
+				SESSION.on_answer(label, input);
+			}
+		}
+
+		/// Names the option a menu answer picked.
+		/// @param question The question text, listing options as "N) Text".
+		/// @param input The answer.
+		/// @returns The option's text, or the question's last line if none matches.
+		static std::string option(const std::string& question, const std::string& input)
+		{
+			std::istringstream stream(question);
+			std::string line;
+			std::string last;
+
+			while (std::getline(stream, line))
+			{
+				if (line.size() > input.size() + 2 && line.compare(0, input.size(), input) == 0 && line.compare(input.size(), 2, ") ") == 0)
+				{
+					return line.substr(input.size() + 2);
+				}
+
+				if (!line.empty())
+				{
+					last = line;
+				}
+			}
+
+			return last;
+		}
+
 		/// Validates input based on type.
 		/// @param type Expected input type.
 		/// @param question The full question string to redisplay on invalid input.
@@ -107,8 +189,8 @@ namespace UI
 
 			while (!validated)
 			{
-				std::cout << "INPUT: ";
-				std::getline(std::cin, input);
+				input = get_line("INPUT: ");
+				answered(option(question, input), input);
 
 				switch (type)
 				{
@@ -146,11 +228,12 @@ namespace UI
 			}
 
 			std::string border(max_length + 4, '-');
-			std::cout << border << "\n";
+			std::ostream& out = *SESSION.out;
+			out << border << "\n";
 			for (const auto& l : lines) {
-				std::cout << "| " << l << std::string(max_length - l.length(), ' ') << " |\n";
+				out << "| " << l << std::string(max_length - l.length(), ' ') << " |\n";
 			}
-			std::cout << border << "\n";
+			out << border << "\n";
 		}
 
 		/// Overload for printing C-style strings.
@@ -160,6 +243,19 @@ namespace UI
 			print_message(std::string(message));
 		}
 
+		/// Prompts for one line of free text.
+		/// @param prompt The prompt, e.g. "Name: ".
+		/// @returns The line.
+		static std::string read_line(const std::string& prompt)
+		{
+			std::string input = get_line(prompt);
+
+			std::string label = prompt.substr(0, prompt.find_last_not_of(": ") + 1);
+			answered(label, input);
+
+			return input;
+		}
+
 		/// Displays a question and gets validated input.
 		/// @param question The question to display.
 		/// @returns Pair of (is_valid_response, user_input).
@@ -5,10 +5,15 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <future>
+#include <optional>
 
 #include "json.hpp"
 #include "hash_sha256.h"
 #include "LibTypes.h"
+#include "Overdue.h"
+#include "History.h"
+#include "Password.h"
 #include "UI.h"
 
 namespace std {
@@ -31,6 +36,93 @@ namespace std {
 	}
 }
 
+/// A loan - a reference to the borrowed book and the day it is due back.
+/// The book's details are kept once by the UserManager, so a loan is a
+/// fixed 16 bytes no matter how long the title is.
+struct Loan
+{
+public:
+	/// The packed ISBN of the borrowed book.
+	std::uint64_t book = 0;
+
+	/// The due day, in days since 1970-01-01. 0 if the loan has no due date.
+	std::int64_t due = 0;
+
+	/// Default constructor.
+	Loan() = default;
+
+	/// Constructor with book id and due day.
+	/// @param book The packed ISBN.
+	/// @param due The due day.
+	explicit Loan(std::uint64_t book, std::int64_t due = 0)
+		: book(book), due(due) { }
+
+	/// Constructor with book and due day.
+	/// @param book The borrowed book.
+	/// @param due The due day.
+	explicit Loan(const LibraryTypes::Book& book, std::int64_t due = 0)
+		: book(book.isbn.packed()), due(due) { }
+
+	~Loan() { }
+
+	bool operator==(const Loan& other) const {
+		return book == other.book && due == other.due;
+	}
+};
+
+/// Serializes a Loan into JSON.
+/// @param j The JSON object to populate.
+/// @param loan The loan to serialize.
+inline void to_json(nlohmann::json& j, const Loan& loan) {
+	j = { {"book", loan.book} };
+
+	if (loan.due != 0) {
+		j["due"] = loan.due;
+	}
+}
+
+/// Deserializes a Loan from JSON.
+/// Loans saved as full book copies, and loans saved before due dates
+/// existed, are read as well.
+/// @param j The JSON object to read from.
+/// @param loan The loan to populate.
+inline void from_json(const nlohmann::json& j, Loan& loan) {
+	if (j.contains("book")) {
+		loan.book = j.at("book").get<std::uint64_t>();
+	}
+	else {
+		loan.book = j.get<LibraryTypes::Book>().isbn.packed();
+	}
+
+	loan.due = j.value("due", std::int64_t(0));
+}
+
+/// A loan resolved against the loaned book's details, for display.
+struct LoanedBook : public LibraryTypes::Book
+{
+public:
+	/// The due day, in days since 1970-01-01. 0 if the loan has no due date.
+	std::int64_t due = 0;
+
+	/// Constructor with book and due day.
+	/// @param book The borrowed book.
+	/// @param due The due day.
+	LoanedBook(const LibraryTypes::Book& book, std::int64_t due)
+		: LibraryTypes::Book(book), due(due) { }
+
+	~LoanedBook() { }
+
+	/// @brief Returns the loan as a string.
+	/// @return The book followed by its due date.
+	std::string ToString() const {
+		if (due == 0) {
+			return Book::ToString();
+		}
+
+		return Book::ToString() + "\nDue: " + OverdueTracker::format(due);
+	}
+};
+
 /// Represents a user of the library system.
 /// Contains personal credentials and a list of borrowed books.
 struct User {
@@ -38,11 +130,23 @@ public:
 	/// The user's name (used for login).
 	std::string name;
 
-	/// The user's hashed password (SHA256).
+	/// The user's hashed password.
+	/// PBKDF2-HMAC-SHA256 when `iterations` is set, otherwise the legacy
+	/// unsalted SHA256 of the zero-padded password.
 	sha256_type password{};
 
-	/// The books currently associated with this user.
-	std::vector<LibraryTypes::Book> books;
+	/// The password's salt.
+	Password::salt_type salt{};
+
+	/// The PBKDF2 iteration count, 0 for a legacy hash.
+	std::uint32_t iterations = 0;
+
+	/// The user's current loans.
+	std::vector<Loan> loans;
+
+	/// The books the user was built with, until `UserManager::add` keeps
+	/// their details as the loans' records. Not saved or compared.
+	std::vector<LibraryTypes::Book> pending;
 
 	/// Default constructor.
 	User() = default;
@@ -59,22 +163,28 @@ public:
 	/// Constructor with name, password, and book list.
 	/// @param name The username.
 	/// @param password The hashed password.
-	/// @param books A list of the user's books.
+	/// @param books A list of the user's books, stored as loans.
 	User(std::string name, sha256_type password, std::vector<LibraryTypes::Book> books)
 	{
 		this->name = name;
 		this->password = password;
-		this->books = books;
+
+		for (const LibraryTypes::Book& book : books)
+		{
+			this->loans.emplace_back(book);
+		}
+		this->pending = std::move(books);
 	}
 
 	~User() { }
 
 	/// Equality operator.
-	/// Users are equal if their name, password, and books match.
+	/// Users are equal if their name, password, and loans match.
 	/// @param other The other user to compare with.
 	/// @returns True if equal.
 	bool operator==(const User& other) const {
-		return name == other.name && password == other.password && books == other.books;
+		return name == other.name && password == other.password && salt == other.salt
+			&& iterations == other.iterations && loans == other.loans;
 	}
 
 	/// Checks if the user is uninitialized (null).
@@ -88,7 +198,7 @@ public:
 	/// @returns String representation of the user.
 	std::string ToString() const {
 		std::ostringstream oss;
-		oss << "Name: " << this->name << " | Books: " << this->books.size();
+		oss << "Name: " << this->name << " | Books: " << this->loans.size();
 		return oss.str();
 	}
 };
@@ -100,17 +210,26 @@ inline void to_json(nlohmann::json& j, const User& user) {
 	j = {
 		{"name", user.name},
 		{"password", user.password},
-		{"books", user.books},
+		{"loans", user.loans},
 	};
+
+	if (user.iterations != 0) {
+		j["salt"] = user.salt;
+		j["iterations"] = user.iterations;
+	}
 }
 
 /// Deserializes a User from JSON.
+/// Users saved before salting load with a legacy hash, and users
+/// saved with full book copies load them as loans.
 /// @param j The JSON object to read from.
 /// @param user The user object to populate.
 inline void from_json(const nlohmann::json& j, User& user) {
 	user.name = j.at("name").get<std::string>();
 	user.password = j.at("password").get<sha256_type>();
-	user.books = j.at("books").get<std::vector<LibraryTypes::Book>>();
+	user.loans = j.contains("loans") ? j.at("loans").get<std::vector<Loan>>() : j.at("books").get<std::vector<Loan>>();
+	user.salt = j.value("salt", Password::salt_type{});
+	user.iterations = j.value("iterations", std::uint32_t(0));
 }
 
 
@@ -125,12 +244,6 @@ namespace std {
 				h ^= std::hash<uint8_t>{}(b)+0x9e3779b9 + (h << 6) + (h >> 2);
 			}
 
-			// hash books
-			for (const auto& book : u.books) {
-				h ^= std::hash<std::string>{}(book.title);
-				h ^= std::hash<std::string>{}(book.author);
-			}
-
 			return h;
 		}
 	};
@@ -145,25 +258,198 @@ private:
 	/// List of all users.
 	std::vector<User> users;
 
-	/// Map of users to their index in the `users` vector.
-	std::unordered_map<User, size_t> users_map;
+	/// Map of user names to their index in the `users` vector.
+	std::unordered_map<std::string, size_t> users_map;
+
+	/// Details of every book on loan - Key: packed ISBN - Value: book.
+	/// Kept once per title however many loans point at it.
+	std::unordered_map<std::uint64_t, LibraryTypes::Book> records;
+
+	/// Current borrowers - Key: packed ISBN - Value: indexes in `users`.
+	std::unordered_map<std::uint64_t, std::vector<size_t>> borrowers;
+
+	/// Due dates of every loan.
+	OverdueTracker overdue;
+
+	/// PBKDF2 iteration count for new & upgraded passwords.
+	std::uint32_t iterations = Password::ITERATIONS;
+
+	/// Nesting depth of `defer_saves`; saving waits for `flush` while non-zero.
+	unsigned deferred = 0;
 
-	/// Utility object for generating SHA256 hashes.
-	hash_sha256 hash;
+	/// Whether a save was skipped while deferred.
+	bool dirty = false;
 
-	/// @brief Rebuilds the internal user index map.
+	/// Every loan ever made, with co-borrow counts.
+	LibraryTypes::LoanHistory history;
+
+	/// Number of `history` loans already appended to the log file.
+	size_t logged = 0;
+
+	/// @brief Rebuilds the internal user & borrower indexes.
 	/// Called after any change to the user list.
+	/// Drops the records of books no one has on loan.
 	void re_index()
 	{
 		users_map.clear();
 
 		for (size_t i = 0; i < users.size(); i++) 
 		{
-			users_map[users[i]] = i;
+			users_map[users[i].name] = i;
+		}
+
+		re_index_borrowers();
+
+		for (auto it = records.begin(); it != records.end(); )
+		{
+			it = borrowers.count(it->first) == 0 ? records.erase(it) : std::next(it);
+		}
+	}
+
+	/// @brief Rebuilds the borrower index from the users' loans.
+	void re_index_borrowers()
+	{
+		borrowers.clear();
+
+		for (size_t i = 0; i < users.size(); i++)
+		{
+			for (const Loan& loan : users[i].loans)
+			{
+				borrowers[loan.book].push_back(i);
+			}
+		}
+	}
+
+	/// @brief Gives a user a loan & updates the borrower index.
+	/// @param index The user's index in `users`.
+	/// @param book The book to lend.
+	void lend_to(size_t index, const LibraryTypes::Book& book)
+	{
+		User& user = users.at(index);
+		Loan loan(book, OverdueTracker::today() + LOAN_DAYS);
+
+		records[loan.book] = book;
+		borrowers[loan.book].push_back(index);
+		overdue.schedule(user.name, loan.book, loan.due);
+		history.record(user.name, book, OverdueTracker::today());
+		user.loans.push_back(loan);
+
+		if (current_user.name == user.name)
+		{
+			current_user.loans = user.loans;
+		}
+	}
+
+	/// @brief Ends a loan & updates the borrower index.
+	/// @param pos The user's index in `users`.
+	/// @param index The index of the loan in the user's loans.
+	/// @returns The loan.
+	Loan release(size_t pos, size_t index)
+	{
+		User& user = users.at(pos);
+		Loan loan = user.loans.at(index);
+		overdue.cancel(user.name, loan.book);
+		user.loans.erase(user.loans.begin() + static_cast<std::ptrdiff_t>(index));
+
+		if (current_user.name == user.name)
+		{
+			current_user.loans = user.loans;
+		}
+
+		std::vector<size_t>& holders = borrowers[loan.book];
+		auto holder = std::find(holders.begin(), holders.end(), pos);
+		if (holder == holders.end())
+		{
+			// The index lost track of this loan; the loans themselves are right
+			re_index_borrowers();
+			return loan;
+		}
+
+		holders.erase(holder);
+		if (holders.empty())
+		{
+			borrowers.erase(loan.book);
+		}
+
+		return loan;
+	}
+
+	/// @brief Gives a loan a placeholder record if it has none.
+	/// @param loan The loan.
+	/// @returns True if a placeholder was added.
+	bool ensure_record(const Loan& loan)
+	{
+		if (records.count(loan.book) != 0)
+		{
+			return false;
+		}
+
+		records.emplace(loan.book, LibraryTypes::Book("(unknown title)", "(unknown author)",
+			LibraryTypes::ISBN::trusted(IsbnBatch::format(loan.book))));
+		return true;
+	}
+
+	/// @brief Gives loans whose record is missing a placeholder record.
+	/// Happens when the users file is newer than the loans file, e.g. after
+	/// a crash between the two writes; the loan is kept & can be returned.
+	void restore_missing_records()
+	{
+		size_t missing = 0;
+		for (const User& user : users)
+		{
+			for (const Loan& loan : user.loans)
+			{
+				missing += ensure_record(loan) ? 1 : 0;
+			}
+		}
+
+		if (missing != 0)
+		{
+			std::cerr << missing << " loans had no book record; placeholders were added" << std::endl;
+		}
+	}
+
+	/// @brief Reads the book details out of users saved with full book copies.
+	/// @param j The users' JSON.
+	void legacy_records(const nlohmann::json& j)
+	{
+		for (const nlohmann::json& user : j)
+		{
+			if (!user.contains("books"))
+			{
+				continue;
+			}
+
+			for (const nlohmann::json& book : user.at("books"))
+			{
+				LibraryTypes::Book record = book.get<LibraryTypes::Book>();
+				records[record.isbn.packed()] = record;
+			}
+		}
+	}
+
+	/// @brief Rebuilds the overdue tracker from every user's loans.
+	/// Called after loading users.
+	void re_schedule()
+	{
+		overdue.clear();
+
+		for (const User& user : users)
+		{
+			for (const Loan& loan : user.loans)
+			{
+				if (loan.due != 0)
+				{
+					overdue.schedule(user.name, loan.book, loan.due);
+				}
+			}
 		}
 	}
 
 public:
+	/// Days a book may be borrowed for.
+	static constexpr std::int64_t LOAN_DAYS = 14;
+
 	/// The currently signed-in user.
 	User current_user;
 
@@ -173,12 +459,21 @@ public:
 
 	UserManager(const UserManager &other)
 		: users(other.users),
+		  records(other.records),
+		  overdue(other.overdue),
+		  iterations(other.iterations),
+		  deferred(other.deferred),
+		  dirty(other.dirty),
+		  history(other.history),
+		  logged(other.logged),
 		  current_user(other.current_user)
 	{
 		// Rebuild the users_map with our new users vector
 		re_index();
 	}
 
+	UserManager& operator=(const UserManager& other) = default;
+
 	~UserManager() { }
 
 	/// @brief Prompts the user to sign in.
@@ -188,37 +483,207 @@ public:
 		std::string name;
 		std::string pass;
 
+		static const std::string header = "CPPII | Assignment 2 | Library: #\n" + UI::DIVIDER + "\nSign In\nPlease enter your name & password";
+
 		UI::CLEAR();
-		std::ostringstream oss;
-		oss << "CPPII | Assignment 2 | Library: #\n" << UI::DIVIDER << "\nSign In\nPlease enter your name & password";
-		std::string f_contents = oss.str();
-		UI::Console::print_message(f_contents);
+		UI::Console::print_message(header);
 
-		std::cout << "Name: ";
-		std::getline(std::cin, name);
-		std::cout << "Password: ";
-		std::getline(std::cin, pass);
+		name = UI::Console::read_line("Name: ");
+		pass = UI::Console::read_line("Password: ");
 
-		auto bytes = std::stobya(pass);
+		if (!authenticate(name, pass)) 
+		{
+			UI::CLEAR();
+			login();
+		}
+	}
+
+	/// @brief Hashes a password the way it was done before salting.
+	/// @param pass The plain text password.
+	/// @returns The unsalted SHA256 of the zero-padded password.
+	static sha256_type legacy_hash(const std::string& pass)
+	{
+		// Padded on the stack like `std::stobya`; longer passwords hashed as all zeros
+		std::array<std::uint8_t, 32U> bytes{};
+		if (pass.size() <= bytes.size())
+		{
+			std::copy(pass.begin(), pass.end(), bytes.begin());
+		}
+
+		hash_sha256 hash;
 		hash.sha256_init();
 		hash.sha256_update(bytes.data(), bytes.size());
-		sha256_type password = hash.sha256_final();
+		return hash.sha256_final();
+	}
+
+	/// @brief Checks a password against a user's stored hash.
+	/// @param user The user.
+	/// @param pass The plain text password.
+	/// @returns True if it matches.
+	static bool verify(const User& user, const std::string& pass)
+	{
+		return verify(user.password, user.salt, user.iterations, pass);
+	}
+
+	/// @brief Checks a password against a stored hash.
+	/// Hashes into stack buffers & compares the 32 byte digests in
+	/// constant time, without allocating.
+	/// @param hash The stored hash.
+	/// @param salt The hash's salt.
+	/// @param rounds The hash's iteration count, 0 for a legacy hash.
+	/// @param pass The plain text password.
+	/// @returns True if it matches.
+	static bool verify(const sha256_type& hash, const Password::salt_type& salt, std::uint32_t rounds, const std::string& pass)
+	{
+		if (rounds == 0)
+		{
+			return Password::equal(hash, legacy_hash(pass));
+		}
+
+		return Password::equal(hash, Password::derive(pass, salt, rounds));
+	}
+
+	/// @brief Checks a password for a name that has no account.
+	/// Derives against a fixed hash & salt at the given iteration count,
+	/// so a wrong name takes as long as a wrong password and sign in
+	/// timings don't reveal which accounts exist.
+	/// @param rounds The iteration count a real hash would have.
+	/// @param pass The plain text password.
+	/// @returns Always false.
+	static bool verify_missing(std::uint32_t rounds, const std::string& pass)
+	{
+		static const sha256_type DUMMY_HASH{};
+		static const Password::salt_type DUMMY_SALT{};
+
+		verify(DUMMY_HASH, DUMMY_SALT, rounds, pass);
+		return false;
+	}
 
-		bool user_found = false;
-		for (User u : users) 
+	/// @brief Checks a sign in without signing in.
+	/// Looks the name up in `users_map` & verifies on the calling thread,
+	/// so no user is copied and nothing is allocated. Unknown names are
+	/// verified against a dummy hash so both paths cost the same.
+	/// @param name The username.
+	/// @param pass The plain text password.
+	/// @returns The user, or nullptr for a wrong name or password.
+	const User* check(const std::string& name, const std::string& pass) const
+	{
+		auto pair = users_map.find(name);
+		if (pair == users_map.end())
 		{
-			if (u.name == name && u.password == password) 
+			verify_missing(iterations, pass);
+			return nullptr;
+		}
+
+		const User& user = users[pair->second];
+		return verify(user, pass) ? &user : nullptr;
+	}
+
+	/// @brief Creates a user with a freshly salted password.
+	/// @param name The username.
+	/// @param pass The plain text password.
+	/// @returns The user.
+	User make_user(const std::string& name, const std::string& pass) const
+	{
+		User user(name, sha256_type{});
+		user.salt = Password::make_salt();
+		user.iterations = iterations;
+		user.password = Password::derive(pass, user.salt, user.iterations);
+		return user;
+	}
+
+	/// @brief Sets the iteration count for new & upgraded passwords.
+	/// Existing users are upgraded the next time they sign in.
+	/// @param count The PBKDF2 iteration count.
+	void set_iterations(std::uint32_t count)
+	{
+		iterations = count;
+	}
+
+	/// @brief Gets the iteration count for new & upgraded passwords.
+	std::uint32_t get_iterations() const
+	{
+		return iterations;
+	}
+
+	/// @brief Queues a sign in check on the shared verification pool.
+	/// @param name The username.
+	/// @param pass The plain text password.
+	/// @returns True once verified, false for a wrong name or password.
+	std::future<bool> verify_async(const std::string& name, const std::string& pass) const
+	{
+		auto pair = users_map.find(name);
+		if (pair != users_map.end())
+		{
+			// Only the hash travels to the pool, not the user's loans
+			const User& u = users[pair->second];
+			return Password::VerifyPool::shared().submit([hash = u.password, salt = u.salt, rounds = u.iterations, pass]()
 			{
-				current_user = u;
-				user_found = true;
-			}
+				return verify(hash, salt, rounds, pass);
+			});
 		}
 
-		if (!user_found) 
+		// Unknown names cost a full verify too, like `check`
+		return Password::VerifyPool::shared().submit([rounds = iterations, pass]()
 		{
-			UI::CLEAR();
-			login();
+			return verify_missing(rounds, pass);
+		});
+	}
+
+	/// @brief Verifies many sign ins in parallel.
+	/// @param logins Pairs of name & plain text password.
+	/// @returns One result per login.
+	std::vector<bool> authenticate(const std::vector<std::pair<std::string, std::string>>& logins) const
+	{
+		std::vector<std::future<bool>> pending;
+		pending.reserve(logins.size());
+
+		for (const auto& [name, pass] : logins)
+		{
+			pending.push_back(verify_async(name, pass));
+		}
+
+		std::vector<bool> res;
+		res.reserve(logins.size());
+
+		for (std::future<bool>& result : pending)
+		{
+			res.push_back(result.get());
 		}
+
+		return res;
+	}
+
+	/// @brief Signs a user in.
+	/// Passwords hashed with an older scheme or a lower iteration count
+	/// are re-hashed with the current settings.
+	/// @param name The username.
+	/// @param pass The plain text password.
+	/// @returns True if signed in.
+	bool authenticate(const std::string& name, const std::string& pass)
+	{
+		const User* user = check(name, pass);
+		if (user == nullptr)
+		{
+			return false;
+		}
+
+		size_t i = static_cast<size_t>(user - users.data());
+		if (users[i].iterations < iterations)
+		{
+			User upgraded = make_user(name, pass);
+			upgraded.loans = users[i].loans;
+			users[i] = upgraded;
+			re_index();
+
+			if (!UI::TEST_MODE)
+			{
+				save();
+			}
+		}
+
+		current_user = users[i];
+		return true;
 	}
 
 	/// @brief Prompts the user to sign up by creating a new user.
@@ -243,17 +708,10 @@ public:
 		std::string name;
 		std::string pass;
 
-		std::cout << "Name: ";
-		std::getline(std::cin, name);
-		std::cout << "Password: ";
-		std::getline(std::cin, pass);
+		name = UI::Console::read_line("Name: ");
+		pass = UI::Console::read_line("Password: ");
 
-		auto bytes = std::stobya(pass);
-		hash.sha256_init();
-		hash.sha256_update(bytes.data(), bytes.size());
-		sha256_type password = hash.sha256_final();
-
-		User user = User(name, password);
+		User user = make_user(name, pass);
 
 		add(user);
 
@@ -287,12 +745,27 @@ public:
 	}
 
 	/// @brief Adds a new user to the system.
+	/// The books the user was built with become their loans' records;
+	/// any other loan without a record gets a placeholder, so every loan
+	/// can be looked up & returned.
 	/// @param user The user to add.
 	void add(const User& user)
 	{
 		users.push_back(user);
 		size_t index = users.size() - 1;
-		users_map[user] = index;
+		users_map[user.name] = index;
+		users[index].pending.clear();
+
+		for (const LibraryTypes::Book& book : user.pending)
+		{
+			records.emplace(book.isbn.packed(), book);
+		}
+
+		for (const Loan& loan : user.loans)
+		{
+			borrowers[loan.book].push_back(index);
+			ensure_record(loan);
+		}
 
 		if(UI::TEST_MODE)
 		{
@@ -302,12 +775,61 @@ public:
 		save();
 	}
 
+	/// @brief Imports many users at once, e.g. when migrating accounts.
+	/// Passwords are derived together across SIMD lanes and the users
+	/// are saved once at the end.
+	/// @param accounts Pairs of name & plain text password.
+	/// @returns The number of users added.
+	size_t import(const std::vector<std::pair<std::string, std::string>>& accounts)
+	{
+		std::vector<std::string> passwords;
+		std::vector<Password::salt_type> salts;
+		passwords.reserve(accounts.size());
+		salts.reserve(accounts.size());
+
+		for (const auto& [name, pass] : accounts)
+		{
+			passwords.push_back(pass);
+			salts.push_back(Password::make_salt());
+		}
+
+		std::vector<sha256_type> keys = Password::derive(passwords, salts, iterations);
+
+		users.reserve(users.size() + accounts.size());
+		for (size_t i = 0; i < accounts.size(); i++)
+		{
+			User user(accounts[i].first, keys[i]);
+			user.salt = salts[i];
+			user.iterations = iterations;
+			users.push_back(user);
+		}
+
+		re_index();
+
+		if(!UI::TEST_MODE)
+		{
+			save();
+		}
+
+		return accounts.size();
+	}
+
 	/// @brief Removes a user from the system.
 	/// @param user The user to remove.
 	void remove(const User& user)
 	{
-		size_t index = users_map[user];
-		users.erase(users.begin() + index);
+		auto pair = users_map.find(user.name);
+		if (pair == users_map.end())
+		{
+			return;
+		}
+
+		for (const Loan& loan : users[pair->second].loans)
+		{
+			overdue.cancel(user.name, loan.book);
+		}
+
+		users.erase(users.begin() + pair->second);
 		re_index();
 
 		if(UI::TEST_MODE)
@@ -319,13 +841,37 @@ public:
 	}
 
 	/// @brief Adds a book to the currently signed-in user.
+	/// The loan is due back in `LOAN_DAYS` days.
 	/// @param book The book to add.
 	void add(const LibraryTypes::Book& book)
 	{
-		current_user.books.push_back(book);
-		size_t index = users_map[current_user];
-		users.at(index) = current_user;
+		auto pair = users_map.find(current_user.name);
+		if (pair == users_map.end())
+		{
+			return;
+		}
+
+		lend_to(pair->second, book);
+		save();
+	}
+
+	/// @brief Lends a book to a user by name.
+	/// Used to hand a returned copy straight to the next patron in line.
+	/// @param name The user's name.
+	/// @param book The book to lend.
+	/// @returns False if no user has that name.
+	bool lend(const std::string& name, const LibraryTypes::Book& book)
+	{
+		auto pair = users_map.find(name);
+		if (pair == users_map.end())
+		{
+			return false;
+		}
+
+		lend_to(pair->second, book);
 		save();
+
+		return true;
 	}
 
 	/// @brief Removes a book from the current user by index.
@@ -333,14 +879,143 @@ public:
 	/// @returns Always returns true.
 	bool remove(int index)
 	{
-		current_user.books.erase(current_user.books.begin() + index);
-		size_t pos = users_map[current_user];
-		users.at(pos) = current_user;
+		Loan loan = release(users_map.at(current_user.name), static_cast<size_t>(index));
+		if (borrowers.count(loan.book) == 0)
+		{
+			records.erase(loan.book);
+		}
+
 		save();
 
 		return true;
 	}
 
+	/// @brief Ends a user's loan of a book.
+	/// @param name The user's name.
+	/// @param book The packed ISBN of the book.
+	/// @returns The book, or nothing if the user has no such loan.
+	std::optional<LibraryTypes::Book> check_in(const std::string& name, std::uint64_t book)
+	{
+		auto pair = users_map.find(name);
+		if (pair == users_map.end())
+		{
+			return std::nullopt;
+		}
+
+		const std::vector<Loan>& loans = users[pair->second].loans;
+		auto it = std::find_if(loans.begin(), loans.end(), [book](const Loan& loan) { return loan.book == book; });
+		if (it == loans.end())
+		{
+			return std::nullopt;
+		}
+
+		LibraryTypes::Book record = records.at(book);
+		release(pair->second, static_cast<size_t>(it - loans.begin()));
+		if (borrowers.count(book) == 0)
+		{
+			records.erase(book);
+		}
+
+		save();
+
+		return record;
+	}
+
+	/// @brief Gets books often borrowed by the patrons of a book.
+	/// Served from precomputed co-borrow counts.
+	/// @param book The book.
+	/// @param n The number of books.
+	/// @returns Up to `n` books, most co-borrowed first.
+	std::vector<LibraryTypes::Book> also_borrowed(const LibraryTypes::Book& book, size_t n = 5) const
+	{
+		return history.recommend(book, n);
+	}
+
+	/// @brief Gets every loan ever made.
+	const LibraryTypes::LoanHistory& loan_history() const
+	{
+		return history;
+	}
+
+	/// @brief Finds a user by name.
+	/// @param name The user's name.
+	/// @returns The user, or nullptr if there is none.
+	const User* find(const std::string& name) const
+	{
+		auto pair = users_map.find(name);
+		return pair == users_map.end() ? nullptr : &users[pair->second];
+	}
+
+	/// @brief Holds back saving until a matching `flush`.
+	/// Lets a batch of changes reach the disk in one write.
+	void defer_saves()
+	{
+		deferred++;
+	}
+
+	/// @brief Ends a `defer_saves`, saving once if anything changed.
+	void flush()
+	{
+		if (deferred != 0 && --deferred == 0 && dirty)
+		{
+			dirty = false;
+			save();
+		}
+	}
+
+	/// @brief Gets the details of a loaned book.
+	/// @param loan The loan.
+	/// @returns The book.
+	const LibraryTypes::Book& book(const Loan& loan) const
+	{
+		return records.at(loan.book);
+	}
+
+	/// @brief Looks up the details of a loaned book.
+	/// @param loan The loan.
+	/// @returns The book, or nullptr if the loan has no record.
+	const LibraryTypes::Book* find_book(const Loan& loan) const
+	{
+		auto pair = records.find(loan.book);
+		return pair == records.end() ? nullptr : &pair->second;
+	}
+
+	/// @brief Resolves a user's loans for display.
+	/// @param user The user.
+	/// @returns The loaned books with their due days.
+	std::vector<LoanedBook> loaned_books(const User& user) const
+	{
+		std::vector<LoanedBook> res;
+		res.reserve(user.loans.size());
+
+		for (const Loan& loan : user.loans)
+		{
+			res.emplace_back(book(loan), loan.due);
+		}
+
+		return res;
+	}
+
+	/// @brief Gets who currently has a book.
+	/// @param book The book.
+	/// @returns The borrowers' names, in the order they borrowed it.
+	std::vector<std::string> borrowers_of(const LibraryTypes::Book& book) const
+	{
+		std::vector<std::string> res;
+		auto pair = borrowers.find(book.isbn.packed());
+		if (pair == borrowers.end())
+		{
+			return res;
+		}
+
+		for (size_t index : pair->second)
+		{
+			res.push_back(users[index].name);
+		}
+
+		return res;
+	}
+
 	/// @brief Gets a user at the specified index.
 	/// @param index The index of the user.
 	/// @returns The user at the given index.
@@ -349,31 +1024,91 @@ public:
 		return users.at(index);
 	}
 
+	/// @brief Checks whether a book is out on loan to anyone.
+	/// @param book The packed ISBN.
+	bool on_loan(std::uint64_t book) const
+	{
+		return records.count(book) != 0;
+	}
+
+	/// @brief Gets every user, e.g. to scan their loans.
+	const std::vector<User>& all() const
+	{
+		return users;
+	}
+
+	/// @brief Lists every overdue loan.
+	/// Advances the due date wheel, then reads its overdue table,
+	/// without scanning the users.
+	/// @param today The day to report for.
+	/// @returns The overdue loans, by user then due day.
+	std::vector<OverdueLoan> overdue_report(std::int64_t today = OverdueTracker::today())
+	{
+		overdue.advance(today);
+		return overdue.report();
+	}
+
 	/// @brief Returns the number of users.
 	size_t size() const
 	{
 		return users.size();
 	}
 
-	/// @brief Saves all users to a JSON file on disk.
-	void save()
+	/// @brief Saves the users, loan records & new loan history.
+	/// Each file is replaced atomically, but not the set. The loan records
+	/// go first, so a crash in between leaves new records beside the old
+	/// users; any loan still left without a record is given a placeholder
+	/// by `load`.
+	/// @returns False if any file could not be written; each failure is reported on stderr.
+	bool save()
 	{
+		if (deferred != 0)
+		{
+			dirty = true;
+			return true;
+		}
+
 		if(UI::TEST_MODE)
 		{
-			return;
+			return true;
+		}
+
+		std::filesystem::path data_path = std::filesystem::current_path() / "data";
+
+		nlohmann::json records_j = nlohmann::json::object();
+		for (const auto& [id, record] : records)
+		{
+			records_j[std::to_string(id)] = record;
 		}
 
-		//std::cout << "Saving users to:" << std::filesystem::current_path() / "data" / "library_users.json" << std::endl;
-		std::filesystem::path users_path = std::filesystem::current_path() / "data" / "library_users.json";
+		bool saved = LibraryTypes::Snapshot::write_checked(data_path / "library_loans.json", records_j.dump(4) + "\n");
 
 		nlohmann::json users_j = users;
-		std::ofstream o(users_path);
-		o << std::setw(4) << users_j << std::endl;
-		o.close();
+		saved = LibraryTypes::Snapshot::write_checked(data_path / "library_users.json", users_j.dump(4) + "\n") && saved;
+
+		// The history is append-only: only loans made since the last save are written
+		if (logged < history.size())
+		{
+			std::ofstream h(data_path / "library_history.log", std::ios::app);
+			for (; logged < history.size(); logged++)
+			{
+				h << history.line(logged) << "\n";
+			}
+			h.close();
+
+			if (!h)
+			{
+				std::cerr << "Could not save " << (data_path / "library_history.log").string() << std::endl;
+				saved = false;
+			}
+		}
+
+		return saved;
 	}
 
 	/// @brief Loads users from disk.
 	/// @returns True if successful, false otherwise.
+	/// @throws std::runtime_error if a snapshot is damaged; it is moved to `<file>.corrupt`.
 	bool load()
 	{
 		
@@ -394,26 +1129,58 @@ public:
 		// Create the 'library_users.json' file if it does not exist
 		if (!std::filesystem::exists(users_path)) 
 		{
-			std::ofstream o(users_path);
-			o << "[]" << std::endl; 
-			o.close();
+			LibraryTypes::Snapshot::write(users_path, "[]\n");
 			return false;
 		}
 	
-		// Load the file if it exists
-		std::ifstream i(users_path);
-		if (!i.is_open()) 
+		// Load the file if its checksums match; a damaged one is set aside
+		std::optional<std::string> text = LibraryTypes::Snapshot::read_checked(users_path);
+		if (!text) 
 		{
 			return false;
 		}
 	
-		nlohmann::json j;
-		i >> j;
-		i.close();
+		nlohmann::json j = nlohmann::json::parse(*text);
 	
+		records.clear();
+		legacy_records(j);
+
+		std::filesystem::path records_path = data_path / "library_loans.json";
+		if (std::optional<std::string> records_text = LibraryTypes::Snapshot::read_checked(records_path))
+		{
+			nlohmann::json records_j = nlohmann::json::parse(*records_text);
+
+			for (const auto& [id, record] : records_j.items())
+			{
+				records[std::stoull(id)] = record.get<LibraryTypes::Book>();
+			}
+		}
+
+		// Replay the loan history; a line torn by a crash is skipped and
+		// closed off so the next append starts on a fresh line
+		std::filesystem::path history_path = data_path / "library_history.log";
+		std::ifstream h(history_path, std::ios::binary);
+		std::string log((std::istreambuf_iterator<char>(h)), std::istreambuf_iterator<char>());
+		h.close();
+
+		history.clear();
+		std::istringstream lines(log);
+		for (std::string line; std::getline(lines, line); )
+		{
+			history.replay(line);
+		}
+		logged = history.size();
+
+		if (!log.empty() && log.back() != '\n')
+		{
+			std::ofstream(history_path, std::ios::app) << "\n";
+		}
+
 		users = j;
+		restore_missing_records();
 	
 		re_index();
+		re_schedule();
 	
 		return true;
 	}
@@ -422,9 +1189,12 @@ public:
 	{
 		nlohmann::json j = nlohmann::json::parse(json);
 
+		records.clear();
+		legacy_records(j);
 		users = j;
 
 		re_index();
+		re_schedule();
 
 		return true;
 	}
@@ -13,6 +13,7 @@
   #include <algorithm>
   #include <array>
   #include <cstdint>
+  #include <cstring>
 
   using sha256_type = std::array<std::uint8_t, 32U>;
 
@@ -44,18 +45,37 @@
 
     auto sha256_update(const std::uint8_t* msg, const size_t length) -> void
     {
-      for (std::size_t i = 0U; i < length; ++i)
+      std::size_t i = 0U;
+
+      // Top up a partially filled block first.
+      if(datalen != 0U)
       {
-        data[datalen] = msg[i];
-        datalen++;
+        const std::size_t fill = (std::min)(static_cast<std::size_t>(64U - datalen), length);
 
-        if(datalen == 64U)
+        std::copy(msg, msg + fill, data.begin() + datalen);
+        datalen += static_cast<std::uint32_t>(fill);
+        i        = fill;
+
+        if(datalen != 64U)
         {
-          sha256_transform();
-          datalen = 0U;
-          bitlen += 512U;
+          return;
         }
+
+        sha256_transform(data.data());
+        datalen = 0U;
+        bitlen += 512U;
       }
+
+      // Whole blocks are compressed straight from the caller's buffer.
+      for( ; (length - i) >= 64U; i += 64U)
+      {
+        sha256_transform(msg + i);
+        bitlen += 512U;
+      }
+
+      // Keep the tail for the next update or the final padding.
+      std::copy(msg + i, msg + length, data.begin());
+      datalen = static_cast<std::uint32_t>(length - i);
     }
 
     auto sha256_final() -> sha256_type
@@ -75,7 +95,7 @@
       {
         data[i++] = 0x80U;
         std::fill((data.begin() + i), data.end(), 0U);
-        sha256_transform();
+        sha256_transform(data.data());
         std::fill_n(data.begin(), 56U, 0U);
       }
 
@@ -91,7 +111,7 @@
       data[57U] = static_cast<std::uint8_t>(bitlen >> UINT8_C(48));
       data[56U] = static_cast<std::uint8_t>(bitlen >> UINT8_C(56));
 
-      sha256_transform();
+      sha256_transform(data.data());
 
       // Since this implementation uses little endian byte ordering and SHA uses big endian,
       // reverse all the bytes when copying the final init_hash_val to the output hash.
@@ -136,23 +156,42 @@
       UINT32_C(0x90BEFFFA), UINT32_C(0xA4506CEB), UINT32_C(0xBEF9A3F7), UINT32_C(0xC67178F2)
     };
 
-    auto sha256_transform() -> void
+    // Reads a big-endian word.
+    static inline auto load_be32(const std::uint8_t* p) -> std::uint32_t
     {
-      std::uint32_t tmp1 = 0U;
-      std::uint32_t tmp2 = 0U;
+      #if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+      std::uint32_t w;
+      std::memcpy(&w, p, sizeof(w));
+      return __builtin_bswap32(w);
+      #else
+      return static_cast<std::uint32_t>
+      (
+          static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[0U]) << 24U)
+        | static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[1U]) << 16U)
+        | static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[2U]) <<  8U)
+        | static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[3U]) <<  0U)
+      );
+      #endif
+    }
+
+    // One round; the caller rotates the working variables by renaming them.
+    static inline auto sha256_round(std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint32_t& d,
+                                    std::uint32_t e, std::uint32_t f, std::uint32_t g, std::uint32_t& h,
+                                    std::uint32_t kw) -> void
+    {
+      const std::uint32_t tmp1 = h + bsig1(e) + ch(e, f, g) + kw;
 
-      std::array<std::uint32_t, 8U> state = {0U};
-      std::array<std::uint32_t, 64U> m    = {0U};
+      d += tmp1;
+      h  = tmp1 + bsig0(a) + maj(a, b, c);
+    }
 
-      for(std::size_t i = 0U, j = 0U; i < 16U; ++i, j += 4U)
+    auto sha256_transform(const std::uint8_t* block) -> void
+    {
+      std::array<std::uint32_t, 64U> m;
+
+      for(std::size_t i = 0U; i < 16U; ++i)
       {
-        m[i] = static_cast<std::uint32_t>
-        (
-            static_cast<std::uint32_t>(static_cast<std::uint32_t>(data[j + 0U]) << 24U)
-          | static_cast<std::uint32_t>(static_cast<std::uint32_t>(data[j + 1U]) << 16U)
-          | static_cast<std::uint32_t>(static_cast<std::uint32_t>(data[j + 2U]) <<  8U)
-          | static_cast<std::uint32_t>(static_cast<std::uint32_t>(data[j + 3U]) <<  0U)
-        );
+        m[i] = load_be32(block + (i * 4U));
       }
 
       for(std::size_t i = 16U ; i < 64U; ++i)
@@ -160,32 +199,36 @@
         m[i] = ssig1(m[i - 2U]) + m[i - 7U] + ssig0(m[i - 15U]) + m[i - 16U];
       }
 
-      std::copy(init_hash_val.begin(), init_hash_val.end() , state.begin());
-
-      for(std::size_t i = 0U; i < 64U; ++i)
+      std::uint32_t a = init_hash_val[0U];
+      std::uint32_t b = init_hash_val[1U];
+      std::uint32_t c = init_hash_val[2U];
+      std::uint32_t d = init_hash_val[3U];
+      std::uint32_t e = init_hash_val[4U];
+      std::uint32_t f = init_hash_val[5U];
+      std::uint32_t g = init_hash_val[6U];
+      std::uint32_t h = init_hash_val[7U];
+
+      // Eight rounds per step, so no values are shuffled between rounds.
+      for(std::size_t i = 0U; i < 64U; i += 8U)
       {
-        tmp1 = state[7U] + bsig1(state[4U]) + ch(state[4U], state[5U], state[6U]) + K[i] + m[i];
-
-        tmp2 = bsig0(state[0U]) + maj(state[0U], state[1U], state[2U]);
-
-        state[7U] = state[6U];
-        state[6U] = state[5U];
-        state[5U] = state[4U];
-        state[4U] = state[3U] + tmp1;
-        state[3U] = state[2U];
-        state[2U] = state[1U];
-        state[1U] = state[0U];
-        state[0U] = tmp1 + tmp2;
+        sha256_round(a, b, c, d, e, f, g, h, K[i + 0U] + m[i + 0U]);
+        sha256_round(h, a, b, c, d, e, f, g, K[i + 1U] + m[i + 1U]);
+        sha256_round(g, h, a, b, c, d, e, f, K[i + 2U] + m[i + 2U]);
+        sha256_round(f, g, h, a, b, c, d, e, K[i + 3U] + m[i + 3U]);
+        sha256_round(e, f, g, h, a, b, c, d, K[i + 4U] + m[i + 4U]);
+        sha256_round(d, e, f, g, h, a, b, c, K[i + 5U] + m[i + 5U]);
+        sha256_round(c, d, e, f, g, h, a, b, K[i + 6U] + m[i + 6U]);
+        sha256_round(b, c, d, e, f, g, h, a, K[i + 7U] + m[i + 7U]);
       }
 
-      init_hash_val[0U] += state[0U];
-      init_hash_val[1U] += state[1U];
-      init_hash_val[2U] += state[2U];
-      init_hash_val[3U] += state[3U];
-      init_hash_val[4U] += state[4U];
-      init_hash_val[5U] += state[5U];
-      init_hash_val[6U] += state[6U];
-      init_hash_val[7U] += state[7U];
+      init_hash_val[0U] += a;
+      init_hash_val[1U] += b;
+      init_hash_val[2U] += c;
+      init_hash_val[3U] += d;
+      init_hash_val[4U] += e;
+      init_hash_val[5U] += f;
+      init_hash_val[6U] += g;
+      init_hash_val[7U] += h;
     }
 
     // circular left shift ROTR^n(x)
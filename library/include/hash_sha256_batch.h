@@ -0,0 +1,499 @@
+#ifndef HASH_SHA256_BATCH_H
+  #define HASH_SHA256_BATCH_H
+
+  #include <array>
+  #include <cstddef>
+  #include <cstdint>
+  #include <cstring>
+  #include <string>
+  #include <vector>
+
+  #include "hash_sha256.h"
+
+  #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define HASH_SHA256_BATCH_X86 1
+    #include <cpuid.h>
+    #include <immintrin.h>
+  #endif
+
+  // Hashes many independent messages at once.
+  // The SIMD engines run one message per vector lane (4 lanes with SSE2,
+  // 8 with AVX2); the SHA-NI engine uses the CPU's SHA instructions one
+  // message at a time. The engine is picked at runtime and the scalar
+  // engine (hash_sha256) is always available.
+  class hash_sha256_batch
+  {
+  public:
+    enum class engine
+    {
+      scalar,
+      sse2,
+      avx2,
+      sha_ni
+    };
+
+    hash_sha256_batch()                         = delete;
+    hash_sha256_batch(const hash_sha256_batch&) = delete;
+
+    // Fastest engine the CPU supports.
+    static auto best() -> engine
+    {
+      static const engine selected = detect();
+      return selected;
+    }
+
+    // Checks if the CPU supports an engine.
+    static auto supported(engine e) -> bool
+    {
+      #if defined(HASH_SHA256_BATCH_X86)
+      switch(e)
+      {
+        case engine::scalar: return true;
+        case engine::sse2:   return __builtin_cpu_supports("sse2");
+        case engine::avx2:   return __builtin_cpu_supports("avx2");
+        case engine::sha_ni: return cpu_has_sha();
+      }
+      return false;
+      #else
+      return (e == engine::scalar);
+      #endif
+    }
+
+    // Hashes count messages; out must have room for count digests.
+    static auto hash(const std::uint8_t* const* msgs,
+                     const std::size_t*         lengths,
+                     std::size_t                count,
+                     sha256_type*               out,
+                     engine                     e = best()) -> void
+    {
+      if(!supported(e))
+      {
+        e = engine::scalar;
+      }
+
+      switch(e)
+      {
+        #if defined(HASH_SHA256_BATCH_X86)
+        case engine::sse2:   hash_lanes<4U>(msgs, lengths, count, out, compress_sse2); return;
+        case engine::avx2:   hash_lanes<8U>(msgs, lengths, count, out, compress_avx2); return;
+        case engine::sha_ni: hash_sha_ni(msgs, lengths, count, out); return;
+        #endif
+        default:             hash_scalar(msgs, lengths, count, out); return;
+      }
+    }
+
+    // Hashes a list of strings.
+    static auto hash(const std::vector<std::string>& msgs, engine e = best()) -> std::vector<sha256_type>
+    {
+      std::vector<const std::uint8_t*> ptrs(msgs.size());
+      std::vector<std::size_t>         lens(msgs.size());
+
+      for(std::size_t i = 0U; i < msgs.size(); ++i)
+      {
+        ptrs[i] = reinterpret_cast<const std::uint8_t*>(msgs[i].data());
+        lens[i] = msgs[i].size();
+      }
+
+      std::vector<sha256_type> out(msgs.size());
+      hash(ptrs.data(), lens.data(), msgs.size(), out.data(), e);
+      return out;
+    }
+
+    // Hashes a list of fixed 32 byte messages, e.g. std::stobya passwords.
+    static auto hash(const std::vector<std::array<std::uint8_t, 32U>>& msgs, engine e = best()) -> std::vector<sha256_type>
+    {
+      std::vector<const std::uint8_t*> ptrs(msgs.size());
+      std::vector<std::size_t>         lens(msgs.size(), 32U);
+
+      for(std::size_t i = 0U; i < msgs.size(); ++i)
+      {
+        ptrs[i] = msgs[i].data();
+      }
+
+      std::vector<sha256_type> out(msgs.size());
+      hash(ptrs.data(), lens.data(), msgs.size(), out.data(), e);
+      return out;
+    }
+
+  private:
+    static constexpr std::array<std::uint32_t, 8U> H0 =
+    {
+      UINT32_C(0x6A09E667), UINT32_C(0xBB67AE85), UINT32_C(0x3C6EF372), UINT32_C(0xA54FF53A),
+      UINT32_C(0x510E527F), UINT32_C(0x9B05688C), UINT32_C(0x1F83D9AB), UINT32_C(0x5BE0CD19)
+    };
+
+    alignas(16) static constexpr std::array<std::uint32_t, 64U> K =
+    {
+      UINT32_C(0x428A2F98), UINT32_C(0x71374491), UINT32_C(0xB5C0FBCF), UINT32_C(0xE9B5DBA5),
+      UINT32_C(0x3956C25B), UINT32_C(0x59F111F1), UINT32_C(0x923F82A4), UINT32_C(0xAB1C5ED5),
+      UINT32_C(0xD807AA98), UINT32_C(0x12835B01), UINT32_C(0x243185BE), UINT32_C(0x550C7DC3),
+      UINT32_C(0x72BE5D74), UINT32_C(0x80DEB1FE), UINT32_C(0x9BDC06A7), UINT32_C(0xC19BF174),
+      UINT32_C(0xE49B69C1), UINT32_C(0xEFBE4786), UINT32_C(0x0FC19DC6), UINT32_C(0x240CA1CC),
+      UINT32_C(0x2DE92C6F), UINT32_C(0x4A7484AA), UINT32_C(0x5CB0A9DC), UINT32_C(0x76F988DA),
+      UINT32_C(0x983E5152), UINT32_C(0xA831C66D), UINT32_C(0xB00327C8), UINT32_C(0xBF597FC7),
+      UINT32_C(0xC6E00BF3), UINT32_C(0xD5A79147), UINT32_C(0x06CA6351), UINT32_C(0x14292967),
+      UINT32_C(0x27B70A85), UINT32_C(0x2E1B2138), UINT32_C(0x4D2C6DFC), UINT32_C(0x53380D13),
+      UINT32_C(0x650A7354), UINT32_C(0x766A0ABB), UINT32_C(0x81C2C92E), UINT32_C(0x92722C85),
+      UINT32_C(0xA2BFE8A1), UINT32_C(0xA81A664B), UINT32_C(0xC24B8B70), UINT32_C(0xC76C51A3),
+      UINT32_C(0xD192E819), UINT32_C(0xD6990624), UINT32_C(0xF40E3585), UINT32_C(0x106AA070),
+      UINT32_C(0x19A4C116), UINT32_C(0x1E376C08), UINT32_C(0x2748774C), UINT32_C(0x34B0BCB5),
+      UINT32_C(0x391C0CB3), UINT32_C(0x4ED8AA4A), UINT32_C(0x5B9CCA4F), UINT32_C(0x682E6FF3),
+      UINT32_C(0x748F82EE), UINT32_C(0x78A5636F), UINT32_C(0x84C87814), UINT32_C(0x8CC70208),
+      UINT32_C(0x90BEFFFA), UINT32_C(0xA4506CEB), UINT32_C(0xBEF9A3F7), UINT32_C(0xC67178F2)
+    };
+
+    // One message split into whole blocks read in place and a padded tail.
+    struct message
+    {
+      const std::uint8_t*            data;
+      std::size_t                    full;
+      std::size_t                    blocks;
+      std::array<std::uint8_t, 128U> tail;
+
+      auto prepare(const std::uint8_t* msg, const std::size_t length) -> void
+      {
+        data   = msg;
+        full   = length / 64U;
+
+        const std::size_t rest = length % 64U;
+        const std::size_t pad  = (rest < 56U) ? 1U : 2U;
+
+        blocks = full + pad;
+
+        tail.fill(0U);
+        if(rest != 0U)
+        {
+          std::memcpy(tail.data(), msg + (full * 64U), rest);
+        }
+        tail[rest] = 0x80U;
+
+        const std::uint64_t bits = static_cast<std::uint64_t>(length) * 8U;
+        const std::size_t   end  = pad * 64U;
+
+        for(std::size_t i = 0U; i < 8U; ++i)
+        {
+          tail[end - 1U - i] = static_cast<std::uint8_t>(bits >> (i * 8U));
+        }
+      }
+
+      auto block(const std::size_t b) const -> const std::uint8_t*
+      {
+        return (b < full) ? (data + (b * 64U)) : (tail.data() + ((b - full) * 64U));
+      }
+    };
+
+    static inline auto load_be32(const std::uint8_t* p) -> std::uint32_t
+    {
+      return   static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[0U]) << 24U)
+             | static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[1U]) << 16U)
+             | static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[2U]) <<  8U)
+             | static_cast<std::uint32_t>(static_cast<std::uint32_t>(p[3U]) <<  0U);
+    }
+
+    static inline auto store_digest(const std::uint32_t* state, sha256_type& out) -> void
+    {
+      for(std::size_t i = 0U; i < 8U; ++i)
+      {
+        out[(i * 4U) + 0U] = static_cast<std::uint8_t>(state[i] >> 24U);
+        out[(i * 4U) + 1U] = static_cast<std::uint8_t>(state[i] >> 16U);
+        out[(i * 4U) + 2U] = static_cast<std::uint8_t>(state[i] >>  8U);
+        out[(i * 4U) + 3U] = static_cast<std::uint8_t>(state[i] >>  0U);
+      }
+    }
+
+    static auto hash_scalar(const std::uint8_t* const* msgs,
+                            const std::size_t*         lengths,
+                            std::size_t                count,
+                            sha256_type*               out) -> void
+    {
+      hash_sha256 h;
+      for(std::size_t i = 0U; i < count; ++i)
+      {
+        h.sha256_init();
+        h.sha256_update(msgs[i], lengths[i]);
+        out[i] = h.sha256_final();
+      }
+    }
+
+    #if defined(HASH_SHA256_BATCH_X86)
+    static auto cpu_has_sha() -> bool
+    {
+      unsigned int a = 0U, b = 0U, c = 0U, d = 0U;
+      if(__get_cpuid_count(7U, 0U, &a, &b, &c, &d) == 0)
+      {
+        return false;
+      }
+
+      return (((b >> 29U) & 1U) != 0U) && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3");
+    }
+
+    static auto detect() -> engine
+    {
+      // Eight AVX2 lanes outrun the single stream SHA-NI engine on batches.
+      if(__builtin_cpu_supports("avx2")) { return engine::avx2; }
+      if(cpu_has_sha())                  { return engine::sha_ni; }
+      if(__builtin_cpu_supports("sse2")) { return engine::sse2; }
+      return engine::scalar;
+    }
+
+    // Compresses one block per lane; state holds 8 words x LANES.
+    using lane_compress = void (*)(std::uint32_t* state, const std::uint8_t* const* blocks);
+
+    // Runs the messages through a lane engine, LANES at a time.
+    // Lanes whose message is shorter than the longest one in the group
+    // keep hashing a zero block; their digest is taken after their last block.
+    template<std::size_t LANES>
+    static auto hash_lanes(const std::uint8_t* const* msgs,
+                           const std::size_t*         lengths,
+                           std::size_t                count,
+                           sha256_type*               out,
+                           lane_compress              compress) -> void
+    {
+      static const std::array<std::uint8_t, 64U> zero = {0U};
+
+      std::array<message, LANES> lanes;
+      alignas(32) std::array<std::uint32_t, 8U * LANES> state;
+      std::array<std::uint32_t, 8U> digest;
+      std::array<const std::uint8_t*, LANES> blocks;
+
+      for(std::size_t first = 0U; first < count; first += LANES)
+      {
+        const std::size_t used = ((count - first) < LANES) ? (count - first) : LANES;
+
+        std::size_t longest = 0U;
+        for(std::size_t l = 0U; l < LANES; ++l)
+        {
+          const std::size_t m = first + ((l < used) ? l : 0U);
+          lanes[l].prepare(msgs[m], lengths[m]);
+          longest = (lanes[l].blocks > longest) ? lanes[l].blocks : longest;
+        }
+
+        for(std::size_t w = 0U; w < 8U; ++w)
+        {
+          for(std::size_t l = 0U; l < LANES; ++l)
+          {
+            state[(w * LANES) + l] = H0[w];
+          }
+        }
+
+        for(std::size_t b = 0U; b < longest; ++b)
+        {
+          for(std::size_t l = 0U; l < LANES; ++l)
+          {
+            blocks[l] = (b < lanes[l].blocks) ? lanes[l].block(b) : zero.data();
+          }
+
+          compress(state.data(), blocks.data());
+
+          for(std::size_t l = 0U; l < used; ++l)
+          {
+            if(lanes[l].blocks == (b + 1U))
+            {
+              for(std::size_t w = 0U; w < 8U; ++w)
+              {
+                digest[w] = state[(w * LANES) + l];
+              }
+              store_digest(digest.data(), out[first + l]);
+            }
+          }
+        }
+      }
+    }
+
+    // SSE2 helpers, 4 lanes.
+    static inline auto rotr4(__m128i x, int n) -> __m128i
+    {
+      return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+    }
+
+    static auto compress_sse2(std::uint32_t* state, const std::uint8_t* const* blocks) -> void
+    {
+      __m128i w[64U];
+
+      for(std::size_t t = 0U; t < 16U; ++t)
+      {
+        w[t] = _mm_set_epi32(static_cast<int>(load_be32(blocks[3U] + (t * 4U))),
+                             static_cast<int>(load_be32(blocks[2U] + (t * 4U))),
+                             static_cast<int>(load_be32(blocks[1U] + (t * 4U))),
+                             static_cast<int>(load_be32(blocks[0U] + (t * 4U))));
+      }
+
+      for(std::size_t t = 16U; t < 64U; ++t)
+      {
+        const __m128i s0 = _mm_xor_si128(_mm_xor_si128(rotr4(w[t - 15U], 7), rotr4(w[t - 15U], 18)), _mm_srli_epi32(w[t - 15U], 3));
+        const __m128i s1 = _mm_xor_si128(_mm_xor_si128(rotr4(w[t -  2U], 17), rotr4(w[t - 2U], 19)), _mm_srli_epi32(w[t - 2U], 10));
+        w[t] = _mm_add_epi32(_mm_add_epi32(s1, w[t - 7U]), _mm_add_epi32(s0, w[t - 16U]));
+      }
+
+      __m128i* st = reinterpret_cast<__m128i*>(state);
+      __m128i a = _mm_load_si128(st + 0), b = _mm_load_si128(st + 1), c = _mm_load_si128(st + 2), d = _mm_load_si128(st + 3);
+      __m128i e = _mm_load_si128(st + 4), f = _mm_load_si128(st + 5), g = _mm_load_si128(st + 6), h = _mm_load_si128(st + 7);
+
+      for(std::size_t t = 0U; t < 64U; ++t)
+      {
+        const __m128i S1  = _mm_xor_si128(_mm_xor_si128(rotr4(e, 6), rotr4(e, 11)), rotr4(e, 25));
+        const __m128i ch  = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+        const __m128i t1  = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(h, S1), _mm_add_epi32(ch, w[t])),
+                                          _mm_set1_epi32(static_cast<int>(K[t])));
+        const __m128i S0  = _mm_xor_si128(_mm_xor_si128(rotr4(a, 2), rotr4(a, 13)), rotr4(a, 22));
+        const __m128i maj = _mm_xor_si128(_mm_xor_si128(_mm_and_si128(a, b), _mm_and_si128(a, c)), _mm_and_si128(b, c));
+        const __m128i t2  = _mm_add_epi32(S0, maj);
+
+        h = g; g = f; f = e; e = _mm_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm_add_epi32(t1, t2);
+      }
+
+      _mm_store_si128(st + 0, _mm_add_epi32(_mm_load_si128(st + 0), a));
+      _mm_store_si128(st + 1, _mm_add_epi32(_mm_load_si128(st + 1), b));
+      _mm_store_si128(st + 2, _mm_add_epi32(_mm_load_si128(st + 2), c));
+      _mm_store_si128(st + 3, _mm_add_epi32(_mm_load_si128(st + 3), d));
+      _mm_store_si128(st + 4, _mm_add_epi32(_mm_load_si128(st + 4), e));
+      _mm_store_si128(st + 5, _mm_add_epi32(_mm_load_si128(st + 5), f));
+      _mm_store_si128(st + 6, _mm_add_epi32(_mm_load_si128(st + 6), g));
+      _mm_store_si128(st + 7, _mm_add_epi32(_mm_load_si128(st + 7), h));
+    }
+
+    // AVX2 helpers, 8 lanes.
+    __attribute__((target("avx2")))
+    static inline auto rotr8(__m256i x, int n) -> __m256i
+    {
+      return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+    }
+
+    __attribute__((target("avx2")))
+    static auto compress_avx2(std::uint32_t* state, const std::uint8_t* const* blocks) -> void
+    {
+      __m256i w[64U];
+
+      for(std::size_t t = 0U; t < 16U; ++t)
+      {
+        w[t] = _mm256_set_epi32(static_cast<int>(load_be32(blocks[7U] + (t * 4U))),
+                                static_cast<int>(load_be32(blocks[6U] + (t * 4U))),
+                                static_cast<int>(load_be32(blocks[5U] + (t * 4U))),
+                                static_cast<int>(load_be32(blocks[4U] + (t * 4U))),
+                                static_cast<int>(load_be32(blocks[3U] + (t * 4U))),
+                                static_cast<int>(load_be32(blocks[2U] + (t * 4U))),
+                                static_cast<int>(load_be32(blocks[1U] + (t * 4U))),
+                                static_cast<int>(load_be32(blocks[0U] + (t * 4U))));
+      }
+
+      for(std::size_t t = 16U; t < 64U; ++t)
+      {
+        const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[t - 15U], 7), rotr8(w[t - 15U], 18)), _mm256_srli_epi32(w[t - 15U], 3));
+        const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[t -  2U], 17), rotr8(w[t - 2U], 19)), _mm256_srli_epi32(w[t - 2U], 10));
+        w[t] = _mm256_add_epi32(_mm256_add_epi32(s1, w[t - 7U]), _mm256_add_epi32(s0, w[t - 16U]));
+      }
+
+      __m256i* st = reinterpret_cast<__m256i*>(state);
+      __m256i a = _mm256_load_si256(st + 0), b = _mm256_load_si256(st + 1), c = _mm256_load_si256(st + 2), d = _mm256_load_si256(st + 3);
+      __m256i e = _mm256_load_si256(st + 4), f = _mm256_load_si256(st + 5), g = _mm256_load_si256(st + 6), h = _mm256_load_si256(st + 7);
+
+      for(std::size_t t = 0U; t < 64U; ++t)
+      {
+        const __m256i S1  = _mm256_xor_si256(_mm256_xor_si256(rotr8(e, 6), rotr8(e, 11)), rotr8(e, 25));
+        const __m256i ch  = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        const __m256i t1  = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(h, S1), _mm256_add_epi32(ch, w[t])),
+                                             _mm256_set1_epi32(static_cast<int>(K[t])));
+        const __m256i S0  = _mm256_xor_si256(_mm256_xor_si256(rotr8(a, 2), rotr8(a, 13)), rotr8(a, 22));
+        const __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)), _mm256_and_si256(b, c));
+        const __m256i t2  = _mm256_add_epi32(S0, maj);
+
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+      }
+
+      _mm256_store_si256(st + 0, _mm256_add_epi32(_mm256_load_si256(st + 0), a));
+      _mm256_store_si256(st + 1, _mm256_add_epi32(_mm256_load_si256(st + 1), b));
+      _mm256_store_si256(st + 2, _mm256_add_epi32(_mm256_load_si256(st + 2), c));
+      _mm256_store_si256(st + 3, _mm256_add_epi32(_mm256_load_si256(st + 3), d));
+      _mm256_store_si256(st + 4, _mm256_add_epi32(_mm256_load_si256(st + 4), e));
+      _mm256_store_si256(st + 5, _mm256_add_epi32(_mm256_load_si256(st + 5), f));
+      _mm256_store_si256(st + 6, _mm256_add_epi32(_mm256_load_si256(st + 6), g));
+      _mm256_store_si256(st + 7, _mm256_add_epi32(_mm256_load_si256(st + 7), h));
+    }
+
+    // SHA-NI, one block at a time. The state is kept as ABEF/CDGH pairs
+    // as the sha256rnds2 instruction expects.
+    __attribute__((target("sha,sse4.1,ssse3")))
+    static auto compress_sha_ni(__m128i& abef, __m128i& cdgh, const std::uint8_t* block) -> void
+    {
+      const __m128i mask = _mm_set_epi64x(0x0C0D0E0F08090A0BLL, 0x0405060700010203LL);
+
+      const __m128i abef_save = abef;
+      const __m128i cdgh_save = cdgh;
+
+      __m128i m[4U];
+      for(std::size_t i = 0U; i < 4U; ++i)
+      {
+        m[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + (i * 16U))), mask);
+      }
+
+      for(std::size_t i = 0U; i < 16U; ++i)
+      {
+        __m128i msg = _mm_add_epi32(m[i % 4U], _mm_load_si128(reinterpret_cast<const __m128i*>(K.data() + (i * 4U))));
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+
+        if((i >= 3U) && (i <= 14U))
+        {
+          const __m128i tmp = _mm_alignr_epi8(m[i % 4U], m[(i + 3U) % 4U], 4);
+          m[(i + 1U) % 4U] = _mm_sha256msg2_epu32(_mm_add_epi32(m[(i + 1U) % 4U], tmp), m[i % 4U]);
+        }
+
+        msg  = _mm_shuffle_epi32(msg, 0x0E);
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, msg);
+
+        if((i >= 1U) && (i <= 12U))
+        {
+          m[(i + 3U) % 4U] = _mm_sha256msg1_epu32(m[(i + 3U) % 4U], m[i % 4U]);
+        }
+      }
+
+      abef = _mm_add_epi32(abef, abef_save);
+      cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    __attribute__((target("sha,sse4.1,ssse3")))
+    static auto hash_sha_ni(const std::uint8_t* const* msgs,
+                            const std::size_t*         lengths,
+                            std::size_t                count,
+                            sha256_type*               out) -> void
+    {
+      message msg;
+      alignas(16) std::array<std::uint32_t, 8U> state;
+
+      for(std::size_t i = 0U; i < count; ++i)
+      {
+        msg.prepare(msgs[i], lengths[i]);
+
+        __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(H0.data()));
+        __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i*>(H0.data() + 4U));
+
+        const __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+        const __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+        __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+        __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+        for(std::size_t b = 0U; b < msg.blocks; ++b)
+        {
+          compress_sha_ni(abef, cdgh, msg.block(b));
+        }
+
+        const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+        const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+        dcba = _mm_blend_epi16(feba, dchg, 0xF0);
+        hgfe = _mm_alignr_epi8(dchg, feba, 8);
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(state.data()),      dcba);
+        _mm_store_si128(reinterpret_cast<__m128i*>(state.data() + 4U), hgfe);
+
+        store_digest(state.data(), out[i]);
+      }
+    }
+    #else
+    static auto detect() -> engine
+    {
+      return engine::scalar;
+    }
+    #endif
+  };
+#endif // HASH_SHA256_BATCH_H
@@ -1,9 +1,31 @@
+#include <memory>
+#include <string>
+
 #include "../include/App.h"
+#include "../include/Trace.h"
 
-int main()
+int main(int argc, char* argv[])
 {
     UI::TEST_MODE = false;
+
+    // library --record <trace> appends the session to a trace for library_replay
+    std::unique_ptr<UI::Recorder> recorder;
+    if (argc == 3 && std::string(argv[1]) == "--record")
+    {
+        recorder = std::make_unique<UI::Recorder>(argv[2]);
+    }
+
+    // Leave quietly when input ends instead of prompting forever
+    UI::SESSION.strict = true;
+
     LibraryApp app;
-    app.start();
+    try
+    {
+        app.start();
+    }
+    catch (const UI::EndOfInput&)
+    {
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <thread>
+#include <unordered_set>
 #include "../include/LibTypes.h"
 #include "../include/json.hpp"
 
@@ -199,6 +201,321 @@ TEST(LibraryTests, LoadBooksInvalid)
   EXPECT_THROW(lib.load(json), std::runtime_error);
 }
 
+TEST(LibraryTests, LoadConvertsIsbn10)
+{
+  std::string json = R"([{"author":"A","isbn":"0-306-40615-2","title":"Ten"},{"author":"B","isbn":"978-3-16-148410-0","title":"Thirteen"}])";
+  LibraryTypes::Library lib;
+  EXPECT_TRUE(lib.load(json));
+  EXPECT_EQ(lib.books[0].isbn.code, "9780306406157");
+  EXPECT_EQ(lib.books[1].isbn.code, "978-3-16-148410-0");
+  EXPECT_EQ(lib.search("9780306406157", LibraryTypes::SEARCH::CODE).size(), 1);
+}
+
+// Batch ISBN Tests
+TEST(IsbnBatchTests, ValidatesAndReportsFailures)
+{
+  std::vector<std::string> codes = {
+    "978-3-16-148410-0",
+    "978-3-16-148410-1",
+    "0-306-40615-2",
+    "0-8044-2957-X",
+    "0-306-40615-3",
+    "978-3-16",
+    "9783161484100",
+    "978-0-306-40615-7-1"
+  };
+
+  IsbnBatch::Report report = IsbnBatch::validate(codes);
+  EXPECT_EQ(report.failed, std::vector<size_t>({ 1, 4, 5, 7 }));
+  EXPECT_EQ(report.converted, std::vector<size_t>({ 2, 3 }));
+  EXPECT_EQ(report.packed[0], 9783161484100ULL);
+  EXPECT_EQ(report.packed[2], 9780306406157ULL);
+  EXPECT_EQ(IsbnBatch::format(report.packed[3]), "9780804429573");
+  EXPECT_EQ(report.packed[1], 0);
+  EXPECT_EQ(report.packed[6], 9783161484100ULL);
+}
+
+TEST(IsbnBatchTests, AgreesWithIsbnConstructor)
+{
+  std::vector<std::string> codes;
+  for (int i = 0; i < 999; i++) {
+    std::string code = LibraryTypes::ISBN().code;
+    if (i % 3 == 0) {
+      code.back() = static_cast<char>('0' + (code.back() - '0' + 1) % 10);
+    }
+    codes.push_back(code);
+  }
+
+  IsbnBatch::Report report = IsbnBatch::validate(codes);
+  for (size_t i = 0; i < codes.size(); i++) {
+    bool valid = true;
+    try {
+      LibraryTypes::ISBN isbn(codes[i]);
+      EXPECT_EQ(report.packed[i], isbn.packed());
+    }
+    catch (const std::runtime_error&) {
+      valid = false;
+    }
+    EXPECT_EQ(valid, report.packed[i] != 0);
+  }
+  EXPECT_EQ(report.failed.size(), 333);
+}
+
+TEST(IsbnGeneratorTests, UniqueValidAndDeterministic)
+{
+  LibraryTypes::IsbnGenerator first(7);
+  LibraryTypes::IsbnGenerator second(7);
+  std::unordered_set<std::string> seen;
+  std::vector<std::string> codes;
+
+  for (int i = 0; i < 100000; i++) {
+    std::string code = first.next();
+    EXPECT_EQ(code, second.next());
+    EXPECT_TRUE(seen.insert(code).second);
+    codes.push_back(code);
+  }
+
+  EXPECT_TRUE(IsbnBatch::validate(codes).failed.empty());
+  EXPECT_NO_THROW(LibraryTypes::ISBN{ codes[0] });
+  EXPECT_NE(LibraryTypes::IsbnGenerator(8).next(), codes[0]);
+}
+
+TEST(IsbnGeneratorTests, LibrarySkipsCodesInUse)
+{
+  LibraryTypes::Library lib;
+  lib.seed_isbns(3);
+  LibraryTypes::ISBN taken = lib.new_isbn();
+  lib.add(LibraryTypes::Book("Taken", "Author", taken));
+
+  lib.seed_isbns(3);
+  auto fresh = lib.new_isbns(50);
+  for (const LibraryTypes::ISBN& isbn : fresh) {
+    EXPECT_NE(isbn.code, taken.code);
+    EXPECT_FALSE(lib.contains(isbn));
+  }
+}
+
+TEST(IsbnGeneratorTests, LibrarySkipsCodesWrittenWithoutHyphens)
+{
+  // The generator's first code, shelved the way converted ISBN-10s are written
+  std::string first = LibraryTypes::IsbnGenerator(5).next();
+  std::string plain;
+  std::copy_if(first.begin(), first.end(), std::back_inserter(plain), [](char c) { return c != '-'; });
+
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("Shelved", "Author", plain));
+  ASSERT_TRUE(lib.contains(LibraryTypes::ISBN(first)));
+
+  lib.seed_isbns(5);
+  LibraryTypes::ISBN fresh = lib.new_isbn();
+  EXPECT_NE(fresh.packed(), LibraryTypes::ISBN(plain).packed());
+  EXPECT_FALSE(lib.contains(fresh));
+}
+
+TEST(PostingsTests, RoundTripsAndCompresses)
+{
+  std::vector<std::uint32_t> ids = { 0, 1, 127, 128, 300, 16384, 2097152, 268435456, 4294967295u };
+  LibraryTypes::Postings sparse;
+  for (std::uint32_t id : ids) {
+    sparse.add(id);
+  }
+  EXPECT_EQ(sparse.decode(), ids);
+  EXPECT_EQ(sparse.size(), ids.size());
+
+  LibraryTypes::Postings dense;
+  for (std::uint32_t id = 1000; id < 11000; id++) {
+    dense.add(id);
+  }
+  EXPECT_TRUE(dense.is_bitmap());
+  EXPECT_EQ(dense.size(), 10000u);
+  EXPECT_EQ(dense.encoded_size(), (10999u / 64 - 1000u / 64 + 1) * 8);
+  EXPECT_EQ(dense.decode().front(), 1000u);
+  EXPECT_EQ(dense.decode().back(), 10999u);
+}
+
+TEST(PostingsTests, SwitchesBetweenDeltasAndBitmap)
+{
+  std::vector<std::uint32_t> ids;
+  LibraryTypes::Postings list;
+  for (std::uint32_t id = 500; id < 2000; id += 3) {
+    list.add(id);
+    ids.push_back(id);
+  }
+  EXPECT_TRUE(list.is_bitmap());
+  EXPECT_EQ(list.decode(), ids);
+
+  // A far id would make the bitmap sparse, so the list goes back to deltas
+  list.add(5000000);
+  ids.push_back(5000000);
+  EXPECT_FALSE(list.is_bitmap());
+  EXPECT_EQ(list.decode(), ids);
+
+  list.add(5000001);
+  ids.push_back(5000001);
+  EXPECT_EQ(list.decode(), ids);
+  EXPECT_EQ(list.size(), ids.size());
+}
+
+TEST(PostingsTests, IdSetAddsBitmapAndDeltaLists)
+{
+  LibraryTypes::Postings dense, sparse;
+  for (std::uint32_t id = 64; id < 4000; id += 2) {
+    dense.add(id);
+  }
+  for (std::uint32_t id = 1; id < 4000; id += 1000) {
+    sparse.add(id);
+  }
+  ASSERT_TRUE(dense.is_bitmap());
+  ASSERT_FALSE(sparse.is_bitmap());
+
+  LibraryTypes::IdSet set(4000);
+  set.add(dense);
+  set.add(sparse);
+  EXPECT_EQ(set.count(), dense.size() + sparse.size());
+  EXPECT_TRUE(set.contains(64));
+  EXPECT_TRUE(set.contains(3998));
+  EXPECT_TRUE(set.contains(3001));
+  EXPECT_FALSE(set.contains(65));
+  EXPECT_FALSE(set.contains(0));
+}
+
+TEST(PostingsTests, IdSetUnionAndIntersection)
+{
+  LibraryTypes::IdSet a(1000), b(700);
+  std::vector<std::uint32_t> in_a, in_b;
+  for (std::uint32_t id = 0; id < 1000; id += 3) {
+    a.add(id);
+    in_a.push_back(id);
+  }
+  for (std::uint32_t id = 0; id < 700; id += 5) {
+    b.add(id);
+    in_b.push_back(id);
+  }
+
+  std::vector<std::uint32_t> expected;
+  std::set_intersection(in_a.begin(), in_a.end(), in_b.begin(), in_b.end(), std::back_inserter(expected));
+
+  LibraryTypes::IdSet both = a;
+  both.intersect(b);
+  std::vector<std::uint32_t> got;
+  both.for_each([&got](std::uint32_t id) { got.push_back(id); });
+  EXPECT_EQ(got, expected);
+
+  expected.clear();
+  std::set_union(in_a.begin(), in_a.end(), in_b.begin(), in_b.end(), std::back_inserter(expected));
+
+  LibraryTypes::IdSet either = b;
+  either.unite(a);
+  EXPECT_EQ(either.count(), expected.size());
+  EXPECT_TRUE(either.contains(999));
+  EXPECT_FALSE(either.contains(1));
+}
+
+TEST(PostingsTests, SearchBothIntersectsTitleAndAuthor)
+{
+  LibraryTypes::Library lib;
+  lib.load(R"([
+    {"title":"Dune","author":"Frank Herbert","isbn":"978-0-441-17271-9"},
+    {"title":"Dune Messiah","author":"Frank Herbert","isbn":"978-0-399-12877-6"},
+    {"title":"Dune Road","author":"Someone Else","isbn":"978-0-00-000000-2"},
+    {"title":"Whipping Star","author":"Frank Herbert","isbn":"978-0-00-000001-9"}
+  ])");
+
+  std::vector<LibraryTypes::Book> res = lib.search_both("dune", "herbert");
+  ASSERT_EQ(res.size(), 2u);
+  EXPECT_EQ(res[0].title, "Dune");
+  EXPECT_EQ(res[1].title, "Dune Messiah");
+
+  EXPECT_TRUE(lib.search_both("dune", "nobody").empty());
+  EXPECT_EQ(lib.search_both("i", "herbert", 0).size(), 2u);
+}
+
+TEST(ReadSnapshotTests, ViewStaysConsistentWhileLibraryChanges)
+{
+  UI::TEST_MODE = true;
+  LibraryTypes::Library lib;
+  lib.seed_isbns(21);
+  std::vector<LibraryTypes::Book> books;
+  for (const LibraryTypes::ISBN& isbn : lib.new_isbns(3000)) {
+    books.emplace_back("Title " + isbn.code, "Author", isbn);
+  }
+  lib.import(books);
+
+  LibraryTypes::BookSnapshot before = lib.snapshot();
+
+  // Export on another thread while borrows & returns carry on
+  std::string exported;
+  std::thread reader([&before, &exported]() { exported = before.save_as_json(); });
+  for (int i = 0; i < 50; i++) {
+    lib.take({ books[static_cast<size_t>(i)].isbn });
+  }
+  lib.add(LibraryTypes::Book("New", "Author", lib.new_isbn()));
+  reader.join();
+
+  EXPECT_EQ(before.size(), 3000u);
+  EXPECT_EQ(before[0], books[0]);
+  EXPECT_EQ(nlohmann::json::parse(exported).size(), 3000u);
+
+  LibraryTypes::BookSnapshot after = lib.snapshot();
+  EXPECT_EQ(after.size(), 2951u);
+  EXPECT_EQ(after[0], books[50]);
+  EXPECT_EQ(after[2950].title, "New");
+  EXPECT_GT(after.version(), before.version());
+}
+
+TEST(ReadSnapshotTests, UnchangedSegmentsAreShared)
+{
+  UI::TEST_MODE = true;
+  LibraryTypes::Library lib;
+  lib.seed_isbns(22);
+  std::vector<LibraryTypes::Book> books;
+  for (const LibraryTypes::ISBN& isbn : lib.new_isbns(3000)) {
+    books.emplace_back("Title", "Author", isbn);
+  }
+  lib.import(books);
+
+  LibraryTypes::BookSnapshot first = lib.snapshot();
+  LibraryTypes::BookSnapshot second = lib.snapshot();
+  ASSERT_EQ(first.parts().size(), 3u);
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(first.parts()[i].get(), second.parts()[i].get());
+  }
+
+  // An append only copies the tail segment
+  lib.add(LibraryTypes::Book("Tail", "Author", lib.new_isbn()));
+  LibraryTypes::BookSnapshot third = lib.snapshot();
+  EXPECT_EQ(third.parts()[0].get(), first.parts()[0].get());
+  EXPECT_EQ(third.parts()[1].get(), first.parts()[1].get());
+  EXPECT_NE(third.parts()[2].get(), first.parts()[2].get());
+
+  // A removal shifts everything after it
+  lib.remove(books[1500]);
+  LibraryTypes::BookSnapshot fourth = lib.snapshot();
+  EXPECT_EQ(fourth.parts()[0].get(), first.parts()[0].get());
+  EXPECT_NE(fourth.parts()[1].get(), first.parts()[1].get());
+}
+
+TEST(ReadSnapshotTests, ClosingFreesSegments)
+{
+  UI::TEST_MODE = true;
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("Dune", "Frank Herbert", "978-0-441-17271-9"));
+
+  LibraryTypes::BookSnapshot view = lib.snapshot();
+  std::weak_ptr<const LibraryTypes::BookSnapshot::Segment> segment = view.parts()[0];
+  LibraryTypes::BookSnapshot copy = view;
+
+  view.close();
+  EXPECT_FALSE(segment.expired());
+  EXPECT_TRUE(view.empty());
+
+  copy.close();
+  EXPECT_TRUE(segment.expired());
+
+  // The next snapshot simply rebuilds the segment
+  EXPECT_EQ(lib.snapshot()[0].title, "Dune");
+}
+
 TEST(LibraryTests, SaveBooks)
 {
   LibraryTypes::Library lib;
@@ -238,6 +555,26 @@ TEST(LibraryTests, SearchByAuthor)
   EXPECT_EQ(result[0].author, "Example Author");
 }
 
+TEST(LibraryTests, SearchIgnoresAccents)
+{
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("\xC3\x89mile", "Jean-Jacques Rousseau", "978-3-16-148410-0"));
+  lib.add(LibraryTypes::Book("Emil und die Detektive", "Erich K\xC3\xA4stner", "978-0-306-40615-7"));
+
+  auto result = lib.search("emile", LibraryTypes::SEARCH::TITLE);
+  ASSERT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0].title, "\xC3\x89mile");
+  EXPECT_EQ(lib.search("\xC3\x89MILE", LibraryTypes::SEARCH::TITLE).size(), 1);
+  EXPECT_EQ(lib.search("EMIL", LibraryTypes::SEARCH::TITLE).size(), 2);
+  EXPECT_EQ(lib.search("k\xC3\x84stner", LibraryTypes::SEARCH::AUTHOR).size(), 1);
+  EXPECT_EQ(lib.search_both("\xC3\xA9mil", "rousseau").size(), 1);
+
+  // The columns hold display text, so they only fold ASCII case
+  lib.columnar(true);
+  EXPECT_EQ(lib.search("EMIL", LibraryTypes::SEARCH::TITLE).size(), 1);
+  EXPECT_EQ(lib.search("kastner", LibraryTypes::SEARCH::AUTHOR).size(), 0);
+}
+
 TEST(LibraryTests, SearchByISBN)
 {
   LibraryTypes::Library lib;
@@ -273,9 +610,583 @@ TEST(LibraryTests, SearchEmptyResult)
   EXPECT_EQ(result.size(), 0);
 }
 
+TEST(LibraryTests, SearchRanksByRelevance)
+{
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("The Gatsby Years", "Author1", "978-3-16-148410-0"));
+  lib.add(LibraryTypes::Book("Gatsby", "Author2", "978-0-306-40615-7"));
+  lib.add(LibraryTypes::Book("Gatsby Returns", "Author3", "new"));
+
+  auto result = lib.search("gatsby", LibraryTypes::SEARCH::TITLE);
+  EXPECT_EQ(result.size(), 3);
+  EXPECT_EQ(result[0].title, "Gatsby");
+  EXPECT_EQ(result[1].title, "Gatsby Returns");
+  EXPECT_EQ(result[2].title, "The Gatsby Years");
+}
+
+TEST(LibraryTests, SearchRanksByPopularity)
+{
+  LibraryTypes::Library lib;
+  LibraryTypes::Book first("Title One", "Author", "978-3-16-148410-0");
+  LibraryTypes::Book second("Title Two", "Author", "978-0-306-40615-7");
+  lib.add(first);
+  lib.add(second);
+
+  lib.record_borrow(second);
+  lib.record_borrow(second);
+  lib.record_borrow(first);
+  EXPECT_EQ(lib.borrows(second), 2);
+
+  auto result = lib.search("title", LibraryTypes::SEARCH::TITLE);
+  EXPECT_EQ(result.size(), 2);
+  EXPECT_EQ(result[0].title, "Title Two");
+}
+
+TEST(LibraryTests, SearchKeepsTopK)
+{
+  LibraryTypes::Library lib;
+  for (int i = 0; i < 50; i++) {
+    lib.add(LibraryTypes::Book("Volume " + std::to_string(i), "Author", "new"));
+  }
+  lib.record_borrow(lib.books[42]);
+
+  auto result = lib.search("volume", LibraryTypes::SEARCH::TITLE);
+  EXPECT_EQ(result.size(), LibraryTypes::Library::SEARCH_LIMIT);
+  EXPECT_EQ(result[0].title, "Volume 42");
+  EXPECT_EQ(lib.search("volume", LibraryTypes::SEARCH::TITLE, 0).size(), 50);
+  EXPECT_EQ(lib.search("volume", LibraryTypes::SEARCH::TITLE, 5).size(), 5);
+}
+
+TEST(BrowseTests, ViewMatchesSortedOrder)
+{
+  LibraryTypes::SortedView view;
+  std::vector<std::pair<std::string, std::string>> expected;
+  for (int i = 0; i < 1000; i++) {
+    std::string key = "key " + std::to_string((i * 7919) % 1000);
+    std::string code = std::to_string(i);
+    view.insert(key, code);
+    expected.emplace_back(key, code);
+  }
+  for (int i = 0; i < 1000; i += 3) {
+    std::string key = "key " + std::to_string((i * 7919) % 1000);
+    EXPECT_TRUE(view.erase(key, std::to_string(i)));
+    expected.erase(std::find(expected.begin(), expected.end(), std::make_pair(key, std::to_string(i))));
+  }
+  EXPECT_FALSE(view.erase("missing", "0"));
+  std::sort(expected.begin(), expected.end());
+
+  ASSERT_EQ(view.size(), expected.size());
+  for (size_t first = 0; first < expected.size(); first += 97) {
+    auto page = view.range(first, 20);
+    for (size_t i = 0; i < page.size(); i++) {
+      EXPECT_EQ(page[i], expected[first + i].second);
+    }
+  }
+  EXPECT_TRUE(view.range(expected.size(), 20).empty());
+}
+
+TEST(BrowseTests, LibraryPagesFollowAddAndRemove)
+{
+  LibraryTypes::Library lib;
+  LibraryTypes::Book c("Cherry", "Adams", "new");
+  LibraryTypes::Book a("apple", "Young", "new");
+  LibraryTypes::Book b("Banana", "Adams", "new");
+  lib.add(c);
+  lib.add(a);
+  lib.add(b);
+
+  auto titles = lib.browse(LibraryTypes::SEARCH::TITLE, 0);
+  ASSERT_EQ(titles.size(), 3);
+  EXPECT_EQ(titles[0].title, "apple");
+  EXPECT_EQ(titles[1].title, "Banana");
+  EXPECT_EQ(titles[2].title, "Cherry");
+
+  auto authors = lib.browse(LibraryTypes::SEARCH::AUTHOR, 0);
+  ASSERT_EQ(authors.size(), 3);
+  EXPECT_EQ(authors[0].title, "Banana");
+  EXPECT_EQ(authors[1].title, "Cherry");
+  EXPECT_EQ(authors[2].title, "apple");
+
+  lib.remove(b);
+  EXPECT_EQ(lib.browse(LibraryTypes::SEARCH::TITLE, 0, 1)[0].title, "apple");
+  EXPECT_EQ(lib.browse(LibraryTypes::SEARCH::TITLE, 1, 1)[0].title, "Cherry");
+  EXPECT_TRUE(lib.browse(LibraryTypes::SEARCH::TITLE, 2, 1).empty());
+  EXPECT_EQ(lib.pages(1), 2);
+}
+
+TEST(BrowseTests, LoadBuildsViews)
+{
+  LibraryTypes::Library lib;
+  lib.load(R"([{"title":"Zeta","author":"A","isbn":"978-3-16-148410-0"},{"title":"Alpha","author":"B","isbn":"978-0-306-40615-7"}])");
+
+  auto titles = lib.browse(LibraryTypes::SEARCH::TITLE, 0);
+  ASSERT_EQ(titles.size(), 2);
+  EXPECT_EQ(titles[0].title, "Alpha");
+  EXPECT_EQ(titles[1].title, "Zeta");
+}
+
+TEST(CacheTests, RepeatedSearchHitsCache)
+{
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("Dune", "Frank Herbert", "new"));
+
+  EXPECT_EQ(lib.search("dune", LibraryTypes::SEARCH::TITLE).size(), 1);
+  EXPECT_EQ(lib.search("DUNE", LibraryTypes::SEARCH::TITLE).size(), 1);
+  EXPECT_EQ(lib.cache_stats().misses, 1);
+  EXPECT_EQ(lib.cache_stats().hits, 1);
+}
+
+TEST(CacheTests, MutationsInvalidate)
+{
+  LibraryTypes::Library lib;
+  LibraryTypes::Book first("Dune", "Frank Herbert", "new");
+  LibraryTypes::Book second("Dune Messiah", "Frank Herbert", "new");
+  lib.add(first);
+  EXPECT_EQ(lib.search("dune", LibraryTypes::SEARCH::TITLE).size(), 1);
+
+  lib.add(second);
+  auto result = lib.search("dune", LibraryTypes::SEARCH::TITLE);
+  ASSERT_EQ(result.size(), 2);
+
+  lib.record_borrow(second);
+  result = lib.search("dune", LibraryTypes::SEARCH::TITLE);
+  EXPECT_EQ(result[0].title, "Dune");
+
+  lib.remove(first);
+  result = lib.search("dune", LibraryTypes::SEARCH::TITLE);
+  ASSERT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0].title, "Dune Messiah");
+  EXPECT_EQ(lib.cache_stats().hits, 0);
+  EXPECT_EQ(lib.cache_stats().stale, 3);
+}
+
+TEST(CacheTests, EvictsLeastRecentlyUsed)
+{
+  LibraryTypes::QueryCache cache(2);
+  cache.store("a", 0, {});
+  cache.store("b", 0, {});
+  EXPECT_NE(cache.find("a", 0), nullptr);
+  cache.store("c", 0, {});
+
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.find("b", 0), nullptr);
+  EXPECT_NE(cache.find("a", 0), nullptr);
+  EXPECT_NE(cache.find("c", 0), nullptr);
+  EXPECT_EQ(cache.find("c", 1), nullptr);
+  EXPECT_EQ(cache.stats().evictions, 1);
+}
+
+TEST(BloomTests, NoFalseNegativesAndBoundedRate)
+{
+  LibraryTypes::BloomFilter filter(0.01, 10000);
+  for (std::uint64_t key = 0; key < 10000; key++) {
+    filter.insert(key * 2654435761ULL);
+  }
+  for (std::uint64_t key = 0; key < 10000; key++) {
+    EXPECT_TRUE(filter.may_contain(key * 2654435761ULL));
+  }
+
+  size_t false_positives = 0;
+  for (std::uint64_t key = 0; key < 100000; key++) {
+    false_positives += filter.may_contain(key * 2654435761ULL + 1) ? 1 : 0;
+  }
+  EXPECT_LT(false_positives, 2000);
+}
+
+TEST(BloomTests, ImportSkipsDuplicates)
+{
+  LibraryTypes::Library lib;
+  LibraryTypes::Book existing("Example Title", "Example Author", "978-3-16-148410-0");
+  lib.add(existing);
+
+  std::vector<LibraryTypes::Book> incoming = { existing, LibraryTypes::Book("Other", "Someone", "978-0-306-40615-7") };
+  for (int i = 0; i < 300; i++) {
+    incoming.emplace_back("Generated " + std::to_string(i), "Author", "new");
+  }
+  incoming.push_back(incoming.back());
+
+  EXPECT_EQ(lib.import(incoming), 301);
+  EXPECT_EQ(lib.size(), 302);
+  EXPECT_TRUE(lib.contains(LibraryTypes::ISBN("978-0-306-40615-7")));
+  for (const LibraryTypes::Book& book : incoming) {
+    EXPECT_TRUE(lib.contains(book.isbn));
+  }
+
+  lib.remove(existing);
+  EXPECT_FALSE(lib.contains(existing.isbn));
+}
+
+// Replica Tests
+TEST(ReplicaTests, PublishAndSearch)
+{
+  UI::TEST_MODE = true;
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "library_replica_search.img";
+  std::filesystem::remove(path);
+
+  LibraryTypes::Library writer;
+  writer.add(LibraryTypes::Book("The Great Gatsby", "F. Scott Fitzgerald", "978-3-16-148410-0"));
+  writer.add(LibraryTypes::Book("Great Expectations", "Charles Dickens", "978-0-14-143956-3"));
+  writer.record_borrow(writer.books[1]);
+  EXPECT_EQ(writer.publish(path), 1);
+
+  LibraryTypes::Library reader;
+  ASSERT_TRUE(reader.open_replica(path));
+  EXPECT_EQ(reader.replica().size(), 2);
+  EXPECT_EQ(reader.size(), 0);
+
+  // Popularity is carried in the image
+  auto res = reader.search("great", LibraryTypes::SEARCH::TITLE);
+  ASSERT_EQ(res.size(), 2);
+  EXPECT_EQ(res[0].title, "Great Expectations");
+  EXPECT_EQ(res[1].title, "The Great Gatsby");
+
+  res = reader.search("978-3-16-148410-0", LibraryTypes::SEARCH::CODE);
+  ASSERT_EQ(res.size(), 1);
+  EXPECT_EQ(res[0].author, "F. Scott Fitzgerald");
+  EXPECT_TRUE(reader.search("dickens", LibraryTypes::SEARCH::AUTHOR).size() == 1);
+
+  reader.close_replica();
+  std::filesystem::remove(path);
+}
+
+TEST(ReplicaTests, RefreshPicksUpNewGeneration)
+{
+  UI::TEST_MODE = true;
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "library_replica_refresh.img";
+  std::filesystem::remove(path);
+
+  LibraryTypes::Library writer;
+  writer.add(LibraryTypes::Book("Title1", "Author1", "978-3-16-148410-0"));
+  EXPECT_EQ(writer.publish(path), 1);
+
+  LibraryTypes::Library reader;
+  ASSERT_TRUE(reader.open_replica(path));
+  EXPECT_FALSE(reader.refresh_replica());
+
+  writer.add(LibraryTypes::Book("Title2", "Author2", "978-0-14-143956-3"));
+  EXPECT_EQ(writer.publish(path), 2);
+
+  // The old generation is served until the reader refreshes
+  EXPECT_EQ(reader.search("title", LibraryTypes::SEARCH::TITLE).size(), 1);
+  EXPECT_TRUE(reader.refresh_replica());
+  EXPECT_EQ(reader.replica().generation(), 2);
+  EXPECT_EQ(reader.search("title", LibraryTypes::SEARCH::TITLE).size(), 2);
+
+  std::filesystem::remove(path);
+}
+
+TEST(ReplicaTests, RejectsMalformedImage)
+{
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "library_replica_bad.img";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "[{\"title\":\"not an image\"}]";
+  }
+
+  LibraryTypes::Library reader;
+  EXPECT_FALSE(reader.open_replica(path));
+  EXPECT_FALSE(reader.replica().is_open());
+
+  std::filesystem::remove(path);
+}
+
+TEST(ReplicaTests, RejectsSectionSizesThatWrap)
+{
+  UI::TEST_MODE = true;
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "library_replica_wrap.img";
+  std::filesystem::remove(path);
+
+  LibraryTypes::Library writer;
+  writer.add(LibraryTypes::Book("The Great Gatsby", "F. Scott Fitzgerald", "978-3-16-148410-0"));
+  EXPECT_EQ(writer.publish(path), 1);
+
+  // Claim more rows than fit, with a text size that wraps the total back to the file size
+  std::uint64_t length = std::filesystem::file_size(path);
+  std::uint64_t rows = length / 8;
+  std::uint64_t start = (40 + rows * 44 + 7) & ~std::uint64_t(7);
+  std::uint64_t text = length - start;
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(24);
+    file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    file.write(reinterpret_cast<const char*>(&text), sizeof(text));
+  }
+
+  LibraryTypes::Library reader;
+  EXPECT_FALSE(reader.open_replica(path));
+  EXPECT_FALSE(reader.replica().is_open());
+
+  std::filesystem::remove(path);
+}
+
+// Snapshot Tests
+TEST(SnapshotTests, Crc32cKnownVector)
+{
+  const std::string check = "123456789";
+  EXPECT_EQ(LibraryTypes::Crc32c::compute(check.data(), check.size()), 0xE3069283U);
+
+  std::string text(1000, 'x');
+  for (size_t i = 0; i < text.size(); i++) {
+    text[i] = static_cast<char>(i * 31);
+  }
+  const auto* bytes = reinterpret_cast<const std::uint8_t*>(text.data());
+  EXPECT_EQ(LibraryTypes::Crc32c::compute(text.data(), text.size()), ~LibraryTypes::Crc32c::update_scalar(~0U, bytes, text.size()));
+}
+
+TEST(SnapshotTests, RoundTripAndRejectsDamage)
+{
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "library_snapshot.json";
+
+  std::string payload;
+  for (int i = 0; payload.size() < 40 * LibraryTypes::Snapshot::BLOCK; i++) {
+    payload += "{\"title\":\"Book " + std::to_string(i) + "\"},";
+  }
+
+  ASSERT_TRUE(LibraryTypes::Snapshot::write(path, payload));
+  EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+  EXPECT_EQ(LibraryTypes::Snapshot::read(path), payload);
+
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(std::filesystem::file_size(path) - 100));
+    file.put('#');
+  }
+  EXPECT_FALSE(LibraryTypes::Snapshot::read(path).has_value());
+
+  std::filesystem::remove(path);
+  EXPECT_FALSE(LibraryTypes::Snapshot::read(path).has_value());
+}
+
+TEST(SnapshotTests, ReadsLegacyPlainFile)
+{
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "library_snapshot_legacy.json";
+  {
+    std::ofstream out(path);
+    out << "[]" << std::endl;
+  }
+
+  EXPECT_EQ(LibraryTypes::Snapshot::read(path), "[]\n");
+  std::filesystem::remove(path);
+}
+
+// Hold Tests
+
+TEST(HoldTests, ServesInOrder)
+{
+  LibraryTypes::HoldQueues holds;
+  EXPECT_TRUE(holds.hold(1, "A"));
+  EXPECT_TRUE(holds.hold(1, "B"));
+  EXPECT_TRUE(holds.hold(2, "A"));
+  EXPECT_FALSE(holds.hold(1, "A"));
+  EXPECT_EQ(holds.waiting(1), 2);
+
+  EXPECT_EQ(holds.next(1).value(), "A");
+  EXPECT_EQ(holds.next(1).value(), "B");
+  EXPECT_FALSE(holds.next(1).has_value());
+  EXPECT_EQ(holds.waiting(2), 1);
+}
+
+TEST(HoldTests, CancelAndReuseNodes)
+{
+  LibraryTypes::HoldQueues holds;
+  holds.hold(1, "A");
+  holds.hold(1, "B");
+  holds.hold(1, "C");
+
+  EXPECT_TRUE(holds.cancel(1, "C"));
+  EXPECT_FALSE(holds.cancel(1, "C"));
+  holds.hold(1, "D");
+  EXPECT_TRUE(holds.cancel(1, "A"));
+
+  std::vector<std::string> expected = { "B", "D" };
+  EXPECT_EQ(holds.queue(1), expected);
+
+  LibraryTypes::HoldQueues copy;
+  copy.from_json(holds.to_json());
+  EXPECT_EQ(copy.queue(1), expected);
+}
+
+// Text Tests
+
+TEST(TextTests, IFindMatchesIgnoringCase)
+{
+  EXPECT_EQ(Text::ifind("The Great Gatsby", "great"), 4);
+  EXPECT_EQ(Text::ifind("the great gatsby", "GATSBY"), 10);
+  EXPECT_EQ(Text::ifind("Title", ""), 0);
+  EXPECT_EQ(Text::ifind("Title", "Titles"), std::string_view::npos);
+  EXPECT_EQ(Text::ifind("Title", "x"), std::string_view::npos);
+}
+
+TEST(TextTests, IFindAgreesWithScalar)
+{
+  // Long keys force the vector loops and their scalar tails.
+  std::string key;
+  for (int i = 0; i < 300; i++) {
+    key += static_cast<char>("abcXYZ [@`{"[i % 11]);
+  }
+  key += "Needle-In-Haystack";
+
+  for (std::string term : { "needle-in-haystack", "NEEDLE", "k", "zA", "[@`{", "haystackk", "@" }) {
+    EXPECT_EQ(Text::ifind(key, term), Text::ifind_scalar(key, term)) << term;
+  }
+}
+
+TEST(TextTests, NormalizeFoldsCaseAndAccents)
+{
+  EXPECT_EQ(Text::normalize("\xC3\x89mile Zola"), "emile zola");
+  EXPECT_EQ(Text::normalize("\xC3\x85ngstr\xC3\xB6m"), "angstrom");
+  EXPECT_EQ(Text::normalize("Stra\xC3\x9F" "e \xC3\x86sop \xC5\x92uvre"), "strasse aesop oeuvre");
+  EXPECT_EQ(Text::normalize("\xC5\x81\xC3\xB3" "d\xC5\xBA"), "lodz");
+  // Combining acute accent after a plain e
+  EXPECT_EQ(Text::normalize("Cafe\xCC\x81"), "cafe");
+  // Greek & Cyrillic capitals
+  EXPECT_EQ(Text::normalize("\xCE\x9F\xCE\xB4\xCF\x8D\xCF\x83\xCF\x83\xCE\xB5\xCE\xB9\xCE\xB1"), "\xCE\xBF\xCE\xB4\xCF\x8D\xCF\x83\xCF\x83\xCE\xB5\xCE\xB9\xCE\xB1");
+  EXPECT_EQ(Text::normalize("\xD0\x92\xD0\xBE\xD0\xB9\xD0\xBD\xD0\xB0"), "\xD0\xB2\xD0\xBE\xD0\xB9\xD0\xBD\xD0\xB0");
+  // Other characters & malformed bytes are kept
+  EXPECT_EQ(Text::normalize("A \xE2\x80\x94 \xC3 B\xFF"), "a \xE2\x80\x94 \xC3 b\xFF");
+  EXPECT_EQ(Text::normalize("2\xC3\x97" "3"), "2\xC3\x97" "3");
+
+  // Every code point of U+00C0..U+017F, by runs sharing a base letter
+  struct Run { unsigned first, last; const char* key; };
+  const Run runs[] = {
+    { 0xC0, 0xC5, "a" }, { 0xC6, 0xC6, "ae" }, { 0xC7, 0xC7, "c" }, { 0xC8, 0xCB, "e" },
+    { 0xCC, 0xCF, "i" }, { 0xD0, 0xD0, "d" }, { 0xD1, 0xD1, "n" }, { 0xD2, 0xD6, "o" },
+    { 0xD7, 0xD7, "\xC3\x97" }, { 0xD8, 0xD8, "o" }, { 0xD9, 0xDC, "u" }, { 0xDD, 0xDD, "y" },
+    { 0xDE, 0xDE, "th" }, { 0xDF, 0xDF, "ss" }, { 0xE0, 0xE5, "a" }, { 0xE6, 0xE6, "ae" },
+    { 0xE7, 0xE7, "c" }, { 0xE8, 0xEB, "e" }, { 0xEC, 0xEF, "i" }, { 0xF0, 0xF0, "d" },
+    { 0xF1, 0xF1, "n" }, { 0xF2, 0xF6, "o" }, { 0xF7, 0xF7, "\xC3\xB7" }, { 0xF8, 0xF8, "o" },
+    { 0xF9, 0xFC, "u" }, { 0xFD, 0xFD, "y" }, { 0xFE, 0xFE, "th" }, { 0xFF, 0xFF, "y" },
+    { 0x100, 0x105, "a" }, { 0x106, 0x10D, "c" }, { 0x10E, 0x111, "d" }, { 0x112, 0x11B, "e" },
+    { 0x11C, 0x123, "g" }, { 0x124, 0x127, "h" }, { 0x128, 0x131, "i" }, { 0x132, 0x133, "ij" },
+    { 0x134, 0x135, "j" }, { 0x136, 0x138, "k" }, { 0x139, 0x142, "l" }, { 0x143, 0x14B, "n" },
+    { 0x14C, 0x151, "o" }, { 0x152, 0x153, "oe" }, { 0x154, 0x159, "r" }, { 0x15A, 0x161, "s" },
+    { 0x162, 0x167, "t" }, { 0x168, 0x173, "u" }, { 0x174, 0x175, "w" }, { 0x176, 0x178, "y" },
+    { 0x179, 0x17E, "z" }, { 0x17F, 0x17F, "s" },
+  };
+
+  unsigned next = 0xC0;
+  for (const Run& run : runs) {
+    ASSERT_EQ(run.first, next);
+    for (unsigned cp = run.first; cp <= run.last; cp++) {
+      std::string text = { static_cast<char>(0xC0 | (cp >> 6)), static_cast<char>(0x80 | (cp & 0x3F)) };
+      EXPECT_EQ(Text::normalize(text), run.key) << std::hex << cp;
+    }
+    next = run.last + 1;
+  }
+  EXPECT_EQ(next, 0x180u);
+
+  EXPECT_EQ(Text::normalize("\xC5\xB9r\xC3\xB3" "d\xC5\x82o"), "zrodlo");
+  EXPECT_EQ(Text::normalize("\xC5\xBF" "tra\xC3\x9F" "e"), "strasse");
+}
+
+TEST(TextTests, NormalizeAgreesAcrossBlocks)
+{
+  // Long ASCII runs go through the vector kernel, accents through the scalar path.
+  std::string text, expected;
+  for (int i = 0; i < 200; i++) {
+    text += i % 37 == 0 ? "\xC3\x89" : std::string(1, "abcXYZ [@`{"[i % 11]);
+    expected += i % 37 == 0 ? "e" : std::string(1, static_cast<char>(Text::fold(static_cast<unsigned char>("abcXYZ [@`{"[i % 11]))));
+  }
+  EXPECT_EQ(Text::normalize(text), expected);
+
+  // A reused buffer keeps its capacity
+  std::string buffer;
+  Text::normalize(text, buffer);
+  const char* data = buffer.data();
+  EXPECT_EQ(Text::normalize("\xC3\x89MILE", buffer), "emile");
+  EXPECT_EQ(buffer.data(), data);
+}
+
+// Columnar Catalog Tests
+
+TEST(ColumnarTests, AppendAndRead)
+{
+  LibraryTypes::ColumnarCatalog columns;
+  columns.append("Title1", "Author1", 9783161484100ULL);
+  columns.append("Title2", "Author2", 9780306406157ULL, false);
+
+  EXPECT_EQ(columns.size(), 2);
+  EXPECT_EQ(columns.title(1), "Title2");
+  EXPECT_EQ(columns.author(0), "Author1");
+  EXPECT_EQ(columns.isbn(0), 9783161484100ULL);
+  EXPECT_EQ(columns.count_available(), 1);
+  EXPECT_EQ(columns.find_isbn(9780306406157ULL), 1);
+  EXPECT_EQ(columns.find_isbn(1), 2);
+}
+
+TEST(ColumnarTests, LibraryMaintainsColumns)
+{
+  LibraryTypes::Library lib;
+  lib.columnar(true);
+  lib.add(LibraryTypes::Book("Example Title", "Example Author", "978-3-16-148410-0"));
+  lib.add(LibraryTypes::Book("Other Title", "Example Author", "978-0-306-40615-7"));
+
+  EXPECT_EQ(lib.catalog().size(), 2);
+  EXPECT_EQ(lib.catalog().isbn(1), LibraryTypes::ISBN("978-0-306-40615-7").packed());
+  EXPECT_EQ(lib.catalog().author_counts().at("Example Author"), 2);
+
+  EXPECT_TRUE(lib.remove(lib.books[0]));
+  EXPECT_EQ(lib.catalog().size(), 1);
+  EXPECT_EQ(lib.catalog().title(0), "Other Title");
+}
+
+TEST(ColumnarTests, ColumnarSearch)
+{
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("Example Title", "Example Author", "978-3-16-148410-0"));
+  lib.columnar(true);
+
+  auto result = lib.search("TITLE", LibraryTypes::SEARCH::TITLE);
+  EXPECT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0].title, "Example Title");
+  EXPECT_EQ(lib.search("nobody", LibraryTypes::SEARCH::AUTHOR).size(), 0);
+}
+
 #include "../include/hash_sha256.h"
 #include "../include/User.h"
 
+// Hash Tests
+std::string Sha256Hex(const std::string& msg, size_t chunk = 0)
+{
+  hash_sha256 hash;
+  hash.sha256_init();
+
+  const auto* bytes = reinterpret_cast<const std::uint8_t*>(msg.data());
+  size_t step = chunk == 0 ? msg.size() : chunk;
+  for (size_t i = 0; i < msg.size(); i += step) {
+    hash.sha256_update(bytes + i, std::min(step, msg.size() - i));
+  }
+
+  std::ostringstream oss;
+  for (auto b : hash.sha256_final()) {
+    oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(b);
+  }
+  return oss.str();
+}
+
+TEST(HashTests, KnownVectors)
+{
+  EXPECT_EQ(Sha256Hex(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  EXPECT_EQ(Sha256Hex("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  EXPECT_EQ(Sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  EXPECT_EQ(Sha256Hex(std::string(1000000, 'a')),
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(HashTests, ChunkedUpdates)
+{
+  std::string msg;
+  for (size_t i = 0; i < 1000; i++) {
+    msg += static_cast<char>(i * 7);
+  }
+
+  std::string whole = Sha256Hex(msg);
+  for (size_t chunk : { 1, 3, 63, 64, 65, 127, 200 }) {
+    EXPECT_EQ(Sha256Hex(msg, chunk), whole) << "chunk " << chunk;
+  }
+}
+
 // User Tests
 TEST(UserTests, DefaultConstructor)
 {
@@ -286,7 +1197,7 @@ TEST(UserTests, DefaultConstructor)
   User user;
   EXPECT_EQ(user.name, "");
   EXPECT_EQ(user.password, empty_hash);
-  EXPECT_EQ(user.books.size(), 0);
+  EXPECT_EQ(user.loans.size(), 0);
 }
 
 sha256_type UserPasswordHash(const std::string& password)
@@ -314,7 +1225,7 @@ TEST(UserTests, ConstructorWithNameAndPassword)
 
   EXPECT_EQ(user.name, name);
   EXPECT_EQ(user.password, password);
-  EXPECT_EQ(user.books.size(), 0);
+  EXPECT_EQ(user.loans.size(), 0);
   EXPECT_EQ(user.password.size(), 32);
   EXPECT_FALSE(user.isNULL());
 }
@@ -332,9 +1243,9 @@ TEST(UserTests, ConstructorWithNameAndPasswordAndBooks)
   User user = User(name, password, books);
   EXPECT_EQ(user.name, name);
   EXPECT_EQ(user.password, password);
-  EXPECT_EQ(user.books.size(), 2);
-  EXPECT_EQ(user.books[0].title, "Title1");
-  EXPECT_EQ(user.books[1].title, "Title2");
+  EXPECT_EQ(user.loans.size(), 2);
+  EXPECT_EQ(user.loans[0].book, books[0].isbn.packed());
+  EXPECT_EQ(user.loans[1].book, books[1].isbn.packed());
   EXPECT_EQ(user.password.size(), 32);
   EXPECT_FALSE(user.isNULL());
 }
@@ -360,7 +1271,7 @@ TEST(UserTests, ToJsonString)
   User user = ExampleUser("Example User", "pass");
   nlohmann::json j = user;
 
-  std::string expected = R"({"books":[],"name":"Example User","password":[156,67,169,96,230,45,62,132,110,0,41,190,46,123,34,112,67,249,22,173,198,141,17,83,69,17,9,34,58,204,63,195]})";
+  std::string expected = R"({"loans":[],"name":"Example User","password":[156,67,169,96,230,45,62,132,110,0,41,190,46,123,34,112,67,249,22,173,198,141,17,83,69,17,9,34,58,204,63,195]})";
   EXPECT_EQ(j.dump(), expected);
 }
 
@@ -372,7 +1283,7 @@ TEST(UserTests, UserVectorToJsonString)
 
   nlohmann::json j = users;
 
-  std::string expected = R"([{"books":[],"name":"Example User","password":[156,67,169,96,230,45,62,132,110,0,41,190,46,123,34,112,67,249,22,173,198,141,17,83,69,17,9,34,58,204,63,195]}])";
+  std::string expected = R"([{"loans":[],"name":"Example User","password":[156,67,169,96,230,45,62,132,110,0,41,190,46,123,34,112,67,249,22,173,198,141,17,83,69,17,9,34,58,204,63,195]}])";
 
   EXPECT_EQ(j.dump(), expected);
 }
@@ -387,7 +1298,7 @@ TEST(UserTests, FromJsonString)
   User user = j.get<User>();
   EXPECT_EQ(user.name, "Example User");
   EXPECT_EQ(user.password.size(), 32);
-  EXPECT_EQ(user.books.size(), 0);
+  EXPECT_EQ(user.loans.size(), 0);
   EXPECT_FALSE(user.isNULL());
 }
 
@@ -402,7 +1313,7 @@ TEST(UserTests, UserVectorFromJsonString)
   EXPECT_EQ(users.size(), 1);
   EXPECT_EQ(users[0].name, "Example User");
   EXPECT_EQ(users[0].password.size(), 32);
-  EXPECT_EQ(users[0].books.size(), 0);
+  EXPECT_EQ(users[0].loans.size(), 0);
   EXPECT_FALSE(users[0].isNULL());
 }
 
@@ -457,9 +1368,12 @@ TEST(UMTests, SigninUser)
 
   um.signin();
 
+  // Legacy hashes are upgraded at sign in
   EXPECT_EQ(um.current_user.name, "User");
-  EXPECT_EQ(um.current_user.password, user.password);
-  EXPECT_EQ(um.current_user.books.size(), 0);
+  EXPECT_EQ(um.current_user.iterations, um.get_iterations());
+  EXPECT_TRUE(UserManager::verify(um.current_user, "pass"));
+  EXPECT_EQ(um.at(0).password, um.current_user.password);
+  EXPECT_EQ(um.current_user.loans.size(), 0);
 
   std::cin.rdbuf(origCin);
   std::cout.rdbuf(origCout);
@@ -482,7 +1396,10 @@ TEST(UMTests, SignupUser)
   EXPECT_EQ(um.size(), 1);
   EXPECT_EQ(um.at(0).name, "User");
   EXPECT_EQ(um.at(0).password.size(), 32);
-  EXPECT_EQ(um.at(0).books.size(), 0);
+  EXPECT_EQ(um.at(0).iterations, Password::ITERATIONS);
+  EXPECT_TRUE(UserManager::verify(um.at(0), "pass"));
+  EXPECT_FALSE(UserManager::verify(um.at(0), "Pass"));
+  EXPECT_EQ(um.at(0).loans.size(), 0);
 
   std::cin.rdbuf(origCin);
   std::cout.rdbuf(origCout);
@@ -509,8 +1426,8 @@ TEST(UMTests, LoginToSignin)
   um.login();
 
   EXPECT_EQ(um.current_user.name, "User");
-  EXPECT_EQ(um.current_user.password, user.password);
-  EXPECT_EQ(um.current_user.books.size(), 0);
+  EXPECT_TRUE(UserManager::verify(um.current_user, "pass"));
+  EXPECT_EQ(um.current_user.loans.size(), 0);
 
   std::cin.rdbuf(origCin);
   std::cout.rdbuf(origCout);
@@ -535,7 +1452,7 @@ TEST(UMTests, LoginToSignup)
   EXPECT_EQ(um.size(), 1);
   EXPECT_EQ(um.at(0).name, "User");
   EXPECT_EQ(um.at(0).password.size(), 32);
-  EXPECT_EQ(um.at(0).books.size(), 0);
+  EXPECT_EQ(um.at(0).loans.size(), 0);
   EXPECT_EQ(um.current_user.name, "User");
 
   std::cin.rdbuf(origCin);
@@ -556,8 +1473,8 @@ TEST(UMTests, CurrentUserAddBook)
   um.current_user = user;
   um.add(book);
 
-  EXPECT_EQ(um.current_user.books.size(), 1);
-  EXPECT_EQ(um.current_user.books[0].title, "Title1");
+  EXPECT_EQ(um.current_user.loans.size(), 1);
+  EXPECT_EQ(um.book(um.current_user.loans[0]).title, "Title1");
 }
 
 TEST(UMTests, CurrentUserRemoveBook)
@@ -574,84 +1491,591 @@ TEST(UMTests, CurrentUserRemoveBook)
   um.current_user = user;
   um.add(book);
 
-  EXPECT_EQ(um.current_user.books.size(), 1);
-  EXPECT_EQ(um.current_user.books[0].title, "Title1");
+  EXPECT_EQ(um.current_user.loans.size(), 1);
+  EXPECT_EQ(um.book(um.current_user.loans[0]).title, "Title1");
 
   um.remove(0);
-  EXPECT_EQ(um.current_user.books.size(), 0);
+  EXPECT_EQ(um.current_user.loans.size(), 0);
+  EXPECT_EQ(um.at(0).loans.size(), 0);
 }
 
-#include "../include/App.h"
-
-// LibraryApp Tests
-TEST(LibraryAppTests, AppLoginToSignup)
+TEST(UMTests, BorrowerIndex)
 {
-  LibraryApp app;
   UI::TEST_MODE = true;
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  um.add(ExampleUser("B", "pass"));
 
-  std::istringstream input("2\nUser\npass\n3\n");
-  std::streambuf* origCin = std::cin.rdbuf();
-  std::cin.rdbuf(input.rdbuf());
+  LibraryTypes::Book book("Title1", "Author1", "978-3-16-148410-0");
+  EXPECT_TRUE(um.borrowers_of(book).empty());
 
-  std::ostringstream out;
-  std::streambuf* origCout = std::cout.rdbuf();
-  std::cout.rdbuf(out.rdbuf());
+  um.current_user = um.at(0);
+  um.add(book);
+  EXPECT_TRUE(um.lend("B", book));
+  EXPECT_EQ(um.borrowers_of(book), std::vector<std::string>({ "A", "B" }));
 
-  app.start();
+  um.remove(0);
+  EXPECT_EQ(um.borrowers_of(book), std::vector<std::string>({ "B" }));
 
-  EXPECT_EQ(app.size(true), 1);
+  // Removing a user re-indexes the remaining borrowers
+  um.remove(um.at(0));
+  EXPECT_EQ(um.borrowers_of(book), std::vector<std::string>({ "B" }));
+  EXPECT_EQ(um.book(um.at(0).loans[0]).title, "Title1");
+}
 
-  std::cin.rdbuf(origCin);
-  std::cout.rdbuf(origCout);
+TEST(UMTests, AddKeepsRecordsOfLoans)
+{
+  UI::TEST_MODE = true;
+  UserManager um;
+  LibraryTypes::Book book("Title1", "Author1", "978-3-16-148410-0");
+  um.add(User("A", sha256_type{}, { book }));
+  EXPECT_TRUE(um.at(0).pending.empty());
+
+  std::optional<LibraryTypes::Book> returned;
+  ASSERT_NO_THROW(returned = um.check_in("A", book.isbn.packed()));
+  ASSERT_TRUE(returned.has_value());
+  EXPECT_EQ(returned->title, "Title1");
+
+  // A loan added with no book to go on gets a placeholder record
+  User bare = ExampleUser("B", "pass");
+  bare.loans.push_back(Loan(book.isbn.packed()));
+  um.add(bare);
+  EXPECT_EQ(um.book(um.find("B")->loans[0]).title, "(unknown title)");
+  EXPECT_TRUE(um.check_in("B", book.isbn.packed()).has_value());
 }
 
-TEST(LibraryAppTests, AppLoginToSignin)
+TEST(UMTests, LoadsLegacyBookCopies)
 {
   UI::TEST_MODE = true;
-  User user = ExampleUser("User","pass");
   UserManager um;
-  um.add(user);
-  LibraryTypes::Library lib;
+  um.load(R"([{"name":"A","password":[156,67,169,96,230,45,62,132,110,0,41,190,46,123,34,112,67,249,22,173,198,141,17,83,69,17,9,34,58,204,63,195],"books":[{"title":"Title1","author":"Author1","isbn":"978-3-16-148410-0","due":20000}]}])");
 
-  LibraryApp app = LibraryApp(um,lib);
+  ASSERT_EQ(um.at(0).loans.size(), 1);
+  EXPECT_EQ(um.at(0).loans[0].due, 20000);
+  EXPECT_EQ(um.book(um.at(0).loans[0]).title, "Title1");
 
-  std::istringstream input("1\nUser\npass\n3\n");
-  std::streambuf* origCin = std::cin.rdbuf();
-  std::cin.rdbuf(input.rdbuf());
+  // Users are written back with compact loans
+  nlohmann::json j = um.at(0);
+  EXPECT_EQ(j.at("loans").dump(), R"([{"book":9783161484100,"due":20000}])");
+}
 
-  std::ostringstream out;
-  std::streambuf* origCout = std::cout.rdbuf();
-  std::cout.rdbuf(out.rdbuf());
+// Overdue Tests
 
-  app.start();
+TEST(OverdueTests, ExpiresDayAfterDue)
+{
+  OverdueTracker tracker(100);
+  tracker.schedule("User", 1, 110);
+
+  EXPECT_TRUE(tracker.advance(110).empty());
+  EXPECT_FALSE(tracker.is_overdue("User", 1));
+
+  auto fired = tracker.advance(111);
+  EXPECT_EQ(fired.size(), 1);
+  EXPECT_EQ(fired[0].user, "User");
+  EXPECT_EQ(fired[0].due, 110);
+  EXPECT_TRUE(tracker.is_overdue("User", 1));
+  EXPECT_EQ(tracker.pending_size(), 0);
+}
 
-  EXPECT_EQ(app.current_user(), user);
+TEST(OverdueTests, CancelledLoansNeverExpire)
+{
+  OverdueTracker tracker(0);
+  tracker.schedule("User", 1, 5);
+  tracker.schedule("User", 2, 5);
+  tracker.cancel("User", 1);
+
+  auto fired = tracker.advance(10);
+  EXPECT_EQ(fired.size(), 1);
+  EXPECT_EQ(fired[0].book, 2);
+  EXPECT_FALSE(tracker.is_overdue("User", 1));
+}
 
-  std::cin.rdbuf(origCin);
-  std::cout.rdbuf(origCout);
+TEST(OverdueTests, CascadesAcrossWheels)
+{
+  // Due days spread over every wheel level and the overflow list.
+  OverdueTracker tracker(0);
+  std::vector<std::int64_t> dues = { 3, 63, 64, 200, 4095, 5000, 300000 };
+  for (size_t i = 0; i < dues.size(); i++) {
+    tracker.schedule("User", i, dues[i]);
+  }
+
+  for (size_t i = 0; i < dues.size(); i++) {
+    EXPECT_TRUE(tracker.advance(dues[i]).empty());
+    auto fired = tracker.advance(dues[i] + 1);
+    ASSERT_EQ(fired.size(), 1);
+    EXPECT_EQ(fired[0].book, i);
+  }
+
+  EXPECT_EQ(tracker.report().size(), dues.size());
 }
 
-TEST(LibraryAppTests, SearchBookByTitle)
+TEST(OverdueTests, ReportAndFormat)
 {
-  UI::TEST_MODE = true;
+  OverdueTracker tracker(20000);
+  tracker.schedule("B", 1, 19990);
+  tracker.schedule("A", 2, 19995);
+  tracker.schedule("A", 3, 19991);
+
+  auto report = tracker.report();
+  ASSERT_EQ(report.size(), 3);
+  EXPECT_EQ(report[0].user, "A");
+  EXPECT_EQ(report[0].book, 3);
+  EXPECT_EQ(report[2].user, "B");
+  EXPECT_EQ(OverdueTracker::format(0), "1970-01-01");
+  EXPECT_EQ(OverdueTracker::format(19990), "2024-09-24");
+}
 
-  LibraryTypes::Library lib;
-  LibraryTypes::Book book("Title", "Author", "978-3-16-148410-0");
-  lib.add(book);
+TEST(OverdueTests, LoanJsonKeepsDueDay)
+{
+  Loan loan(LibraryTypes::Book("Title1", "Author1", "978-3-16-148410-0"), 20000);
+  nlohmann::json j = loan;
+  EXPECT_EQ(j.at("due").get<std::int64_t>(), 20000);
+
+  Loan copy = j.get<Loan>();
+  EXPECT_EQ(copy.book, 9783161484100ULL);
+  EXPECT_EQ(copy.due, 20000);
+
+  Loan legacy = nlohmann::json::parse(R"({"title":"Title1","author":"Author1","isbn":"978-3-16-148410-0"})").get<Loan>();
+  EXPECT_EQ(legacy.due, 0);
+}
 
+TEST(UMTests, OverdueReport)
+{
+  UI::TEST_MODE = true;
   UserManager um;
   User user = ExampleUser("User", "pass");
   um.add(user);
-  LibraryApp app(um, lib);
-  EXPECT_EQ(app.size(false), 1);
-  EXPECT_EQ(app.size(true), 1);
+  um.current_user = user;
 
-  // 1 - Signin
-  // User 
-  // pass
-  // 2 - Library Main Menu
-  // 1 - Inventory
-  // 2 - Search
+  LibraryTypes::Book book("Title1", "Author1", "978-3-16-148410-0");
+  um.add(book);
+
+  std::int64_t due = um.current_user.loans[0].due;
+  EXPECT_EQ(due, OverdueTracker::today() + UserManager::LOAN_DAYS);
+  EXPECT_TRUE(um.overdue_report(due).empty());
+
+  auto report = um.overdue_report(due + 1);
+  ASSERT_EQ(report.size(), 1);
+  EXPECT_EQ(report[0].user, "User");
+  EXPECT_EQ(report[0].book, book.isbn.packed());
+
+  um.remove(0);
+  EXPECT_TRUE(um.overdue_report(due + 2).empty());
+}
+
+TEST(UMTests, ImportUsers)
+{
+  UI::TEST_MODE = true;
+  UserManager um;
+  um.set_iterations(500);
+
+  std::vector<std::pair<std::string, std::string>> accounts;
+  for (int i = 0; i < 11; i++) {
+    accounts.push_back({ "User" + std::to_string(i), "pass" + std::to_string(i) });
+  }
+
+  EXPECT_EQ(um.import(accounts), 11);
+  ASSERT_EQ(um.size(), 11);
+  for (int i = 0; i < 11; i++) {
+    EXPECT_EQ(um.at(i).name, accounts[i].first);
+    EXPECT_EQ(um.at(i).iterations, 500);
+    EXPECT_TRUE(UserManager::verify(um.at(i), accounts[i].second));
+  }
+}
+
+TEST(UMTests, ParallelSignins)
+{
+  UI::TEST_MODE = true;
+  UserManager um;
+  um.set_iterations(1000);
+  um.add(ExampleUser("Legacy", "old"));
+  um.import({ { "A", "a" }, { "B", "b" }, { "C", "c" } });
+
+  std::vector<bool> res = um.authenticate({ { "A", "a" }, { "B", "x" }, { "C", "c" }, { "Legacy", "old" }, { "Nobody", "a" } });
+  EXPECT_EQ(res, std::vector<bool>({ true, false, true, true, false }));
+
+  // A raised cost upgrades the user at the next sign in
+  um.set_iterations(2000);
+  EXPECT_TRUE(um.authenticate("A", "a"));
+  EXPECT_EQ(um.current_user.iterations, 2000);
+  EXPECT_TRUE(um.authenticate("A", "a"));
+  EXPECT_FALSE(um.authenticate("A", "b"));
+}
+
+TEST(UMTests, NewIsbnSkipsCodesOnLoanAfterRestart)
+{
+  UI::TEST_MODE = true;
+  LibraryTypes::Library lib;
+  lib.seed_isbns(12);
+  LibraryTypes::Book book("Lent", "Author", lib.new_isbn());
+  lib.add(book);
+
+  // The only copy goes out on loan, so the shelf no longer has the code
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  ASSERT_TRUE(lib.remove(book));
+  ASSERT_TRUE(um.lend("A", book));
+  auto on_loan = [&um](std::uint64_t id) { return um.on_loan(id); };
+
+  // Restarting with the saved generator state resumes past the code
+  LibraryTypes::Library resumed;
+  resumed.restore_isbns(lib.isbn_state());
+  EXPECT_NE(resumed.new_isbn().code, book.isbn.code);
+
+  // Restarting from the same seed walks the same codes, but skips the loaned one
+  LibraryTypes::Library reseeded;
+  reseeded.seed_isbns(12);
+  EXPECT_NE(reseeded.new_isbn(on_loan).code, book.isbn.code);
+
+  LibraryTypes::Library unaware;
+  unaware.seed_isbns(12);
+  EXPECT_EQ(unaware.new_isbn().code, book.isbn.code);
+}
+
+TEST(UMTests, LoadToleratesMissingLoanRecords)
+{
+  std::filesystem::path previous = std::filesystem::current_path();
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "library_um_records_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  std::filesystem::current_path(dir);
+  UI::TEST_MODE = false;
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  LibraryTypes::Book book("Lent", "Author", "978-3-16-148410-0");
+
+  // No data folder yet, so the failed writes are reported
+  EXPECT_FALSE(um.save());
+
+  std::filesystem::create_directory(dir / "data");
+  ASSERT_TRUE(um.lend("A", book));
+  EXPECT_TRUE(um.save());
+
+  // A crash that kept the users but lost the loan records
+  ASSERT_TRUE(LibraryTypes::Snapshot::write(dir / "data" / "library_loans.json", "{}\n"));
+
+  UserManager loaded;
+  EXPECT_TRUE(loaded.load());
+  ASSERT_NE(loaded.find("A"), nullptr);
+  ASSERT_EQ(loaded.find("A")->loans.size(), 1u);
+  EXPECT_EQ(loaded.book(loaded.find("A")->loans[0]).isbn.packed(), book.isbn.packed());
+
+  UI::TEST_MODE = true;
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(UMTests, LoadSetsDamagedSnapshotAside)
+{
+  std::filesystem::path previous = std::filesystem::current_path();
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "library_um_damaged_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "data");
+  std::filesystem::current_path(dir);
+  UI::TEST_MODE = false;
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  ASSERT_TRUE(um.save());
+
+  // Flip a payload byte so the block checksum no longer matches
+  std::filesystem::path users_path = dir / "data" / "library_users.json";
+  std::string bytes;
+  {
+    std::ifstream in(users_path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  bytes.back() ^= 0x01;
+  {
+    std::ofstream out(users_path, std::ios::binary | std::ios::trunc);
+    out << bytes;
+  }
+
+  UserManager loaded;
+  EXPECT_THROW(loaded.load(), std::runtime_error);
+  EXPECT_FALSE(std::filesystem::exists(users_path));
+  ASSERT_TRUE(std::filesystem::exists(dir / "data" / "library_users.json.corrupt"));
+
+  std::ifstream in(dir / "data" / "library_users.json.corrupt", std::ios::binary);
+  EXPECT_EQ(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()), bytes);
+
+  UI::TEST_MODE = true;
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(dir);
+}
+
+// Counts the calling thread's heap allocations, for the zero-allocation tests.
+thread_local size_t ALLOCATIONS = 0;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t size)
+{
+  ALLOCATIONS++;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+#pragma GCC diagnostic pop
+
+TEST(UMTests, SigninCheckDoesNotAllocate)
+{
+  UI::TEST_MODE = true;
+  UserManager um;
+  um.set_iterations(100);
+  um.add(ExampleUser("Legacy", "old"));
+  um.import({ { "A", "a" }, { "B", "b" } });
+
+  const std::string names[] = { "A", "Legacy", "Nobody" };
+  const std::string passes[] = { "a", "old", "wrong", "a-password-longer-than-thirty-two-bytes" };
+
+  size_t before = ALLOCATIONS;
+  const User* a = um.check(names[0], passes[0]);
+  const User* legacy = um.check(names[1], passes[1]);
+  const User* wrong = um.check(names[0], passes[2]);
+  const User* nobody = um.check(names[2], passes[0]);
+  const User* longer = um.check(names[1], passes[3]);
+  size_t allocations = ALLOCATIONS - before;
+
+  EXPECT_EQ(allocations, 0u);
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(a->name, "A");
+  ASSERT_NE(legacy, nullptr);
+  EXPECT_EQ(legacy->name, "Legacy");
+  EXPECT_EQ(wrong, nullptr);
+  EXPECT_EQ(nobody, nullptr);
+  EXPECT_EQ(longer, nullptr);
+
+  // The counter does see allocations made on this thread
+  before = ALLOCATIONS;
+  std::vector<User> copies(1, *a);
+  EXPECT_GT(ALLOCATIONS, before);
+  EXPECT_EQ(copies[0].name, "A");
+
+  // Signing in matches the check
+  EXPECT_TRUE(um.authenticate("B", "b"));
+  EXPECT_EQ(um.current_user.name, "B");
+  EXPECT_FALSE(um.authenticate("B", "a"));
+}
+
+TEST(UMTests, UnknownNameCostsAsMuchAsWrongPassword)
+{
+  UI::TEST_MODE = true;
+  UserManager um;
+  um.set_iterations(20000);
+  um.import({ { "A", "a" } });
+
+  auto time = [&um](const std::string& name) {
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(um.check(name, "wrong"), nullptr);
+    return std::chrono::steady_clock::now() - start;
+  };
+
+  // Warm up, then take the faster of a few runs of each
+  time("A");
+  auto known = time("A"), unknown = time("Nobody");
+  for (int i = 0; i < 2; i++) {
+    known = std::min(known, time("A"));
+    unknown = std::min(unknown, time("Nobody"));
+  }
+
+  // Without the dummy verify an unknown name returns in microseconds
+  EXPECT_GT(unknown * 4, known);
+  EXPECT_FALSE(um.verify_async("Nobody", "a").get());
+  EXPECT_TRUE(um.verify_async("A", "a").get());
+}
+
+TEST(UserTests, SaltedJsonRoundTrip)
+{
+  UserManager um;
+  um.set_iterations(10);
+  User user = um.make_user("User", "pass");
+
+  nlohmann::json j = user;
+  EXPECT_EQ(j.at("iterations"), 10);
+  User copy = j.get<User>();
+  EXPECT_EQ(copy, user);
+  EXPECT_TRUE(UserManager::verify(copy, "pass"));
+
+  // Legacy users are written without salt & iterations
+  nlohmann::json legacy = ExampleUser("User", "pass");
+  EXPECT_FALSE(legacy.contains("salt"));
+  EXPECT_EQ(legacy.get<User>().iterations, 0);
+}
+
+#include "../include/hash_sha256_batch.h"
+
+// Password Tests
+std::string HexKey(const sha256_type& key)
+{
+  std::ostringstream oss;
+  for (auto b : key) {
+    oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(b);
+  }
+  return oss.str();
+}
+
+TEST(PasswordTests, Pbkdf2KnownVectors)
+{
+  const std::uint8_t* salt = reinterpret_cast<const std::uint8_t*>("salt");
+  EXPECT_EQ(HexKey(Password::derive("password", salt, 4, 1)), "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b");
+  EXPECT_EQ(HexKey(Password::derive("password", salt, 4, 2)), "ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43");
+  EXPECT_EQ(HexKey(Password::derive("password", salt, 4, 4096)), "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+}
+
+TEST(PasswordTests, BatchMatchesSingle)
+{
+  std::vector<std::string> passwords;
+  std::vector<Password::salt_type> salts;
+  for (int i = 0; i < 11; i++) {
+    passwords.push_back(std::string(static_cast<size_t>(i * 9), 'p') + std::to_string(i));
+    salts.push_back(Password::make_salt());
+  }
+
+  std::vector<sha256_type> keys = Password::derive(passwords, salts, 50);
+  ASSERT_EQ(keys.size(), passwords.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(keys[i], Password::derive(passwords[i], salts[i], 50));
+  }
+}
+
+// Batch Hash Tests
+TEST(BatchHashTests, EnginesMatchScalar)
+{
+  // Lengths around the block & padding boundaries, in one batch
+  std::vector<std::string> msgs;
+  for (size_t len = 0; len < 300; len += (len < 130 ? 1 : 17)) {
+    std::string msg(len, '\0');
+    for (size_t i = 0; i < len; i++) {
+      msg[i] = static_cast<char>((i * 31 + len) & 0xFF);
+    }
+    msgs.push_back(msg);
+  }
+
+  std::vector<sha256_type> expected;
+  for (const std::string& msg : msgs) {
+    hash_sha256 hash;
+    hash.sha256_init();
+    hash.sha256_update(reinterpret_cast<const std::uint8_t*>(msg.data()), msg.size());
+    expected.push_back(hash.sha256_final());
+  }
+
+  for (auto engine : { hash_sha256_batch::engine::scalar, hash_sha256_batch::engine::sse2,
+                       hash_sha256_batch::engine::avx2, hash_sha256_batch::engine::sha_ni }) {
+    if (!hash_sha256_batch::supported(engine)) {
+      continue;
+    }
+
+    EXPECT_EQ(hash_sha256_batch::hash(msgs, engine), expected) << "engine " << static_cast<int>(engine);
+  }
+}
+
+TEST(BatchHashTests, PartialBatches)
+{
+  hash_sha256 hash;
+  for (size_t count = 0; count < 10; count++) {
+    std::vector<std::array<std::uint8_t, 32U>> msgs;
+    for (size_t i = 0; i < count; i++) {
+      msgs.push_back(std::stobya("password" + std::to_string(i)));
+    }
+
+    std::vector<sha256_type> hashes = hash_sha256_batch::hash(msgs);
+    ASSERT_EQ(hashes.size(), count);
+    for (size_t i = 0; i < count; i++) {
+      hash.sha256_init();
+      hash.sha256_update(msgs[i].data(), msgs[i].size());
+      EXPECT_EQ(hashes[i], hash.sha256_final());
+    }
+  }
+}
+
+#include "../include/App.h"
+
+// LibraryApp Tests
+TEST(LibraryAppTests, AppLoginToSignup)
+{
+  LibraryApp app;
+  UI::TEST_MODE = true;
+
+  std::istringstream input("2\nUser\npass\n3\n");
+  std::streambuf* origCin = std::cin.rdbuf();
+  std::cin.rdbuf(input.rdbuf());
+
+  std::ostringstream out;
+  std::streambuf* origCout = std::cout.rdbuf();
+  std::cout.rdbuf(out.rdbuf());
+
+  app.start();
+
+  EXPECT_EQ(app.size(true), 1);
+
+  std::cin.rdbuf(origCin);
+  std::cout.rdbuf(origCout);
+}
+
+TEST(LibraryAppTests, AppLoginToSignin)
+{
+  UI::TEST_MODE = true;
+  User user = ExampleUser("User","pass");
+  UserManager um;
+  um.add(user);
+  LibraryTypes::Library lib;
+
+  LibraryApp app = LibraryApp(um,lib);
+
+  std::istringstream input("1\nUser\npass\n3\n");
+  std::streambuf* origCin = std::cin.rdbuf();
+  std::cin.rdbuf(input.rdbuf());
+
+  std::ostringstream out;
+  std::streambuf* origCout = std::cout.rdbuf();
+  std::cout.rdbuf(out.rdbuf());
+
+  app.start();
+
+  // Signing in upgrades the legacy hash
+  EXPECT_EQ(app.current_user().name, user.name);
+  EXPECT_NE(app.current_user().password, user.password);
+  EXPECT_TRUE(UserManager::verify(app.current_user(), "pass"));
+
+  std::cin.rdbuf(origCin);
+  std::cout.rdbuf(origCout);
+}
+
+TEST(LibraryAppTests, SearchBookByTitle)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book book("Title", "Author", "978-3-16-148410-0");
+  lib.add(book);
+
+  UserManager um;
+  User user = ExampleUser("User", "pass");
+  um.add(user);
+  LibraryApp app(um, lib);
+  EXPECT_EQ(app.size(false), 1);
+  EXPECT_EQ(app.size(true), 1);
+
+  // 1 - Signin
+  // User 
+  // pass
+  // 2 - Library Main Menu
+  // 1 - Inventory
+  // 2 - Search
   // 1 - Title
   // Test Title
   // 3 - Exit
@@ -672,6 +2096,82 @@ TEST(LibraryAppTests, SearchBookByTitle)
   std::cout.rdbuf(origCout);
 }
 
+TEST(LibraryAppTests, ReturnHandsCopyToHolder)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book book("Title", "Author", "978-3-16-148410-0");
+  lib.add(book);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  um.add(ExampleUser("B", "pass"));
+
+  LibraryApp app(um, lib);
+  app.users().current_user = app.users().at(0);
+  app.borrow_book(0);
+  EXPECT_EQ(app.size(false), 0);
+
+  EXPECT_TRUE(app.library().place_hold(book.isbn, "B"));
+  EXPECT_EQ(app.library().holds_waiting(book), 1);
+
+  EXPECT_EQ(app.return_book(0), "B");
+  EXPECT_EQ(app.size(false), 0);
+  EXPECT_EQ(app.library().holds_waiting(book), 0);
+  EXPECT_EQ(app.users().at(1).loans.size(), 1);
+  EXPECT_EQ(app.users().at(1).loans[0].book, book.isbn.packed());
+  EXPECT_EQ(app.users().borrowers_of(book), std::vector<std::string>({ "B" }));
+  EXPECT_EQ(app.library().borrows(book), 2);
+
+  app.users().current_user = app.users().at(1);
+  EXPECT_EQ(app.return_book(0), "");
+  EXPECT_EQ(app.size(false), 1);
+}
+
+TEST(LibraryAppTests, StartStopsOnDamagedSnapshot)
+{
+  std::filesystem::path previous = std::filesystem::current_path();
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "library_app_damaged_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "data");
+  std::filesystem::current_path(dir);
+
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("Title", "Author", "978-3-16-148410-0"));
+  std::filesystem::path books_path = dir / "data" / "library_books.json";
+  std::string payload = lib.save_as_json();
+  ASSERT_TRUE(LibraryTypes::Snapshot::write(books_path, payload));
+
+  // Cut the file short, as a failing disk might
+  std::filesystem::resize_file(books_path, std::filesystem::file_size(books_path) - 1);
+
+  UI::TEST_MODE = false;
+  std::istringstream input("");
+  std::ostringstream out;
+  UI::SESSION.in = &input;
+  UI::SESSION.out = &out;
+  UI::SESSION.strict = true;
+
+  LibraryApp app;
+  EXPECT_NO_THROW(app.start());
+
+  UI::SESSION = UI::Session();
+  UI::TEST_MODE = true;
+
+  // The app stopped before the login and saved nothing over the data
+  EXPECT_NE(out.str().find("Damaged snapshot"), std::string::npos);
+  EXPECT_EQ(out.str().find("Do you have an account?"), std::string::npos);
+  EXPECT_FALSE(std::filesystem::exists(books_path));
+  ASSERT_TRUE(std::filesystem::exists(dir / "data" / "library_books.json.corrupt"));
+
+  std::optional<std::string> aside = LibraryTypes::Snapshot::read(dir / "data" / "library_books.json.corrupt");
+  EXPECT_FALSE(aside.has_value());
+
+  std::filesystem::current_path(previous);
+  std::filesystem::remove_all(dir);
+}
+
 /*TEST(LibraryAppTests, SearchBookByAuthor)
 {
   UI::TEST_MODE = true;
@@ -750,4 +2250,540 @@ TEST(LibraryAppTests, SearchBookByTitle)
 
   std::cin.rdbuf(origCin);
   std::cout.rdbuf(origCout);
-}*/
\ No newline at end of file
+}*/
+
+// Trace Tests
+#include "../include/Trace.h"
+
+TEST(TraceTests, RecordsAnswersWithTheirPrompts)
+{
+  UI::TEST_MODE = true;
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "library_trace_test.jsonl";
+  std::filesystem::remove(path);
+
+  std::istringstream input("2\nUser\npass\n3\n");
+  std::streambuf* origCin = std::cin.rdbuf();
+  std::cin.rdbuf(input.rdbuf());
+
+  std::ostringstream out;
+  std::streambuf* origCout = std::cout.rdbuf();
+  std::cout.rdbuf(out.rdbuf());
+
+  {
+    UI::Recorder recorder(path);
+    ASSERT_TRUE(recorder.is_open());
+    LibraryApp app;
+    app.start();
+  }
+
+  std::cin.rdbuf(origCin);
+  std::cout.rdbuf(origCout);
+
+  std::vector<std::vector<UI::Step>> sessions = UI::load_trace(path);
+  ASSERT_EQ(sessions.size(), 1u);
+  ASSERT_EQ(sessions[0].size(), 4u);
+  EXPECT_EQ(sessions[0][0].label, "signup");
+  EXPECT_EQ(sessions[0][1].label, "Name");
+  EXPECT_EQ(sessions[0][2].answer, "pass");
+  EXPECT_EQ(sessions[0][3].label, "Exit & Save");
+
+  std::filesystem::remove(path);
+}
+
+TEST(TraceTests, ReplaysSessionsHeadlessly)
+{
+  UI::TEST_MODE = true;
+  UserManager um;
+  um.add(ExampleUser("User", "pass"));
+  LibraryTypes::Library lib;
+  lib.add(LibraryTypes::Book("Dune", "Frank Herbert", "978-0-441-17271-9"));
+
+  std::vector<UI::Step> steps = {
+    { "signin", "1" }, { "Name", "User" }, { "Password", "pass" },
+    { "LIB Main", "2" }, { "Exit & Save", "5" }
+  };
+
+  UI::LatencyStats stats;
+  for (int i = 0; i < 3; i++) {
+    LibraryApp app(um, lib);
+    UI::Outcome outcome = UI::replay(steps, [&app]() { app.start(); }, stats);
+    EXPECT_TRUE(outcome.finished);
+    EXPECT_EQ(outcome.diverged, 0u);
+  }
+  EXPECT_EQ(stats.total(), 15u);
+
+  std::vector<UI::LatencyStats::Summary> summary = stats.summary();
+  auto name = std::find_if(summary.begin(), summary.end(), [](const UI::LatencyStats::Summary& op) { return op.label == "Name"; });
+  ASSERT_NE(name, summary.end());
+  EXPECT_EQ(name->count, 3u);
+  EXPECT_LE(name->p50, name->p99);
+  EXPECT_LE(name->p99, name->max);
+
+  // The input runs out mid-session: the replay stops instead of spinning
+  LibraryApp app(um, lib);
+  UI::Outcome outcome = UI::replay(std::vector<UI::Step>(steps.begin(), steps.begin() + 3), [&app]() { app.start(); }, stats);
+  EXPECT_FALSE(outcome.finished);
+  EXPECT_EQ(outcome.diverged, 0u);
+}
+
+// Circulation Tests
+#include "../include/Circulation.h"
+
+TEST(CirculationTests, CommitsBorrowsAndReturns)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book first("First", "Author", "978-3-16-148410-0");
+  LibraryTypes::Book second("Second", "Author", "978-0-306-40615-7");
+  lib.add(first);
+  lib.add(second);
+  lib.add(second);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  um.add(ExampleUser("B", "pass"));
+
+  Circulation cart(um, lib);
+  cart.borrow("A", first.isbn).borrow("A", second.isbn).borrow("B", second.isbn);
+  ASSERT_TRUE(cart.commit());
+  EXPECT_EQ(lib.size(), 0);
+  EXPECT_EQ(um.find("A")->loans.size(), 2);
+  EXPECT_EQ(um.borrowers_of(second), std::vector<std::string>({ "A", "B" }));
+  EXPECT_EQ(lib.borrows(second), 2);
+
+  cart.give_back("A", first.isbn).give_back("B", second.isbn).borrow("B", first.isbn);
+  ASSERT_TRUE(cart.commit());
+  EXPECT_EQ(lib.size(), 1);
+  EXPECT_TRUE(lib.contains(second.isbn));
+  EXPECT_FALSE(lib.contains(first.isbn));
+  EXPECT_EQ(um.borrowers_of(first), std::vector<std::string>({ "B" }));
+  EXPECT_EQ(um.find("A")->loans.size(), 1);
+  EXPECT_EQ(lib.search("first", LibraryTypes::SEARCH::TITLE).size(), 0);
+  EXPECT_EQ(lib.search("second", LibraryTypes::SEARCH::TITLE).size(), 1);
+}
+
+TEST(CirculationTests, RejectsWholeBatch)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book book("Only", "Author", "978-3-16-148410-0");
+  lib.add(book);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+
+  Circulation cart(um, lib);
+  cart.borrow("A", book.isbn).borrow("A", book.isbn);
+  EXPECT_FALSE(cart.commit());
+  EXPECT_EQ(cart.error(), "No copy left of: 978-3-16-148410-0");
+  EXPECT_EQ(lib.size(), 1);
+  EXPECT_TRUE(um.find("A")->loans.empty());
+
+  Circulation other(um, lib);
+  other.borrow("A", book.isbn).give_back("A", book.isbn);
+  EXPECT_FALSE(other.commit());
+  other.borrow("Nobody", book.isbn);
+  EXPECT_FALSE(other.validate());
+  EXPECT_EQ(lib.size(), 1);
+}
+
+TEST(CirculationTests, ReturnsServeHolds)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book book("Only", "Author", "978-3-16-148410-0");
+  lib.add(book);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  um.add(ExampleUser("B", "pass"));
+
+  Circulation cart(um, lib);
+  ASSERT_TRUE(cart.borrow("A", book.isbn).commit());
+  EXPECT_TRUE(lib.place_hold(book.isbn, "B"));
+
+  cart.give_back("A", book.isbn).borrow("A", book.isbn);
+  EXPECT_FALSE(cart.validate());
+
+  Circulation returns(um, lib);
+  ASSERT_TRUE(returns.give_back("A", book.isbn).commit());
+  EXPECT_EQ(lib.size(), 0);
+  EXPECT_EQ(lib.holds_waiting(book), 0);
+  EXPECT_EQ(um.borrowers_of(book), std::vector<std::string>({ "B" }));
+}
+
+TEST(CirculationTests, MatchesCopiesByPackedIsbn)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book book("Only", "Author", "978-3-16-148410-0");
+  lib.add(book);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  um.add(ExampleUser("B", "pass"));
+
+  Circulation cart(um, lib);
+  ASSERT_TRUE(cart.borrow("A", book.isbn).commit());
+
+  // The returned copy keeps its hyphenated code; the batch names it without
+  LibraryTypes::ISBN plain("9783161484100");
+  ASSERT_TRUE(cart.give_back("A", plain).borrow("B", plain).commit());
+  EXPECT_TRUE(cart.error().empty());
+  EXPECT_TRUE(um.find("A")->loans.empty());
+  EXPECT_EQ(um.find("B")->loans.size(), 1);
+  EXPECT_EQ(lib.size(), 0);
+
+  // A failed batch changes nothing
+  EXPECT_FALSE(cart.give_back("B", plain).borrow("A", plain).borrow("A", plain).commit());
+  EXPECT_FALSE(cart.error().empty());
+  EXPECT_EQ(um.find("B")->loans.size(), 1);
+  EXPECT_EQ(lib.size(), 0);
+}
+
+TEST(CirculationTests, ReturnsLoansOfAddedUsers)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book book("Only", "Author", "978-3-16-148410-0");
+
+  UserManager um;
+  um.add(User("A", sha256_type{}, { book }));
+
+  Circulation cart(um, lib);
+  ASSERT_NO_THROW(EXPECT_TRUE(cart.give_back("A", book.isbn).commit()));
+  EXPECT_TRUE(um.find("A")->loans.empty());
+  EXPECT_TRUE(lib.contains(book.isbn));
+}
+
+// History Tests
+TEST(HistoryTests, RecommendsCoBorrowedBooks)
+{
+  LibraryTypes::LoanHistory history;
+  LibraryTypes::Book dune("Dune", "Herbert", "978-3-16-148410-0");
+  LibraryTypes::Book messiah("Dune Messiah", "Herbert", "978-0-306-40615-7");
+  LibraryTypes::Book other("Other", "Someone", "new");
+
+  history.record("A", dune, 1);
+  history.record("A", messiah, 2);
+  history.record("B", dune, 3);
+  history.record("B", messiah, 4);
+  history.record("B", other, 5);
+  history.record("B", dune, 6);
+
+  auto picks = history.recommend(dune);
+  ASSERT_EQ(picks.size(), 2);
+  EXPECT_EQ(picks[0].title, "Dune Messiah");
+  EXPECT_EQ(picks[1].title, "Other");
+  EXPECT_EQ(history.co_borrows().neighbors(dune.isbn.packed(), 5)[0].count, 2);
+  EXPECT_EQ(history.recommend(dune, 1).size(), 1);
+  EXPECT_EQ(history.size(), 6);
+}
+
+TEST(HistoryTests, RowsStayBounded)
+{
+  LibraryTypes::CoBorrow matrix;
+  for (std::uint64_t i = 1; i <= 100; i++) {
+    matrix.add(0, i);
+  }
+  matrix.add(0, 100);
+
+  auto row = matrix.neighbors(0, 1000);
+  EXPECT_EQ(row.size(), LibraryTypes::CoBorrow::ROW);
+  EXPECT_EQ(row[0].book, 100);
+  EXPECT_EQ(matrix.neighbors(42, 5).size(), 1);
+}
+
+TEST(HistoryTests, ReplaysLogLines)
+{
+  LibraryTypes::LoanHistory history;
+  LibraryTypes::Book first("First", "Author", "978-3-16-148410-0");
+  LibraryTypes::Book second("Second", "Author", "978-0-306-40615-7");
+  history.record("A", first, 1);
+  history.record("A", second, 2);
+
+  LibraryTypes::LoanHistory replayed;
+  EXPECT_TRUE(replayed.replay(history.line(0)));
+  EXPECT_TRUE(replayed.replay(history.line(1)));
+  EXPECT_FALSE(replayed.replay("{\"title\":\"torn"));
+  EXPECT_EQ(replayed.size(), 2);
+  EXPECT_EQ(replayed.recommend(first)[0].title, "Second");
+}
+
+TEST(HistoryTests, AlsoBorrowedSurvivesReturns)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book first("First", "Author", "978-3-16-148410-0");
+  LibraryTypes::Book second("Second", "Author", "978-0-306-40615-7");
+  lib.add(first);
+  lib.add(second);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+
+  Circulation cart(um, lib);
+  ASSERT_TRUE(cart.borrow("A", first.isbn).borrow("A", second.isbn).commit());
+  ASSERT_TRUE(cart.give_back("A", first.isbn).give_back("A", second.isbn).commit());
+
+  EXPECT_TRUE(um.find("A")->loans.empty());
+  EXPECT_EQ(um.loan_history().size(), 2);
+  auto picks = um.also_borrowed(first);
+  ASSERT_EQ(picks.size(), 1);
+  EXPECT_EQ(picks[0].title, "Second");
+}
+
+// Sharded Tests
+#include "../include/Sharded.h"
+
+TEST(ShardedTests, PointLookupsGoToOwningShard)
+{
+  UI::TEST_MODE = true;
+  LibraryTypes::ShardedLibrary sharded(4);
+  LibraryTypes::Library single;
+  single.seed_isbns(11);
+
+  std::vector<LibraryTypes::Book> books;
+  for (const LibraryTypes::ISBN& isbn : single.new_isbns(200)) {
+    books.emplace_back("Title " + isbn.code, "Author", isbn);
+  }
+  EXPECT_EQ(sharded.import(books), 200u);
+  EXPECT_EQ(sharded.import(books), 0u);
+  EXPECT_EQ(sharded.size(), 200u);
+
+  std::vector<size_t> sizes = sharded.sizes();
+  for (size_t count : sizes) {
+    EXPECT_GT(count, 0u);
+  }
+
+  std::optional<LibraryTypes::Book> found = sharded.find(books[17].isbn);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(*found, books[17]);
+  EXPECT_EQ(sharded.search(books[17].isbn.code, LibraryTypes::SEARCH::CODE).size(), 1u);
+
+  EXPECT_TRUE(sharded.remove(books[17]));
+  EXPECT_FALSE(sharded.contains(books[17].isbn));
+  EXPECT_FALSE(sharded.find(books[17].isbn).has_value());
+}
+
+TEST(ShardedTests, SearchMergesTopKAcrossShards)
+{
+  UI::TEST_MODE = true;
+  LibraryTypes::ShardedLibrary sharded(3);
+  LibraryTypes::Library single;
+  single.seed_isbns(5);
+
+  std::vector<LibraryTypes::Book> books;
+  std::vector<LibraryTypes::ISBN> isbns = single.new_isbns(60);
+  for (size_t i = 0; i < isbns.size(); i++) {
+    std::string title = i % 3 == 0 ? "Dune" : (i % 3 == 1 ? "Dune Messiah" : "Children of Dune " + std::to_string(i));
+    books.emplace_back(title, "Herbert", isbns[i]);
+  }
+  sharded.import(books);
+  single.import(books);
+  sharded.record_borrow(books[4]);
+
+  std::vector<LibraryTypes::Book> top = sharded.search("dune", LibraryTypes::SEARCH::TITLE, 25);
+  ASSERT_EQ(top.size(), 25u);
+  for (size_t i = 0; i < 20; i++) {
+    EXPECT_EQ(top[i].title, "Dune");
+  }
+  EXPECT_EQ(top[20], books[4]);
+  EXPECT_EQ(top[21].title, "Dune Messiah");
+
+  std::vector<LibraryTypes::Book> all = sharded.search("dune", LibraryTypes::SEARCH::TITLE, 0);
+  EXPECT_EQ(all.size(), single.search("dune", LibraryTypes::SEARCH::TITLE, 0).size());
+}
+
+TEST(ShardedTests, LoadRoutesConvertedIsbn10s)
+{
+  UI::TEST_MODE = true;
+  LibraryTypes::ShardedLibrary sharded(4);
+
+  EXPECT_TRUE(sharded.load(R"([{"title":"Dune","author":"Herbert","isbn":"0-441-17271-7"}])"));
+  EXPECT_TRUE(sharded.contains(LibraryTypes::ISBN("9780441172719")));
+  EXPECT_EQ(sharded.size(), 1u);
+
+  LibraryTypes::ShardedLibrary copy(2);
+  copy.load(sharded.save_as_json());
+  EXPECT_EQ(copy.search("herbert", LibraryTypes::SEARCH::AUTHOR).size(), 1u);
+
+  EXPECT_THROW(sharded.load(R"([{"title":"Bad","author":"X","isbn":"123"}])"), std::runtime_error);
+}
+
+// Reports Tests
+#include "../include/Reports.h"
+
+TEST(ReportsTests, GroupsByAuthorAndAvailability)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book dune("Dune", "Frank Herbert", "978-0-441-17271-9");
+  LibraryTypes::Book messiah("Dune Messiah", "Frank Herbert", "978-0-399-12877-6");
+  LibraryTypes::Book other("Other", "Someone Else", "978-3-16-148410-0");
+  lib.add(dune);
+  lib.add(dune);
+  lib.add(messiah);
+  lib.add(other);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  ASSERT_TRUE(um.lend("A", messiah));
+  ASSERT_TRUE(um.lend("A", dune));
+
+  Reports reports(um, lib);
+  std::vector<Reports::AuthorCount> authors = reports.by_author();
+  ASSERT_EQ(authors.size(), 2u);
+  EXPECT_EQ(authors[0].author, "Frank Herbert");
+  EXPECT_EQ(authors[0].on_shelf, 3u);
+  EXPECT_EQ(authors[0].on_loan, 2u);
+  EXPECT_EQ(authors[1].on_shelf, 1u);
+  EXPECT_EQ(authors[1].on_loan, 0u);
+
+  // Dune: 2 on shelf, 1 out; Messiah: 1 & 1; Other: 1 & 0
+  std::vector<Reports::Availability> titles = reports.availability();
+  ASSERT_EQ(titles.size(), 3u);
+  EXPECT_EQ(titles[0].book.title, "Dune Messiah");
+  EXPECT_DOUBLE_EQ(titles[0].ratio(), 0.5);
+  EXPECT_EQ(titles[2].book.title, "Other");
+  EXPECT_DOUBLE_EQ(reports.availability_ratio(), 4.0 / 6.0);
+}
+
+TEST(ReportsTests, LoansAreSnapshottedWithTheCatalog)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book dune("Dune", "Frank Herbert", "978-0-441-17271-9");
+  lib.add(dune);
+  lib.add(dune);
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+
+  Reports reports(um, lib);
+
+  // A borrow after the reports were opened is in neither snapshot
+  ASSERT_TRUE(um.lend("A", dune));
+
+  std::vector<Reports::Availability> titles = reports.availability();
+  ASSERT_EQ(titles.size(), 1u);
+  EXPECT_EQ(titles[0].on_shelf, 2u);
+  EXPECT_EQ(titles[0].on_loan, 0u);
+  EXPECT_DOUBLE_EQ(reports.availability_ratio(), 1.0);
+
+  std::vector<Reports::AuthorCount> authors = reports.by_author();
+  ASSERT_EQ(authors.size(), 1u);
+  EXPECT_EQ(authors[0].on_loan, 0u);
+  EXPECT_EQ(reports.loans_per_user()[0].loans, 0u);
+  EXPECT_TRUE(reports.top_borrowed().empty());
+}
+
+TEST(ReportsTests, LoansPerUserAndTopBorrowed)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book first("First", "Author", "978-3-16-148410-0");
+  LibraryTypes::Book second("Second", "Author", "978-0-306-40615-7");
+
+  UserManager um;
+  um.add(ExampleUser("A", "pass"));
+  um.add(ExampleUser("B", "pass"));
+  ASSERT_TRUE(um.lend("B", first));
+  ASSERT_TRUE(um.lend("B", second));
+  ASSERT_TRUE(um.lend("A", second));
+
+  // Far enough ahead that every loan is overdue
+  Reports reports(um, lib, 0, OverdueTracker::today() + 365);
+  std::vector<Reports::UserLoans> users = reports.loans_per_user();
+  ASSERT_EQ(users.size(), 2u);
+  EXPECT_EQ(users[0].name, "B");
+  EXPECT_EQ(users[0].loans, 2u);
+  EXPECT_EQ(users[0].overdue, 2u);
+  EXPECT_EQ(users[1].loans, 1u);
+
+  std::vector<Reports::Borrowed> top = reports.top_borrowed(1);
+  ASSERT_EQ(top.size(), 1u);
+  EXPECT_EQ(top[0].book.title, "Second");
+  EXPECT_EQ(top[0].loans, 2u);
+  EXPECT_EQ(reports.top_borrowed().size(), 2u);
+}
+
+TEST(ReportsTests, ParallelScanMatchesSerial)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book books[] = {
+    LibraryTypes::Book("Dune", "Frank Herbert", "978-0-441-17271-9"),
+    LibraryTypes::Book("First", "Author", "978-3-16-148410-0"),
+    LibraryTypes::Book("Second", "Author", "978-0-306-40615-7"),
+  };
+  for (size_t i = 0; i < 3 * Reports::MIN_ROWS; i++)
+  {
+    lib.add(books[i % 3]);
+  }
+
+  UserManager um;
+  Reports serial(um, lib, 1);
+  Reports parallel(um, lib, 4);
+
+  std::vector<Reports::AuthorCount> expected = serial.by_author();
+  std::vector<Reports::AuthorCount> actual = parallel.by_author();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); i++)
+  {
+    EXPECT_EQ(actual[i].author, expected[i].author);
+    EXPECT_EQ(actual[i].on_shelf, expected[i].on_shelf);
+  }
+  EXPECT_EQ(actual[0].on_shelf, 2 * Reports::MIN_ROWS);
+
+  ASSERT_FALSE(parallel.timing().empty());
+  EXPECT_EQ(parallel.timing()[0].query, "by_author shelf");
+  EXPECT_EQ(parallel.timing()[0].rows, 3 * Reports::MIN_ROWS);
+  EXPECT_EQ(parallel.timing()[0].threads, 3u);
+  EXPECT_EQ(serial.timing()[0].threads, 1u);
+}
+
+TEST(ReportsTests, CountsLoansWithPlaceholderRecords)
+{
+  UI::TEST_MODE = true;
+
+  LibraryTypes::Library lib;
+  LibraryTypes::Book shelf("Shelf", "Author", "978-3-16-148410-0");
+  lib.add(shelf);
+
+  // A user added with a bare loan: the loan gets a placeholder record
+  UserManager um;
+  User orphan = ExampleUser("Orphan", "pass");
+  orphan.loans.push_back(Loan(LibraryTypes::ISBN("978-0-306-40615-7").packed()));
+  um.add(orphan);
+
+  Reports reports(um, lib);
+  std::vector<Reports::AuthorCount> authors;
+  ASSERT_NO_THROW(authors = reports.by_author());
+  ASSERT_EQ(authors.size(), 2u);
+  auto unknown = std::find_if(authors.begin(), authors.end(), [](const Reports::AuthorCount& row) { return row.author == "(unknown author)"; });
+  ASSERT_NE(unknown, authors.end());
+  EXPECT_EQ(unknown->on_loan, 1u);
+  EXPECT_EQ(reports.missing(), 0u);
+
+  std::vector<Reports::Availability> titles;
+  ASSERT_NO_THROW(titles = reports.availability());
+  ASSERT_EQ(titles.size(), 2u);
+  auto placeholder = std::find_if(titles.begin(), titles.end(), [](const Reports::Availability& row) { return row.book.title == "(unknown title)"; });
+  ASSERT_NE(placeholder, titles.end());
+  EXPECT_EQ(placeholder->on_loan, 1u);
+  EXPECT_EQ(placeholder->on_shelf, 0u);
+  EXPECT_EQ(reports.missing(), 0u);
+
+  EXPECT_EQ(reports.loans_per_user()[0].loans, 1u);
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/App.h"
+#include "../include/Trace.h"
+
+// Replays recorded sessions against the saved catalog & users.
+// Record sessions with `library --record <trace>`, then run
+//   library_replay <trace> [users] [rounds]
+// Each simulated user replays every session `rounds` times on its own
+// thread, against its own copy of the data in ./data; nothing is saved.
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    std::cerr << "usage: library_replay <trace> [users] [rounds]\n";
+    return 1;
+  }
+
+  const size_t users = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+  const size_t rounds = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1;
+
+  std::vector<std::vector<UI::Step>> sessions = UI::load_trace(argv[1]);
+  if (sessions.empty() || users == 0) {
+    std::cerr << "no sessions to replay in " << argv[1] << "\n";
+    return 1;
+  }
+
+  // Load once with saving enabled, then switch to test mode for the run
+  UserManager um;
+  LibraryTypes::Library lib;
+  UI::TEST_MODE = false;
+  [[maybe_unused]] bool ignored = um.load();
+  ignored = lib.load();
+  UI::TEST_MODE = true;
+
+  std::mutex lock;
+  UI::LatencyStats stats;
+  size_t unfinished = 0;
+  size_t diverged = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (size_t user = 0; user < users; user++) {
+    workers.emplace_back([&, user]() {
+      std::unique_lock<std::mutex> copying(lock);
+      const UserManager my_um = um;
+      const LibraryTypes::Library my_lib = lib;
+      copying.unlock();
+
+      UI::LatencyStats mine;
+      size_t my_unfinished = 0;
+      size_t my_diverged = 0;
+
+      for (size_t round = 0; round < rounds; round++) {
+        // Users start at different sessions so the mix is spread out
+        for (size_t i = 0; i < sessions.size(); i++) {
+          LibraryApp app(my_um, my_lib);
+          UI::Outcome outcome = UI::replay(sessions[(i + user) % sessions.size()], [&app]() { app.start(); }, mine);
+          my_unfinished += outcome.finished ? 0 : 1;
+          my_diverged += outcome.diverged;
+        }
+      }
+
+      std::lock_guard<std::mutex> guard(lock);
+      stats.merge(mine);
+      unfinished += my_unfinished;
+      diverged += my_diverged;
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << users << " users x " << rounds << " rounds x " << sessions.size() << " sessions in "
+            << std::fixed << std::setprecision(3) << seconds << " s, "
+            << std::setprecision(1) << stats.total() / seconds << " answers/s\n";
+  if (unfinished != 0 || diverged != 0) {
+    std::cout << unfinished << " sessions ran out of answers, " << diverged << " answers diverged from the recording\n";
+  }
+
+  std::cout << std::left << std::setw(32) << "operation"
+            << std::right << std::setw(10) << "count" << std::setw(12) << "ops/s"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << std::setw(12) << "max us\n";
+
+  for (const UI::LatencyStats::Summary& op : stats.summary()) {
+    std::cout << std::left << std::setw(32) << op.label.substr(0, 31)
+              << std::right << std::setw(10) << op.count << std::setw(12) << std::setprecision(1) << op.count / seconds
+              << std::setw(10) << op.p50 << std::setw(10) << op.p90 << std::setw(10) << op.p99 << std::setw(11) << op.max << "\n";
+  }
+
+  return 0;
+}